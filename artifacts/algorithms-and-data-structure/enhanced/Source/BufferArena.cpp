@@ -0,0 +1,467 @@
+///////////////////////////////////////////////////////////////////////////////
+// bufferarena.cpp
+///////////////////////////////////////////////////////////////////////////////
+
+#include "BufferArena.h"
+
+#include <algorithm>
+
+// declaration of global variables and functions
+namespace
+{
+	/***********************************************************
+	 *  AlignUp()
+	 *
+	 *  This function is used for rounding an offset up to the
+	 *  next multiple of the alignment.
+	 ***********************************************************/
+	GLintptr AlignUp(GLintptr offset, GLsizeiptr alignment)
+	{
+		return(((offset + alignment - 1) / alignment) * alignment);
+	}
+}
+
+/***********************************************************
+ *  BufferArena()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+BufferArena::BufferArena()
+{
+	m_bufferID = 0;
+	m_capacity = 0;
+	m_growCount = 0;
+	m_defragmentCount = 0;
+}
+
+/***********************************************************
+ *  ~BufferArena()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+BufferArena::~BufferArena()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method is used for creating the buffer with the passed
+ *  in capacity, which is all free.
+ ***********************************************************/
+void BufferArena::Create(GLsizeiptr capacity)
+{
+	Destroy();
+
+	m_capacity = std::max(capacity, (GLsizeiptr)1);
+	glGenBuffers(1, &m_bufferID);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, m_bufferID);
+	glBufferData(GL_COPY_WRITE_BUFFER, m_capacity, NULL, GL_STATIC_DRAW);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	AddFreeBlock(0, m_capacity);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for releasing the buffer.  Every
+ *  handle becomes invalid.
+ ***********************************************************/
+void BufferArena::Destroy()
+{
+	if (m_bufferID != 0)
+	{
+		glDeleteBuffers(1, &m_bufferID);
+		m_bufferID = 0;
+	}
+	m_capacity = 0;
+	m_allocations.clear();
+	m_freeHandles.clear();
+	m_freeBlocks.clear();
+}
+
+/***********************************************************
+ *  GetBufferID()
+ *
+ *  This method is used for getting the name of the buffer,
+ *  which does not change while the arena exists.
+ ***********************************************************/
+GLuint BufferArena::GetBufferID() const
+{
+	return(m_bufferID);
+}
+
+/***********************************************************
+ *  Allocate()
+ *
+ *  This method is used for allocating a range of the buffer
+ *  whose offset is a multiple of the alignment.  The free
+ *  block that leaves the least space unused is taken, and the
+ *  buffer grows when no free block is large enough.
+ ***********************************************************/
+int BufferArena::Allocate(GLsizeiptr size, GLsizeiptr alignment)
+{
+	if ((size <= 0) || (m_bufferID == 0))
+	{
+		return(INVALID_HANDLE);
+	}
+	alignment = std::max(alignment, (GLsizeiptr)1);
+
+	int bestBlock = -1;
+	GLsizeiptr bestWaste = 0;
+	for (size_t i = 0; i < m_freeBlocks.size(); i++)
+	{
+		const BLOCK& block = m_freeBlocks[i];
+		GLintptr alignedOffset = AlignUp(block.offset, alignment);
+		GLsizeiptr padding = alignedOffset - block.offset;
+		if (padding + size <= block.size)
+		{
+			GLsizeiptr waste = block.size - size;
+			if ((bestBlock < 0) || (waste < bestWaste))
+			{
+				bestBlock = (int)i;
+				bestWaste = waste;
+			}
+		}
+	}
+
+	if (bestBlock < 0)
+	{
+		Grow(m_capacity + size + alignment);
+		return(Allocate(size, alignment));
+	}
+
+	// split the block into the padding, the allocation and the rest
+	BLOCK block = m_freeBlocks[bestBlock];
+	m_freeBlocks.erase(m_freeBlocks.begin() + bestBlock);
+	GLintptr alignedOffset = AlignUp(block.offset, alignment);
+	GLsizeiptr padding = alignedOffset - block.offset;
+	GLsizeiptr remainder = block.size - padding - size;
+	if (padding > 0)
+	{
+		AddFreeBlock(block.offset, padding);
+	}
+	if (remainder > 0)
+	{
+		AddFreeBlock(alignedOffset + size, remainder);
+	}
+
+	BLOCK allocation;
+	allocation.offset = alignedOffset;
+	allocation.size = size;
+	allocation.alignment = alignment;
+	allocation.bInUse = true;
+
+	int handle = 0;
+	if (m_freeHandles.empty() == false)
+	{
+		handle = m_freeHandles.back();
+		m_freeHandles.pop_back();
+		m_allocations[handle] = allocation;
+	}
+	else
+	{
+		handle = (int)m_allocations.size();
+		m_allocations.push_back(allocation);
+	}
+
+	return(handle);
+}
+
+/***********************************************************
+ *  Free()
+ *
+ *  This method is used for returning an allocated range to
+ *  the free list.  The handle must not be used again.
+ ***********************************************************/
+void BufferArena::Free(int handle)
+{
+	if ((handle < 0) || (handle >= (int)m_allocations.size()) ||
+		(m_allocations[handle].bInUse == false))
+	{
+		return;
+	}
+
+	BLOCK& allocation = m_allocations[handle];
+	AddFreeBlock(allocation.offset, allocation.size);
+	allocation.bInUse = false;
+	m_freeHandles.push_back(handle);
+}
+
+/***********************************************************
+ *  Write()
+ *
+ *  This method is used for writing data to the start of an
+ *  allocated range, clamped to the size of the range.
+ ***********************************************************/
+void BufferArena::Write(int handle, const void* pData, GLsizeiptr size)
+{
+	if ((handle < 0) || (handle >= (int)m_allocations.size()) ||
+		(m_allocations[handle].bInUse == false) || (NULL == pData))
+	{
+		return;
+	}
+
+	const BLOCK& allocation = m_allocations[handle];
+	glBindBuffer(GL_COPY_WRITE_BUFFER, m_bufferID);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, allocation.offset, std::min(size, allocation.size), pData);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+/***********************************************************
+ *  GetOffset()
+ *
+ *  This method is used for getting the offset in bytes of an
+ *  allocated range.  It changes when the arena is defragmented.
+ ***********************************************************/
+GLintptr BufferArena::GetOffset(int handle) const
+{
+	if ((handle < 0) || (handle >= (int)m_allocations.size()))
+	{
+		return(0);
+	}
+
+	return(m_allocations[handle].offset);
+}
+
+/***********************************************************
+ *  GetSize()
+ *
+ *  This method is used for getting the size in bytes of an
+ *  allocated range.
+ ***********************************************************/
+GLsizeiptr BufferArena::GetSize(int handle) const
+{
+	if ((handle < 0) || (handle >= (int)m_allocations.size()))
+	{
+		return(0);
+	}
+
+	return(m_allocations[handle].size);
+}
+
+/***********************************************************
+ *  Defragment()
+ *
+ *  This method is used for moving the allocations to the
+ *  start of the buffer in offset order, so apart from the
+ *  alignment padding the free space becomes one block at the
+ *  end.  The data is moved on the GPU and the offsets of the
+ *  handles are updated.  It returns whether anything moved.
+ ***********************************************************/
+bool BufferArena::Defragment()
+{
+	// the live allocations in the order they are in the buffer
+	std::vector<int> handles;
+	for (size_t i = 0; i < m_allocations.size(); i++)
+	{
+		if (m_allocations[i].bInUse == true)
+		{
+			handles.push_back((int)i);
+		}
+	}
+	std::sort(handles.begin(), handles.end(),
+		[this](int a, int b) { return(m_allocations[a].offset < m_allocations[b].offset); });
+
+	std::vector<BLOCK> sources;
+	std::vector<GLintptr> destinations;
+	GLintptr cursor = 0;
+	bool bMoved = false;
+	for (size_t i = 0; i < handles.size(); i++)
+	{
+		const BLOCK& allocation = m_allocations[handles[i]];
+		GLintptr destination = AlignUp(cursor, allocation.alignment);
+		if (destination != allocation.offset)
+		{
+			bMoved = true;
+		}
+		sources.push_back(allocation);
+		destinations.push_back(destination);
+		cursor = destination + allocation.size;
+	}
+
+	if (bMoved == false)
+	{
+		return(false);
+	}
+
+	Relocate(sources, destinations, m_capacity);
+	for (size_t i = 0; i < handles.size(); i++)
+	{
+		m_allocations[handles[i]].offset = destinations[i];
+	}
+
+	// only the alignment padding and the end stay free
+	m_freeBlocks.clear();
+	GLintptr end = 0;
+	for (size_t i = 0; i < handles.size(); i++)
+	{
+		if (destinations[i] > end)
+		{
+			AddFreeBlock(end, destinations[i] - end);
+		}
+		end = destinations[i] + sources[i].size;
+	}
+	if (end < m_capacity)
+	{
+		AddFreeBlock(end, m_capacity - end);
+	}
+	m_defragmentCount++;
+
+	return(true);
+}
+
+/***********************************************************
+ *  GetStats()
+ *
+ *  This method is used for getting the memory statistics of
+ *  the arena.  The free space is fragmented when the largest
+ *  free block is much smaller than all of the free bytes.
+ ***********************************************************/
+BufferArena::ARENA_STATS BufferArena::GetStats() const
+{
+	ARENA_STATS stats;
+	stats.capacity = m_capacity;
+	stats.usedBytes = 0;
+	stats.freeBytes = 0;
+	stats.largestFreeBlock = 0;
+	stats.allocationCount = 0;
+	stats.freeBlockCount = (int)m_freeBlocks.size();
+	stats.growCount = m_growCount;
+	stats.defragmentCount = m_defragmentCount;
+
+	for (size_t i = 0; i < m_allocations.size(); i++)
+	{
+		if (m_allocations[i].bInUse == true)
+		{
+			stats.usedBytes += m_allocations[i].size;
+			stats.allocationCount++;
+		}
+	}
+	for (size_t i = 0; i < m_freeBlocks.size(); i++)
+	{
+		stats.freeBytes += m_freeBlocks[i].size;
+		stats.largestFreeBlock = std::max(stats.largestFreeBlock, m_freeBlocks[i].size);
+	}
+
+	return(stats);
+}
+
+/***********************************************************
+ *  Grow()
+ *
+ *  This method is used for enlarging the buffer to at least
+ *  the passed in capacity, at least doubling it so a series
+ *  of allocations only grows it a few times.  The contents
+ *  keep their offsets and the new space is free.
+ ***********************************************************/
+void BufferArena::Grow(GLsizeiptr minimumCapacity)
+{
+	GLsizeiptr oldCapacity = m_capacity;
+	GLsizeiptr newCapacity = std::max(oldCapacity * 2, minimumCapacity);
+
+	std::vector<BLOCK> sources;
+	std::vector<GLintptr> destinations;
+	BLOCK wholeBuffer;
+	wholeBuffer.offset = 0;
+	wholeBuffer.size = oldCapacity;
+	wholeBuffer.alignment = 1;
+	wholeBuffer.bInUse = true;
+	sources.push_back(wholeBuffer);
+	destinations.push_back(0);
+
+	Relocate(sources, destinations, newCapacity);
+	m_capacity = newCapacity;
+	AddFreeBlock(oldCapacity, newCapacity - oldCapacity);
+	m_growCount++;
+}
+
+/***********************************************************
+ *  AddFreeBlock()
+ *
+ *  This method is used for inserting a range into the free
+ *  list at its offset and merging it with the free blocks
+ *  directly before and after it.
+ ***********************************************************/
+void BufferArena::AddFreeBlock(GLintptr offset, GLsizeiptr size)
+{
+	BLOCK block;
+	block.offset = offset;
+	block.size = size;
+	block.alignment = 1;
+	block.bInUse = false;
+
+	std::vector<BLOCK>::iterator next = std::lower_bound(
+		m_freeBlocks.begin(), m_freeBlocks.end(), block,
+		[](const BLOCK& a, const BLOCK& b) { return(a.offset < b.offset); });
+	size_t index = next - m_freeBlocks.begin();
+
+	// merge with the following block
+	if ((index < m_freeBlocks.size()) && (offset + size == m_freeBlocks[index].offset))
+	{
+		block.size += m_freeBlocks[index].size;
+		m_freeBlocks.erase(m_freeBlocks.begin() + index);
+	}
+	// merge with the preceding block
+	if ((index > 0) && (m_freeBlocks[index - 1].offset + m_freeBlocks[index - 1].size == offset))
+	{
+		m_freeBlocks[index - 1].size += block.size;
+		return;
+	}
+
+	m_freeBlocks.insert(m_freeBlocks.begin() + index, block);
+}
+
+/***********************************************************
+ *  Relocate()
+ *
+ *  This method is used for copying ranges of the buffer to
+ *  new offsets and resizing it.  The ranges are gathered into
+ *  a temporary buffer, the buffer is reallocated under the
+ *  same name and the gathered data is copied back, all on the
+ *  GPU, so vertex arrays that use the buffer stay valid.
+ ***********************************************************/
+void BufferArena::Relocate(
+	const std::vector<BLOCK>& sources,
+	const std::vector<GLintptr>& destinations,
+	GLsizeiptr newCapacity)
+{
+	GLsizeiptr usedSize = 0;
+	for (size_t i = 0; i < sources.size(); i++)
+	{
+		usedSize = std::max(usedSize, destinations[i] + sources[i].size);
+	}
+
+	GLuint temporaryID = 0;
+	if (usedSize > 0)
+	{
+		glGenBuffers(1, &temporaryID);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, temporaryID);
+		glBufferData(GL_COPY_WRITE_BUFFER, usedSize, NULL, GL_STATIC_COPY);
+		glBindBuffer(GL_COPY_READ_BUFFER, m_bufferID);
+		for (size_t i = 0; i < sources.size(); i++)
+		{
+			glCopyBufferSubData(
+				GL_COPY_READ_BUFFER,
+				GL_COPY_WRITE_BUFFER,
+				sources[i].offset,
+				destinations[i],
+				sources[i].size);
+		}
+	}
+
+	glBindBuffer(GL_COPY_WRITE_BUFFER, m_bufferID);
+	glBufferData(GL_COPY_WRITE_BUFFER, newCapacity, NULL, GL_STATIC_DRAW);
+
+	if (temporaryID != 0)
+	{
+		glBindBuffer(GL_COPY_READ_BUFFER, temporaryID);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, usedSize);
+		glDeleteBuffers(1, &temporaryID);
+	}
+
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
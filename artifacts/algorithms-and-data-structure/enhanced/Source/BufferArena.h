@@ -0,0 +1,107 @@
+///////////////////////////////////////////////////////////////////////////////
+// bufferarena.h
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <vector>
+
+/***********************************************************
+ *  BufferArena
+ *
+ *  This class sub-allocates one large OpenGL buffer.  Each
+ *  allocation is an offset and size in the buffer, found by a
+ *  best-fit search of a free list that is kept sorted by
+ *  offset, so freed neighbors merge back into one block.
+ *  Allocations are referred to by handle, since Defragment()
+ *  moves them to close the gaps between them.  The buffer
+ *  keeps the same name when it grows or is defragmented, so
+ *  vertex arrays that use it stay valid.
+ ***********************************************************/
+class BufferArena
+{
+public:
+	// constructor
+	BufferArena();
+	// destructor
+	~BufferArena();
+
+	// value of a handle that refers to no allocation
+	static const int INVALID_HANDLE = -1;
+
+	// memory statistics of the arena
+	struct ARENA_STATS
+	{
+		GLsizeiptr capacity;
+		GLsizeiptr usedBytes;
+		GLsizeiptr freeBytes;
+		GLsizeiptr largestFreeBlock;
+		int allocationCount;
+		int freeBlockCount;
+		int growCount;
+		int defragmentCount;
+	};
+
+	// create the buffer with the passed in capacity in bytes
+	void Create(GLsizeiptr capacity);
+	// release the buffer and every allocation
+	void Destroy();
+	// name of the buffer
+	GLuint GetBufferID() const;
+
+	// allocate a range with an aligned offset and get its handle
+	int Allocate(GLsizeiptr size, GLsizeiptr alignment);
+	// return a range to the free list
+	void Free(int handle);
+	// write data to the start of an allocated range
+	void Write(int handle, const void* pData, GLsizeiptr size);
+
+	// offset and size of an allocated range
+	GLintptr GetOffset(int handle) const;
+	GLsizeiptr GetSize(int handle) const;
+
+	// move the allocations together so the free space is one block
+	bool Defragment();
+	// get the memory statistics
+	ARENA_STATS GetStats() const;
+
+private:
+	// a range of the buffer
+	struct BLOCK
+	{
+		GLintptr offset;
+		GLsizeiptr size;
+		GLsizeiptr alignment;
+		bool bInUse;
+	};
+
+	// the arena cannot be shared between two objects
+	BufferArena(const BufferArena&);
+	BufferArena& operator=(const BufferArena&);
+
+	// buffer holding every allocation
+	GLuint m_bufferID;
+	GLsizeiptr m_capacity;
+	// allocations indexed by handle
+	std::vector<BLOCK> m_allocations;
+	// handles of released allocations, reused first
+	std::vector<int> m_freeHandles;
+	// unused ranges sorted by offset, never adjacent to each other
+	std::vector<BLOCK> m_freeBlocks;
+	// number of times the buffer grew and was defragmented
+	int m_growCount;
+	int m_defragmentCount;
+
+	// grow the buffer to at least the passed in capacity
+	void Grow(GLsizeiptr minimumCapacity);
+	// add a range to the free list, merging it with its neighbors
+	void AddFreeBlock(GLintptr offset, GLsizeiptr size);
+	// move ranges of the buffer to new offsets and resize it,
+	// keeping the name of the buffer
+	void Relocate(
+		const std::vector<BLOCK>& sources,
+		const std::vector<GLintptr>& destinations,
+		GLsizeiptr newCapacity);
+};
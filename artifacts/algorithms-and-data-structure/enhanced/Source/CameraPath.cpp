@@ -0,0 +1,251 @@
+///////////////////////////////////////////////////////////////////////////////
+// camerapath.cpp
+///////////////////////////////////////////////////////////////////////////////
+
+#include "CameraPath.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+// declaration of global variables
+namespace
+{
+	// settings for the built-in orbit around the table
+	const int DEFAULT_PATH_KEYFRAMES = 16;
+	const float DEFAULT_PATH_DURATION = 16.0f;
+	const float DEFAULT_PATH_RADIUS = 14.0f;
+	const float DEFAULT_PATH_HEIGHT = 5.0f;
+	const glm::vec3 DEFAULT_PATH_TARGET = glm::vec3(0.0f, -1.0f, 0.0f);
+}
+
+/***********************************************************
+ *  CameraPath()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+CameraPath::CameraPath()
+{
+}
+
+/***********************************************************
+ *  ~CameraPath()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+CameraPath::~CameraPath()
+{
+	m_keyframes.clear();
+}
+
+/***********************************************************
+ *  AddKeyframe()
+ *
+ *  This method is used to add a keyframe to the end of the
+ *  path.  Keyframes must be added in increasing time order.
+ ***********************************************************/
+void CameraPath::AddKeyframe(float time, glm::vec3 position, glm::vec3 front)
+{
+	CAMERA_KEYFRAME keyframe;
+	keyframe.time = time;
+	keyframe.position = position;
+	keyframe.front = front;
+	m_keyframes.push_back(keyframe);
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used to remove all of the keyframes.
+ ***********************************************************/
+void CameraPath::Clear()
+{
+	m_keyframes.clear();
+}
+
+/***********************************************************
+ *  CreateDefaultPath()
+ *
+ *  This method is used to build a closed orbit around the
+ *  table that always looks at the teapot.  It is used when
+ *  no recorded path file is supplied.
+ ***********************************************************/
+void CameraPath::CreateDefaultPath()
+{
+	Clear();
+
+	// the last keyframe repeats the first so the orbit loops smoothly
+	for (int i = 0; i <= DEFAULT_PATH_KEYFRAMES; i++)
+	{
+		float t = (float)i / (float)DEFAULT_PATH_KEYFRAMES;
+		float angle = t * glm::radians(360.0f);
+
+		glm::vec3 position = glm::vec3(
+			std::sin(angle) * DEFAULT_PATH_RADIUS,
+			DEFAULT_PATH_HEIGHT,
+			std::cos(angle) * DEFAULT_PATH_RADIUS);
+
+		AddKeyframe(
+			t * DEFAULT_PATH_DURATION,
+			position,
+			glm::normalize(DEFAULT_PATH_TARGET - position));
+	}
+}
+
+/***********************************************************
+ *  LoadFromFile()
+ *
+ *  This method is used to read the keyframes from a text file
+ *  with one keyframe per line in the following format:
+ *    time posX posY posZ frontX frontY frontZ
+ *  Empty lines and lines starting with '#' are skipped.
+ ***********************************************************/
+bool CameraPath::LoadFromFile(const char* filename)
+{
+	std::ifstream file(filename);
+	if (!file)
+	{
+		std::cout << "Could not open camera path:" << filename << std::endl;
+		return false;
+	}
+
+	Clear();
+
+	std::string line;
+	while (std::getline(file, line))
+	{
+		if ((line.empty() == true) || (line[0] == '#'))
+		{
+			continue;
+		}
+
+		std::istringstream values(line);
+		CAMERA_KEYFRAME keyframe;
+		if (values >> keyframe.time
+			>> keyframe.position.x >> keyframe.position.y >> keyframe.position.z
+			>> keyframe.front.x >> keyframe.front.y >> keyframe.front.z)
+		{
+			m_keyframes.push_back(keyframe);
+		}
+	}
+
+	// keep the keyframes in time order for the sampling search
+	std::stable_sort(m_keyframes.begin(), m_keyframes.end(),
+		[](const CAMERA_KEYFRAME& a, const CAMERA_KEYFRAME& b) { return a.time < b.time; });
+
+	std::cout << "Loaded camera path:" << filename << ", keyframes:" << m_keyframes.size() << std::endl;
+
+	return (m_keyframes.empty() == false);
+}
+
+/***********************************************************
+ *  SaveToFile()
+ *
+ *  This method is used to write the keyframes to a text file
+ *  that can be loaded again with LoadFromFile().
+ ***********************************************************/
+bool CameraPath::SaveToFile(const char* filename) const
+{
+	std::ofstream file(filename);
+	if (!file)
+	{
+		std::cout << "Could not write camera path:" << filename << std::endl;
+		return false;
+	}
+
+	file << "# time posX posY posZ frontX frontY frontZ\n";
+	for (size_t i = 0; i < m_keyframes.size(); i++)
+	{
+		const CAMERA_KEYFRAME& keyframe = m_keyframes[i];
+		file << keyframe.time << " "
+			<< keyframe.position.x << " " << keyframe.position.y << " " << keyframe.position.z << " "
+			<< keyframe.front.x << " " << keyframe.front.y << " " << keyframe.front.z << "\n";
+	}
+
+	std::cout << "Saved camera path:" << filename << ", keyframes:" << m_keyframes.size() << std::endl;
+
+	return true;
+}
+
+/***********************************************************
+ *  Sample()
+ *
+ *  This method is used to get the camera position and front
+ *  vector at the passed in time.  Times past the end of the
+ *  path wrap around so the path can be replayed endlessly.
+ ***********************************************************/
+bool CameraPath::Sample(float time, glm::vec3& position, glm::vec3& front) const
+{
+	if (m_keyframes.empty() == true)
+	{
+		return false;
+	}
+
+	if ((m_keyframes.size() == 1) || (GetDuration() <= 0.0f))
+	{
+		position = m_keyframes[0].position;
+		front = m_keyframes[0].front;
+		return true;
+	}
+
+	// wrap the time into the range covered by the keyframes
+	float startTime = m_keyframes.front().time;
+	float localTime = std::fmod(time, GetDuration());
+	if (localTime < 0.0f)
+	{
+		localTime += GetDuration();
+	}
+	localTime += startTime;
+
+	// binary search for the first keyframe after the time
+	std::vector<CAMERA_KEYFRAME>::const_iterator next = std::upper_bound(
+		m_keyframes.begin(), m_keyframes.end(), localTime,
+		[](float t, const CAMERA_KEYFRAME& keyframe) { return t < keyframe.time; });
+	if (next == m_keyframes.begin())
+	{
+		++next;
+	}
+	if (next == m_keyframes.end())
+	{
+		--next;
+	}
+	std::vector<CAMERA_KEYFRAME>::const_iterator previous = next - 1;
+
+	// linear interpolation between the two surrounding keyframes
+	float span = next->time - previous->time;
+	float blend = (span > 0.0f) ? (localTime - previous->time) / span : 0.0f;
+	blend = glm::clamp(blend, 0.0f, 1.0f);
+
+	position = glm::mix(previous->position, next->position, blend);
+	front = glm::normalize(glm::mix(previous->front, next->front, blend));
+
+	return true;
+}
+
+/***********************************************************
+ *  GetDuration()
+ *
+ *  This method is used to get the length of the path.
+ ***********************************************************/
+float CameraPath::GetDuration() const
+{
+	if (m_keyframes.size() < 2)
+	{
+		return 0.0f;
+	}
+
+	return (m_keyframes.back().time - m_keyframes.front().time);
+}
+
+/***********************************************************
+ *  GetKeyframeCount()
+ *
+ *  This method is used to get the number of keyframes.
+ ***********************************************************/
+int CameraPath::GetKeyframeCount() const
+{
+	return (int)m_keyframes.size();
+}
@@ -0,0 +1,57 @@
+///////////////////////////////////////////////////////////////////////////////
+// camerapath.h
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  CameraPath
+ *
+ *  This class contains a list of timed camera keyframes that
+ *  can be replayed to move the camera along a repeatable
+ *  path, or recorded from a live session and saved to a file.
+ ***********************************************************/
+class CameraPath
+{
+public:
+	// constructor
+	CameraPath();
+	// destructor
+	~CameraPath();
+
+	// properties for a single camera keyframe
+	struct CAMERA_KEYFRAME
+	{
+		float time;
+		glm::vec3 position;
+		glm::vec3 front;
+	};
+
+	// add a keyframe to the end of the path
+	void AddKeyframe(float time, glm::vec3 position, glm::vec3 front);
+	// remove all keyframes from the path
+	void Clear();
+
+	// build the built-in orbit around the table
+	void CreateDefaultPath();
+
+	// load and save the keyframes as plain text files
+	bool LoadFromFile(const char* filename);
+	bool SaveToFile(const char* filename) const;
+
+	// get the interpolated camera pose at the passed in time
+	bool Sample(float time, glm::vec3& position, glm::vec3& front) const;
+
+	// total length of the path in seconds
+	float GetDuration() const;
+	// number of keyframes in the path
+	int GetKeyframeCount() const;
+
+private:
+	// keyframes ordered by time
+	std::vector<CAMERA_KEYFRAME> m_keyframes;
+};
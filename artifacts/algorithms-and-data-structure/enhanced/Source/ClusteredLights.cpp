@@ -0,0 +1,445 @@
+///////////////////////////////////////////////////////////////////////////////
+// clusteredlights.cpp
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ClusteredLights.h"
+
+#include <algorithm>
+#include <cmath>
+
+// the shader reads each light as four RGBA32F texels
+static_assert(sizeof(ClusteredLights::POINT_LIGHT_DATA) == 4 * 16,
+	"light data must match the buffer texture layout");
+
+// declaration of global variables and functions
+namespace
+{
+	// closest view depth the slices start at, so the logarithm
+	// of the depth stays finite for orthographic projections
+	const float MIN_NEAR_DEPTH = 0.05f;
+	// view depth in front of the eye that a light box corner
+	// has to be at to be projected onto the screen
+	const float MIN_PROJECTED_DEPTH = 1.0e-4f;
+	// light indices the index buffer starts with
+	const int INITIAL_INDEX_CAPACITY = 4096;
+
+	/***********************************************************
+	 *  ToCell()
+	 *
+	 *  Get the grid cell of a normalized device coordinate,
+	 *  clamped to the grid.
+	 ***********************************************************/
+	int ToCell(float ndc, int cellCount)
+	{
+		int cell = (int)std::floor(((ndc * 0.5f) + 0.5f) * (float)cellCount);
+		return (std::max(0, std::min(cell, cellCount - 1)));
+	}
+}
+
+/***********************************************************
+ *  ClusteredLights()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ClusteredLights::ClusteredLights()
+{
+	m_lightBufferID = 0;
+	m_lightTextureID = 0;
+	m_gridBufferID = 0;
+	m_gridTextureID = 0;
+	m_indexBufferID = 0;
+	m_indexTextureID = 0;
+	m_indexCapacity = 0;
+	m_bLightsDirty = true;
+	m_nearDepth = MIN_NEAR_DEPTH;
+	m_sliceScale = 1.0f;
+	m_stats.lightCount = 0;
+	m_stats.lightIndices = 0;
+	m_stats.occupiedClusters = 0;
+	m_stats.maxClusterLights = 0;
+
+	m_clusterData.assign(CLUSTER_COUNT * 2, 0);
+}
+
+/***********************************************************
+ *  ~ClusteredLights()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ClusteredLights::~ClusteredLights()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  AddLight()
+ *
+ *  This method is used for adding a point light.  Its light
+ *  fades out to nothing at the passed in radius, and a radius
+ *  of zero makes a light that reaches the whole scene.
+ ***********************************************************/
+int ClusteredLights::AddLight(
+	glm::vec3 position,
+	glm::vec3 ambient,
+	glm::vec3 diffuse,
+	glm::vec3 specular,
+	float radius)
+{
+	POINT_LIGHT_DATA light;
+	light.positionRadius = glm::vec4(position, std::max(radius, 0.0f));
+	light.ambient = glm::vec4(ambient, 0.0f);
+	light.diffuse = glm::vec4(diffuse, 0.0f);
+	light.specular = glm::vec4(specular, 0.0f);
+	m_lights.push_back(light);
+	m_bLightsDirty = true;
+
+	return((int)m_lights.size() - 1);
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for removing all of the lights.
+ ***********************************************************/
+void ClusteredLights::Clear()
+{
+	m_lights.clear();
+	m_bLightsDirty = true;
+}
+
+/***********************************************************
+ *  GetLightCount()
+ *
+ *  This method is used for getting the number of lights.
+ ***********************************************************/
+int ClusteredLights::GetLightCount() const
+{
+	return((int)m_lights.size());
+}
+
+/***********************************************************
+ *  Build()
+ *
+ *  This method is used for binning the lights into the
+ *  clusters of the view.  The near and far depths are taken
+ *  from the projection, for both perspective and orthographic
+ *  views.  Every light is bounded by the range of clusters
+ *  that its box covers on the screen and in depth, then the
+ *  clusters are counted, given their offsets, and filled, so
+ *  the index list holds each cluster as one run.
+ ***********************************************************/
+void ClusteredLights::Build(const glm::mat4& view, const glm::mat4& projection)
+{
+	bool bPerspective = (std::fabs(projection[3][3]) < 0.5f);
+	float nearDepth = 0.0f;
+	float farDepth = 0.0f;
+	if (bPerspective == true)
+	{
+		nearDepth = projection[3][2] / (projection[2][2] - 1.0f);
+		farDepth = projection[3][2] / (projection[2][2] + 1.0f);
+	}
+	else
+	{
+		nearDepth = (projection[3][2] + 1.0f) / projection[2][2];
+		farDepth = (projection[3][2] - 1.0f) / projection[2][2];
+	}
+	m_nearDepth = std::max(nearDepth, MIN_NEAR_DEPTH);
+	farDepth = std::max(farDepth, m_nearDepth * 2.0f);
+	m_sliceScale = (float)CLUSTER_SLICES / std::log(farDepth / m_nearDepth);
+
+	// clusters reached by each light, with the count of every
+	// cluster kept in the second value of its pair
+	std::fill(m_clusterData.begin(), m_clusterData.end(), 0);
+	m_ranges.resize(m_lights.size());
+	for (size_t i = 0; i < m_lights.size(); i++)
+	{
+		CLUSTER_RANGE& range = m_ranges[i];
+		if (FindClusterRange(m_lights[i], view, projection, bPerspective, farDepth, range) == false)
+		{
+			range.firstSlice = 0;
+			range.lastSlice = -1;
+			continue;
+		}
+
+		for (int slice = range.firstSlice; slice <= range.lastSlice; slice++)
+		{
+			for (int row = range.firstRow; row <= range.lastRow; row++)
+			{
+				int cluster = (((slice * CLUSTER_ROWS) + row) * CLUSTER_COLUMNS) + range.firstColumn;
+				for (int column = range.firstColumn; column <= range.lastColumn; column++)
+				{
+					m_clusterData[(cluster++ * 2) + 1]++;
+				}
+			}
+		}
+	}
+
+	m_stats.lightCount = (int)m_lights.size();
+	m_stats.occupiedClusters = 0;
+	m_stats.maxClusterLights = 0;
+	int offset = 0;
+	for (int cluster = 0; cluster < CLUSTER_COUNT; cluster++)
+	{
+		int count = m_clusterData[(cluster * 2) + 1];
+		m_clusterData[cluster * 2] = offset;
+		offset += count;
+
+		if (count > 0)
+		{
+			m_stats.occupiedClusters++;
+		}
+		m_stats.maxClusterLights = std::max(m_stats.maxClusterLights, count);
+	}
+	m_stats.lightIndices = offset;
+
+	// fill the runs in light order, counting each cluster up again
+	m_lightIndices.resize((size_t)offset);
+	for (int cluster = 0; cluster < CLUSTER_COUNT; cluster++)
+	{
+		m_clusterData[(cluster * 2) + 1] = 0;
+	}
+	for (size_t i = 0; i < m_ranges.size(); i++)
+	{
+		const CLUSTER_RANGE& range = m_ranges[i];
+		for (int slice = range.firstSlice; slice <= range.lastSlice; slice++)
+		{
+			for (int row = range.firstRow; row <= range.lastRow; row++)
+			{
+				int cluster = (((slice * CLUSTER_ROWS) + row) * CLUSTER_COLUMNS) + range.firstColumn;
+				for (int column = range.firstColumn; column <= range.lastColumn; column++)
+				{
+					GLint* pCluster = &m_clusterData[cluster++ * 2];
+					m_lightIndices[pCluster[0] + pCluster[1]] = (GLint)i;
+					pCluster[1]++;
+				}
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  FindClusterRange()
+ *
+ *  This method is used for finding the range of clusters that
+ *  a light can reach.  The depth range is the view depth of
+ *  the light sphere, and the screen range covers the projected
+ *  corners of the box around it, which is conservative.  A
+ *  box reaching behind the eye covers the whole screen.  It
+ *  returns false when the light cannot be seen.
+ ***********************************************************/
+bool ClusteredLights::FindClusterRange(
+	const POINT_LIGHT_DATA& light,
+	const glm::mat4& view,
+	const glm::mat4& projection,
+	bool bPerspective,
+	float farDepth,
+	CLUSTER_RANGE& range) const
+{
+	float radius = light.positionRadius.w;
+	range.firstColumn = 0;
+	range.lastColumn = CLUSTER_COLUMNS - 1;
+	range.firstRow = 0;
+	range.lastRow = CLUSTER_ROWS - 1;
+	range.firstSlice = 0;
+	range.lastSlice = CLUSTER_SLICES - 1;
+
+	// lights without a radius reach every cluster
+	if (radius <= 0.0f)
+	{
+		return(true);
+	}
+
+	glm::vec3 center = glm::vec3(view * glm::vec4(glm::vec3(light.positionRadius), 1.0f));
+	float nearestDepth = -center.z - radius;
+	float farthestDepth = -center.z + radius;
+	if ((farthestDepth < m_nearDepth) || (nearestDepth > farDepth))
+	{
+		return(false);
+	}
+	range.firstSlice = GetSlice(nearestDepth);
+	range.lastSlice = GetSlice(farthestDepth);
+
+	if ((bPerspective == true) && (nearestDepth <= MIN_PROJECTED_DEPTH))
+	{
+		return(true);
+	}
+
+	glm::vec2 minimum = glm::vec2(1.0f);
+	glm::vec2 maximum = glm::vec2(-1.0f);
+	for (int corner = 0; corner < 8; corner++)
+	{
+		glm::vec3 offset = glm::vec3(
+			(corner & 1) ? radius : -radius,
+			(corner & 2) ? radius : -radius,
+			(corner & 4) ? radius : -radius);
+		glm::vec4 clip = projection * glm::vec4(center + offset, 1.0f);
+		glm::vec2 ndc = glm::vec2(clip.x / clip.w, clip.y / clip.w);
+
+		minimum = glm::min(minimum, ndc);
+		maximum = glm::max(maximum, ndc);
+	}
+	if ((maximum.x < -1.0f) || (minimum.x > 1.0f) ||
+		(maximum.y < -1.0f) || (minimum.y > 1.0f))
+	{
+		return(false);
+	}
+
+	range.firstColumn = ToCell(minimum.x, CLUSTER_COLUMNS);
+	range.lastColumn = ToCell(maximum.x, CLUSTER_COLUMNS);
+	range.firstRow = ToCell(minimum.y, CLUSTER_ROWS);
+	range.lastRow = ToCell(maximum.y, CLUSTER_ROWS);
+
+	return(true);
+}
+
+/***********************************************************
+ *  GetSlice()
+ *
+ *  This method is used for getting the depth slice of a view
+ *  depth, the same way the fragment shader finds it.
+ ***********************************************************/
+int ClusteredLights::GetSlice(float depth) const
+{
+	float clamped = std::max(depth, m_nearDepth);
+	int slice = (int)std::floor(std::log(clamped / m_nearDepth) * m_sliceScale);
+
+	return(std::max(0, std::min(slice, CLUSTER_SLICES - 1)));
+}
+
+/***********************************************************
+ *  Upload()
+ *
+ *  This method is used for writing the lights, when they have
+ *  changed, and the clusters of the frame into their GPU
+ *  buffers.  The cluster buffers are orphaned on every upload
+ *  so the CPU never waits on the previous frame, and the
+ *  index buffer only grows when there are more indices.
+ ***********************************************************/
+void ClusteredLights::Upload()
+{
+	if (m_lightBufferID == 0)
+	{
+		glGenBuffers(1, &m_lightBufferID);
+		glGenBuffers(1, &m_gridBufferID);
+		glGenBuffers(1, &m_indexBufferID);
+		glGenTextures(1, &m_lightTextureID);
+		glGenTextures(1, &m_gridTextureID);
+		glGenTextures(1, &m_indexTextureID);
+		m_indexCapacity = INITIAL_INDEX_CAPACITY;
+	}
+
+	if (m_bLightsDirty == true)
+	{
+		// an empty table still gets one light, so the buffer texture
+		// always has storage
+		POINT_LIGHT_DATA unused = POINT_LIGHT_DATA();
+		const POINT_LIGHT_DATA* pData = m_lights.empty() ? &unused : &m_lights[0];
+		size_t lightCount = m_lights.empty() ? 1 : m_lights.size();
+
+		glBindBuffer(GL_TEXTURE_BUFFER, m_lightBufferID);
+		glBufferData(GL_TEXTURE_BUFFER, lightCount * sizeof(POINT_LIGHT_DATA), pData, GL_STATIC_DRAW);
+		glBindTexture(GL_TEXTURE_BUFFER, m_lightTextureID);
+		glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, m_lightBufferID);
+		m_bLightsDirty = false;
+	}
+
+	glBindBuffer(GL_TEXTURE_BUFFER, m_gridBufferID);
+	glBufferData(GL_TEXTURE_BUFFER, m_clusterData.size() * sizeof(GLint), &m_clusterData[0], GL_STREAM_DRAW);
+	glBindTexture(GL_TEXTURE_BUFFER, m_gridTextureID);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_RG32I, m_gridBufferID);
+
+	int indexCount = (int)m_lightIndices.size();
+	if (indexCount > m_indexCapacity)
+	{
+		m_indexCapacity = indexCount * 2;
+	}
+	glBindBuffer(GL_TEXTURE_BUFFER, m_indexBufferID);
+	glBufferData(GL_TEXTURE_BUFFER, m_indexCapacity * sizeof(GLint), NULL, GL_STREAM_DRAW);
+	if (indexCount > 0)
+	{
+		glBufferSubData(GL_TEXTURE_BUFFER, 0, indexCount * sizeof(GLint), &m_lightIndices[0]);
+	}
+	glBindTexture(GL_TEXTURE_BUFFER, m_indexTextureID);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_R32I, m_indexBufferID);
+
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+/***********************************************************
+ *  Bind()
+ *
+ *  This method is used for binding the light table, the
+ *  cluster grid and the light index list to their texture
+ *  units, where they stay for the rest of the run.
+ ***********************************************************/
+void ClusteredLights::Bind(int lightUnit, int gridUnit, int indexUnit) const
+{
+	glActiveTexture(GL_TEXTURE0 + lightUnit);
+	glBindTexture(GL_TEXTURE_BUFFER, m_lightTextureID);
+	glActiveTexture(GL_TEXTURE0 + gridUnit);
+	glBindTexture(GL_TEXTURE_BUFFER, m_gridTextureID);
+	glActiveTexture(GL_TEXTURE0 + indexUnit);
+	glBindTexture(GL_TEXTURE_BUFFER, m_indexTextureID);
+	glActiveTexture(GL_TEXTURE0);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for releasing the GPU buffers and the
+ *  buffer textures.
+ ***********************************************************/
+void ClusteredLights::Destroy()
+{
+	GLuint textures[3] = { m_lightTextureID, m_gridTextureID, m_indexTextureID };
+	GLuint buffers[3] = { m_lightBufferID, m_gridBufferID, m_indexBufferID };
+	if (m_lightBufferID != 0)
+	{
+		glDeleteTextures(3, textures);
+		glDeleteBuffers(3, buffers);
+	}
+
+	m_lightBufferID = 0;
+	m_lightTextureID = 0;
+	m_gridBufferID = 0;
+	m_gridTextureID = 0;
+	m_indexBufferID = 0;
+	m_indexTextureID = 0;
+	m_indexCapacity = 0;
+	m_bLightsDirty = true;
+}
+
+/***********************************************************
+ *  GetNearDepth()
+ *
+ *  This method is used for getting the view depth where the
+ *  first depth slice starts.
+ ***********************************************************/
+float ClusteredLights::GetNearDepth() const
+{
+	return(m_nearDepth);
+}
+
+/***********************************************************
+ *  GetSliceScale()
+ *
+ *  This method is used for getting the number of slices per
+ *  unit of the logarithm of the view depth, which together
+ *  with the near depth lets the shader find its slice.
+ ***********************************************************/
+float ClusteredLights::GetSliceScale() const
+{
+	return(m_sliceScale);
+}
+
+/***********************************************************
+ *  GetStats()
+ *
+ *  This method is used for getting the statistics of the
+ *  most recent binning.
+ ***********************************************************/
+const ClusteredLights::CLUSTER_STATS& ClusteredLights::GetStats() const
+{
+	return(m_stats);
+}
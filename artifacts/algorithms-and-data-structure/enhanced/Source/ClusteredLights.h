@@ -0,0 +1,135 @@
+///////////////////////////////////////////////////////////////////////////////
+// clusteredlights.h
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  ClusteredLights
+ *
+ *  This class holds the point lights of the scene and bins
+ *  them into a grid of view-space clusters every frame, so a
+ *  fragment only shades the lights that can reach it.  The
+ *  clusters split the screen into tiles and the view depth
+ *  into slices that grow exponentially with the distance.
+ *  The lights, the offset and count of every cluster, and
+ *  the light index list of the clusters are read by the
+ *  fragment shader through buffer textures, so the shaders
+ *  can stay at GLSL 3.30.
+ ***********************************************************/
+class ClusteredLights
+{
+public:
+	// constructor
+	ClusteredLights();
+	// destructor
+	~ClusteredLights();
+
+	// size of the cluster grid, which must match the fragment shader
+	static const int CLUSTER_COLUMNS = 16;
+	static const int CLUSTER_ROWS = 9;
+	static const int CLUSTER_SLICES = 24;
+	static const int CLUSTER_COUNT = CLUSTER_COLUMNS * CLUSTER_ROWS * CLUSTER_SLICES;
+
+	// one point light, read by the shader as four RGBA32F texels
+	struct POINT_LIGHT_DATA
+	{
+		// a radius of zero reaches every cluster
+		glm::vec4 positionRadius;
+		glm::vec4 ambient;
+		glm::vec4 diffuse;
+		glm::vec4 specular;
+	};
+
+	// statistics of the most recent binning
+	struct CLUSTER_STATS
+	{
+		int lightCount;
+		int lightIndices;
+		int occupiedClusters;
+		int maxClusterLights;
+	};
+
+	// add a point light and get its index
+	int AddLight(
+		glm::vec3 position,
+		glm::vec3 ambient,
+		glm::vec3 diffuse,
+		glm::vec3 specular,
+		float radius);
+	// remove all of the lights
+	void Clear();
+	// number of lights
+	int GetLightCount() const;
+
+	// bin the lights into the clusters of the passed in view
+	void Build(const glm::mat4& view, const glm::mat4& projection);
+	// write the lights and the clusters into the GPU buffers
+	void Upload();
+	// bind the light table, cluster grid and light index list
+	void Bind(int lightUnit, int gridUnit, int indexUnit) const;
+	// release the GPU buffers
+	void Destroy();
+
+	// view depth where the first slice starts
+	float GetNearDepth() const;
+	// slices per unit of the logarithm of the view depth
+	float GetSliceScale() const;
+	// get the statistics of the most recent binning
+	const CLUSTER_STATS& GetStats() const;
+
+private:
+	// clusters reached by one light
+	struct CLUSTER_RANGE
+	{
+		int firstColumn;
+		int lastColumn;
+		int firstRow;
+		int lastRow;
+		int firstSlice;
+		int lastSlice;
+	};
+
+	// the point lights of the scene
+	std::vector<POINT_LIGHT_DATA> m_lights;
+	// first index and light count of every cluster
+	std::vector<GLint> m_clusterData;
+	// lights of the clusters, one run per cluster
+	std::vector<GLint> m_lightIndices;
+	// clusters reached by each light in the current frame
+	std::vector<CLUSTER_RANGE> m_ranges;
+
+	// buffers and the buffer textures reading them
+	GLuint m_lightBufferID;
+	GLuint m_lightTextureID;
+	GLuint m_gridBufferID;
+	GLuint m_gridTextureID;
+	GLuint m_indexBufferID;
+	GLuint m_indexTextureID;
+	// number of light indices the index buffer was allocated for
+	int m_indexCapacity;
+	// the lights changed since the last upload
+	bool m_bLightsDirty;
+
+	// depth slicing of the current frame
+	float m_nearDepth;
+	float m_sliceScale;
+	// statistics of the most recent binning
+	CLUSTER_STATS m_stats;
+
+	// find the clusters that a light can reach
+	bool FindClusterRange(
+		const POINT_LIGHT_DATA& light,
+		const glm::mat4& view,
+		const glm::mat4& projection,
+		bool bPerspective,
+		float farDepth,
+		CLUSTER_RANGE& range) const;
+	// get the slice of a view depth
+	int GetSlice(float depth) const;
+};
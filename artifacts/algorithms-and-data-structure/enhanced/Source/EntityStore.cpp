@@ -0,0 +1,534 @@
+///////////////////////////////////////////////////////////////////////////////
+// entitystore.cpp
+///////////////////////////////////////////////////////////////////////////////
+
+#include "EntityStore.h"
+#include "RenderQueue.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+// declaration of global variables and functions
+namespace
+{
+	// fraction of the screen height that the bounding sphere of
+	// an entity has to cover for each detail level, finest first
+	const float LOD_SCREEN_SIZES[] = { 0.12f, 0.03f };
+	const int LOD_SCREEN_SIZE_COUNT = sizeof(LOD_SCREEN_SIZES) / sizeof(LOD_SCREEN_SIZES[0]);
+	// how far past a level boundary the size has to move before
+	// the level changes, so an entity near it does not flicker
+	const float LOD_HYSTERESIS = 0.2f;
+}
+
+/***********************************************************
+ *  EntityStore()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+EntityStore::EntityStore()
+{
+	m_firstNewEntity = 0;
+}
+
+/***********************************************************
+ *  ~EntityStore()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+EntityStore::~EntityStore()
+{
+	Clear();
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for removing all of the entities.
+ ***********************************************************/
+void EntityStore::Clear()
+{
+	m_nodes.clear();
+	m_meshes.clear();
+	m_textures.clear();
+	m_materials.clear();
+	m_worldMatrices.clear();
+	m_localCenterX.clear();
+	m_localCenterY.clear();
+	m_localCenterZ.clear();
+	m_localRadius.clear();
+	m_sphereX.clear();
+	m_sphereY.clear();
+	m_sphereZ.clear();
+	m_sphereRadius.clear();
+	m_visible.clear();
+	m_lods.clear();
+	m_nodeEntities.clear();
+	m_firstNewEntity = 0;
+
+	m_visibleEntities.clear();
+	m_sortEntries.clear();
+	m_sortScratch.clear();
+	m_batchMatrices.clear();
+	m_batches.clear();
+}
+
+/***********************************************************
+ *  Reserve()
+ *
+ *  This method is used for reserving the memory of all of the
+ *  per-entity arrays up front, so that a large scene is not
+ *  built through repeated reallocation.
+ ***********************************************************/
+void EntityStore::Reserve(int entityCount)
+{
+	if (entityCount <= 0)
+	{
+		return;
+	}
+
+	m_nodes.reserve(entityCount);
+	m_meshes.reserve(entityCount);
+	m_textures.reserve(entityCount);
+	m_materials.reserve(entityCount);
+	m_worldMatrices.reserve(entityCount);
+	m_localCenterX.reserve(entityCount);
+	m_localCenterY.reserve(entityCount);
+	m_localCenterZ.reserve(entityCount);
+	m_localRadius.reserve(entityCount);
+	m_sphereX.reserve(entityCount);
+	m_sphereY.reserve(entityCount);
+	m_sphereZ.reserve(entityCount);
+	m_sphereRadius.reserve(entityCount);
+	m_visible.reserve(entityCount);
+	m_lods.reserve(entityCount);
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method is used for adding an entity.  Each scene
+ *  graph node draws at most one entity, so a second entity
+ *  on a node is rejected with -1 rather than taking the
+ *  node's transform updates from the first.  The world values
+ *  of the entity are filled in by the next UpdateTransforms().
+ ***********************************************************/
+int EntityStore::Create(
+	int nodeIndex,
+	int mesh,
+	int textureHandle,
+	int materialIndex,
+	glm::vec3 localCenter,
+	float localRadius)
+{
+	if (nodeIndex < 0)
+	{
+		return(-1);
+	}
+	if ((nodeIndex < (int)m_nodeEntities.size()) && (m_nodeEntities[nodeIndex] >= 0))
+	{
+		std::cout << "ERROR: scene graph node " << nodeIndex
+			<< " already draws an entity" << std::endl;
+		return(-1);
+	}
+
+	int entity = (int)m_nodes.size();
+
+	m_nodes.push_back(nodeIndex);
+	m_meshes.push_back(mesh);
+	m_textures.push_back(textureHandle);
+	m_materials.push_back(materialIndex);
+	m_worldMatrices.push_back(glm::mat4(1.0f));
+	m_localCenterX.push_back(localCenter.x);
+	m_localCenterY.push_back(localCenter.y);
+	m_localCenterZ.push_back(localCenter.z);
+	m_localRadius.push_back(localRadius);
+	m_sphereX.push_back(localCenter.x);
+	m_sphereY.push_back(localCenter.y);
+	m_sphereZ.push_back(localCenter.z);
+	m_sphereRadius.push_back(localRadius);
+	m_visible.push_back(1);
+	m_lods.push_back(0);
+
+	if (nodeIndex >= (int)m_nodeEntities.size())
+	{
+		m_nodeEntities.resize(nodeIndex + 1, -1);
+	}
+	m_nodeEntities[nodeIndex] = entity;
+
+	return(entity);
+}
+
+/***********************************************************
+ *  GetCount()
+ *
+ *  This method is used for getting the number of entities.
+ ***********************************************************/
+int EntityStore::GetCount() const
+{
+	return((int)m_nodes.size());
+}
+
+/***********************************************************
+ *  UpdateTransforms()
+ *
+ *  This method is used for refreshing the world values of the
+ *  entities after the scene graph update.  Only the entities
+ *  of rebuilt nodes and newly created entities are touched,
+ *  and since both the nodes and the entities are created in
+ *  depth-first order the writes move forward through memory.
+ ***********************************************************/
+int EntityStore::UpdateTransforms(const SceneGraph& sceneGraph)
+{
+	int entityCount = (int)m_nodes.size();
+	int refreshCount = 0;
+
+	const std::vector<int>& updatedNodes = sceneGraph.GetUpdatedNodes();
+	for (size_t i = 0; i < updatedNodes.size(); i++)
+	{
+		int node = updatedNodes[i];
+		if (node >= (int)m_nodeEntities.size())
+		{
+			break;
+		}
+
+		int entity = m_nodeEntities[node];
+		if ((entity >= 0) && (entity < m_firstNewEntity))
+		{
+			RefreshEntity(entity, sceneGraph.GetWorldMatrix(node));
+			refreshCount++;
+		}
+	}
+
+	// new entities take the current world matrix of their node
+	for (int entity = m_firstNewEntity; entity < entityCount; entity++)
+	{
+		RefreshEntity(entity, sceneGraph.GetWorldMatrix(m_nodes[entity]));
+		refreshCount++;
+	}
+	m_firstNewEntity = entityCount;
+
+	return(refreshCount);
+}
+
+/***********************************************************
+ *  Cull()
+ *
+ *  This method is used for testing the bounding spheres of all
+ *  of the entities in one batch and collecting the indices of
+ *  the visible entities in order.
+ ***********************************************************/
+int EntityStore::Cull(const FrustumCuller* pCuller)
+{
+	int entityCount = (int)m_nodes.size();
+
+	m_visibleEntities.clear();
+	if (entityCount == 0)
+	{
+		return(0);
+	}
+
+	if (NULL != pCuller)
+	{
+		pCuller->TestSpheres(
+			&m_sphereX[0],
+			&m_sphereY[0],
+			&m_sphereZ[0],
+			&m_sphereRadius[0],
+			entityCount,
+			&m_visible[0]);
+	}
+	else
+	{
+		std::fill(m_visible.begin(), m_visible.end(), (unsigned char)1);
+	}
+
+	m_visibleEntities.reserve(entityCount);
+	for (int entity = 0; entity < entityCount; entity++)
+	{
+		if (m_visible[entity] != 0)
+		{
+			m_visibleEntities.push_back(entity);
+		}
+	}
+
+	return((int)m_visibleEntities.size());
+}
+
+/***********************************************************
+ *  SelectLods()
+ *
+ *  This method is used for choosing the mesh detail level of
+ *  every visible entity.  The size of an entity is the part of
+ *  the screen height its bounding sphere covers, and it picks
+ *  the finest level whose threshold that size reaches.  A
+ *  boundary is moved away from the level the entity already
+ *  has by the hysteresis, so an entity has to grow or shrink
+ *  clearly past it before its level changes.
+ ***********************************************************/
+void EntityStore::SelectLods(
+	const glm::mat4& projection,
+	glm::vec3 viewPosition,
+	const int* meshLodCounts,
+	int meshCount)
+{
+	// a perspective projection scales by the inverse distance,
+	// an orthographic one does not depend on the distance
+	bool bPerspective = (projection[2][3] != 0.0f);
+	float projectionScale = std::fabs(projection[1][1]);
+
+	for (size_t i = 0; i < m_visibleEntities.size(); i++)
+	{
+		int entity = m_visibleEntities[i];
+		int mesh = m_meshes[entity];
+
+		int lodCount = 1;
+		if ((mesh >= 0) && (mesh < meshCount))
+		{
+			lodCount = std::min(meshLodCounts[mesh], LOD_SCREEN_SIZE_COUNT + 1);
+		}
+		if (lodCount <= 1)
+		{
+			m_lods[entity] = 0;
+			continue;
+		}
+
+		float radius = m_sphereRadius[entity];
+		float screenSize = radius * projectionScale;
+		if (bPerspective == true)
+		{
+			float dx = m_sphereX[entity] - viewPosition.x;
+			float dy = m_sphereY[entity] - viewPosition.y;
+			float dz = m_sphereZ[entity] - viewPosition.z;
+			float distance = std::sqrt((dx * dx) + (dy * dy) + (dz * dz));
+
+			// a camera inside the sphere always gets the full level
+			screenSize = (distance > radius) ? (screenSize / distance) : 1.0f;
+		}
+
+		int currentLod = std::min((int)m_lods[entity], lodCount - 1);
+		int lod = lodCount - 1;
+		for (int level = 0; level < lodCount - 1; level++)
+		{
+			float threshold = LOD_SCREEN_SIZES[level];
+			threshold *= (currentLod > level) ? (1.0f + LOD_HYSTERESIS) : (1.0f - LOD_HYSTERESIS);
+			if (screenSize >= threshold)
+			{
+				lod = level;
+				break;
+			}
+		}
+		m_lods[entity] = (unsigned char)lod;
+	}
+}
+
+/***********************************************************
+ *  ResetLods()
+ *
+ *  This method is used for drawing every entity at the full
+ *  detail level.
+ ***********************************************************/
+void EntityStore::ResetLods()
+{
+	std::fill(m_lods.begin(), m_lods.end(), (unsigned char)0);
+}
+
+/***********************************************************
+ *  BuildBatches()
+ *
+ *  This method is used for grouping the visible entities into
+ *  draw batches.  Each entity gets the same sort key as a
+ *  queued draw, so sorting puts the entities that share their
+ *  state next to each other, front to back.  Every run of
+ *  entities with the same mesh, detail level, texture and
+ *  material then becomes one batch with its model matrices
+ *  packed together.
+ *  Without sorting, only neighboring entities are batched.
+ ***********************************************************/
+void EntityStore::BuildBatches(glm::vec3 viewPosition, bool bSort)
+{
+	int visibleCount = (int)m_visibleEntities.size();
+
+	m_sortEntries.resize(visibleCount);
+	for (int i = 0; i < visibleCount; i++)
+	{
+		int entity = m_visibleEntities[i];
+
+		float dx = m_sphereX[entity] - viewPosition.x;
+		float dy = m_sphereY[entity] - viewPosition.y;
+		float dz = m_sphereZ[entity] - viewPosition.z;
+		float depth = (dx * dx) + (dy * dy) + (dz * dz);
+
+		// the program depends on the instance count of the batch,
+		// so it is chosen once the batch is queued
+		m_sortEntries[i].key = RenderQueue::MakeSortKey(
+			0,
+			m_textures[entity],
+			m_materials[entity],
+			m_meshes[entity],
+			m_lods[entity],
+			depth);
+		m_sortEntries[i].entity = entity;
+	}
+
+	if (bSort == true)
+	{
+		SortEntries();
+	}
+
+	m_batches.clear();
+	m_batchMatrices.resize(visibleCount);
+	int previous = -1;
+	for (int i = 0; i < visibleCount; i++)
+	{
+		int entity = m_sortEntries[i].entity;
+
+		// the depth is kept in the low 32 bits of the key
+		float depth = 0.0f;
+		uint32_t depthBits = (uint32_t)(m_sortEntries[i].key & 0xFFFFFFFFu);
+		std::memcpy(&depth, &depthBits, sizeof(depth));
+
+		bool bNewBatch = (previous < 0) ||
+			(m_meshes[entity] != m_meshes[previous]) ||
+			(m_lods[entity] != m_lods[previous]) ||
+			(m_textures[entity] != m_textures[previous]) ||
+			(m_materials[entity] != m_materials[previous]);
+		if (bNewBatch == true)
+		{
+			DRAW_BATCH batch;
+			batch.mesh = m_meshes[entity];
+			batch.lod = m_lods[entity];
+			batch.textureHandle = m_textures[entity];
+			batch.materialIndex = m_materials[entity];
+			batch.firstMatrix = i;
+			batch.instanceCount = 0;
+			batch.depth = depth;
+			m_batches.push_back(batch);
+		}
+
+		DRAW_BATCH& batch = m_batches.back();
+		batch.instanceCount++;
+		batch.depth = std::min(batch.depth, depth);
+
+		m_batchMatrices[i] = m_worldMatrices[entity];
+		previous = entity;
+	}
+}
+
+/***********************************************************
+ *  GetBatches()
+ *
+ *  This method is used for getting the draw batches built by
+ *  the last BuildBatches().
+ ***********************************************************/
+const std::vector<EntityStore::DRAW_BATCH>& EntityStore::GetBatches() const
+{
+	return(m_batches);
+}
+
+/***********************************************************
+ *  GetBatchMatrices()
+ *
+ *  This method is used for getting the model matrices of one
+ *  of the draw batches.
+ ***********************************************************/
+const glm::mat4* EntityStore::GetBatchMatrices(const DRAW_BATCH& batch) const
+{
+	return(&m_batchMatrices[batch.firstMatrix]);
+}
+
+/***********************************************************
+ *  SortEntries()
+ *
+ *  This method is used for ordering the sort entries by their
+ *  keys with a least significant digit radix sort, one byte
+ *  of the key per pass.  Every pass is stable, so entities
+ *  with equal keys stay in index order and frames are
+ *  repeatable.  A byte that is the same in every key, which is
+ *  common for the state bits of a scene with few materials,
+ *  would not move anything and its pass is skipped.
+ ***********************************************************/
+void EntityStore::SortEntries()
+{
+	const int RADIX_BITS = 8;
+	const int RADIX_SIZE = 1 << RADIX_BITS;
+	const int PASS_COUNT = 64 / RADIX_BITS;
+
+	size_t entryCount = m_sortEntries.size();
+	if (entryCount < 2)
+	{
+		return;
+	}
+
+	// count the digits of every pass in one read of the keys,
+	// into counts that are kept so no frame allocates them
+	m_sortCounts.assign(PASS_COUNT * RADIX_SIZE, 0);
+	std::vector<size_t>& counts = m_sortCounts;
+	for (size_t i = 0; i < entryCount; i++)
+	{
+		uint64_t key = m_sortEntries[i].key;
+		for (int pass = 0; pass < PASS_COUNT; pass++)
+		{
+			counts[(pass * RADIX_SIZE) + (int)((key >> (pass * RADIX_BITS)) & (RADIX_SIZE - 1))]++;
+		}
+	}
+
+	m_sortScratch.resize(entryCount);
+	for (int pass = 0; pass < PASS_COUNT; pass++)
+	{
+		size_t* passCounts = &counts[pass * RADIX_SIZE];
+		int shift = pass * RADIX_BITS;
+
+		// skip the pass when every key has the same digit
+		int digit = (int)((m_sortEntries[0].key >> shift) & (RADIX_SIZE - 1));
+		if (passCounts[digit] == entryCount)
+		{
+			continue;
+		}
+
+		// turn the counts into the first output slot of each digit
+		size_t offset = 0;
+		for (int bucket = 0; bucket < RADIX_SIZE; bucket++)
+		{
+			size_t count = passCounts[bucket];
+			passCounts[bucket] = offset;
+			offset += count;
+		}
+
+		for (size_t i = 0; i < entryCount; i++)
+		{
+			const SORT_ENTRY& entry = m_sortEntries[i];
+			m_sortScratch[passCounts[(int)((entry.key >> shift) & (RADIX_SIZE - 1))]++] = entry;
+		}
+		m_sortEntries.swap(m_sortScratch);
+	}
+}
+
+/***********************************************************
+ *  RefreshEntity()
+ *
+ *  This method is used for storing the world matrix of an
+ *  entity and moving its local bounding sphere into world
+ *  space.  The radius grows with the largest axis scale.
+ ***********************************************************/
+void EntityStore::RefreshEntity(int entity, const glm::mat4& worldMatrix)
+{
+	m_worldMatrices[entity] = worldMatrix;
+
+	float scaleSquared = std::max(
+		glm::dot(glm::vec3(worldMatrix[0]), glm::vec3(worldMatrix[0])),
+		std::max(
+			glm::dot(glm::vec3(worldMatrix[1]), glm::vec3(worldMatrix[1])),
+			glm::dot(glm::vec3(worldMatrix[2]), glm::vec3(worldMatrix[2]))));
+	glm::vec4 center = worldMatrix * glm::vec4(
+		m_localCenterX[entity],
+		m_localCenterY[entity],
+		m_localCenterZ[entity],
+		1.0f);
+
+	m_sphereX[entity] = center.x;
+	m_sphereY[entity] = center.y;
+	m_sphereZ[entity] = center.z;
+	m_sphereRadius[entity] = m_localRadius[entity] * std::sqrt(scaleSquared);
+}
@@ -0,0 +1,141 @@
+///////////////////////////////////////////////////////////////////////////////
+// entitystore.h
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "FrustumCuller.h"
+#include "SceneGraph.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  EntityStore
+ *
+ *  This class contains the drawable entities of the scene.
+ *  Every value of an entity - its scene graph node, world
+ *  matrix, bounding sphere, mesh, texture and material - is
+ *  kept in its own array indexed by the entity, so each pass
+ *  over the entities only streams through the values it
+ *  reads.  The matrix pass refreshes the entities whose nodes
+ *  moved, the cull pass tests all of the bounding spheres in
+ *  one batch, the detail pass picks a mesh level for every
+ *  visible entity from its size on screen, and the sort pass
+ *  groups the visible entities that share a mesh, level,
+ *  texture and material into instanced draw batches.
+ ***********************************************************/
+class EntityStore
+{
+public:
+	// constructor
+	EntityStore();
+	// destructor
+	~EntityStore();
+
+	// visible entities that share their state, drawn as one
+	// instanced draw
+	struct DRAW_BATCH
+	{
+		int mesh;
+		int lod;
+		int textureHandle;
+		int materialIndex;
+		int firstMatrix;
+		int instanceCount;
+		float depth;
+	};
+
+	// remove all of the entities
+	void Clear();
+	// reserve memory for the passed in number of entities
+	void Reserve(int entityCount);
+
+	// add an entity drawn at a scene graph node with a local
+	// bounding sphere, and get its index
+	int Create(
+		int nodeIndex,
+		int mesh,
+		int textureHandle,
+		int materialIndex,
+		glm::vec3 localCenter,
+		float localRadius);
+
+	// number of entities
+	int GetCount() const;
+
+	// copy the world matrices of the nodes rebuilt by the last
+	// scene graph update and recompute their bounding spheres,
+	// and return the number of entities refreshed
+	int UpdateTransforms(const SceneGraph& sceneGraph);
+
+	// test every bounding sphere against the frustum, or mark
+	// every entity visible when no culler is passed in, and
+	// return the number of visible entities
+	int Cull(const FrustumCuller* pCuller);
+
+	// choose the mesh detail level of every visible entity from
+	// the screen height covered by its bounding sphere, given the
+	// number of levels of each mesh
+	void SelectLods(
+		const glm::mat4& projection,
+		glm::vec3 viewPosition,
+		const int* meshLodCounts,
+		int meshCount);
+	// draw every entity at the full detail level
+	void ResetLods();
+
+	// group the visible entities into draw batches, sorted by
+	// state and then front to back when sorting is requested
+	void BuildBatches(glm::vec3 viewPosition, bool bSort);
+
+	// the draw batches of the last BuildBatches()
+	const std::vector<DRAW_BATCH>& GetBatches() const;
+	// the model matrices of a draw batch
+	const glm::mat4* GetBatchMatrices(const DRAW_BATCH& batch) const;
+
+private:
+	// sort key of a visible entity
+	struct SORT_ENTRY
+	{
+		uint64_t key;
+		int entity;
+	};
+
+	// per-entity values, one array for each
+	std::vector<int> m_nodes;
+	std::vector<int> m_meshes;
+	std::vector<int> m_textures;
+	std::vector<int> m_materials;
+	std::vector<glm::mat4> m_worldMatrices;
+	std::vector<float> m_localCenterX;
+	std::vector<float> m_localCenterY;
+	std::vector<float> m_localCenterZ;
+	std::vector<float> m_localRadius;
+	std::vector<float> m_sphereX;
+	std::vector<float> m_sphereY;
+	std::vector<float> m_sphereZ;
+	std::vector<float> m_sphereRadius;
+	std::vector<unsigned char> m_visible;
+	std::vector<unsigned char> m_lods;
+
+	// entity drawn at each scene graph node, or -1
+	std::vector<int> m_nodeEntities;
+	// first entity that has not been refreshed since it was created
+	int m_firstNewEntity;
+
+	// per-frame working arrays
+	std::vector<int> m_visibleEntities;
+	std::vector<SORT_ENTRY> m_sortEntries;
+	std::vector<SORT_ENTRY> m_sortScratch;
+	std::vector<size_t> m_sortCounts;
+	std::vector<glm::mat4> m_batchMatrices;
+	std::vector<DRAW_BATCH> m_batches;
+
+	// order the sort entries by their keys
+	void SortEntries();
+	// copy a world matrix into an entity and recompute its sphere
+	void RefreshEntity(int entity, const glm::mat4& worldMatrix);
+};
@@ -0,0 +1,247 @@
+///////////////////////////////////////////////////////////////////////////////
+// frameprofiler.cpp
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FrameProfiler.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+// declaration of global functions
+namespace
+{
+	/***********************************************************
+	 *  Percentile()
+	 *
+	 *  Nearest-rank percentile of an already sorted sample list.
+	 ***********************************************************/
+	double Percentile(const std::vector<double>& sorted, double percent)
+	{
+		if (sorted.empty() == true)
+		{
+			return 0.0;
+		}
+
+		size_t rank = (size_t)((percent / 100.0) * (double)sorted.size() + 0.5);
+		if (rank < 1)
+		{
+			rank = 1;
+		}
+		if (rank > sorted.size())
+		{
+			rank = sorted.size();
+		}
+
+		return sorted[rank - 1];
+	}
+
+	/***********************************************************
+	 *  WriteStatistics()
+	 *
+	 *  Write the mean, percentiles and maximum of the samples as
+	 *  a JSON object.
+	 ***********************************************************/
+	void WriteStatistics(std::ostream& out, const std::vector<double>& samples)
+	{
+		std::vector<double> sorted(samples);
+		std::sort(sorted.begin(), sorted.end());
+
+		double total = 0.0;
+		for (size_t i = 0; i < sorted.size(); i++)
+		{
+			total += sorted[i];
+		}
+		double mean = sorted.empty() ? 0.0 : total / (double)sorted.size();
+
+		out << "{ \"mean\": " << mean
+			<< ", \"p50\": " << Percentile(sorted, 50.0)
+			<< ", \"p95\": " << Percentile(sorted, 95.0)
+			<< ", \"p99\": " << Percentile(sorted, 99.0)
+			<< ", \"max\": " << (sorted.empty() ? 0.0 : sorted.back())
+			<< " }";
+	}
+}
+
+/***********************************************************
+ *  FrameProfiler()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FrameProfiler::FrameProfiler()
+{
+	m_currentQuery = 0;
+	for (int i = 0; i < QUERY_RING_SIZE; i++)
+	{
+		m_queries[i].queryID = 0;
+		m_queries[i].bPending = false;
+	}
+
+	// timer queries are core since OpenGL 3.3
+	m_bGPUTiming = (GLEW_VERSION_3_3 || GLEW_ARB_timer_query);
+	if (m_bGPUTiming == true)
+	{
+		for (int i = 0; i < QUERY_RING_SIZE; i++)
+		{
+			glGenQueries(1, &m_queries[i].queryID);
+		}
+	}
+}
+
+/***********************************************************
+ *  ~FrameProfiler()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+FrameProfiler::~FrameProfiler()
+{
+	for (int i = 0; i < QUERY_RING_SIZE; i++)
+	{
+		if (m_queries[i].queryID != 0)
+		{
+			glDeleteQueries(1, &m_queries[i].queryID);
+			m_queries[i].queryID = 0;
+		}
+	}
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is used to start timing a new frame.
+ ***********************************************************/
+void FrameProfiler::BeginFrame()
+{
+	if (m_bGPUTiming == true)
+	{
+		// the query in this slot was issued several frames ago,
+		// so its result is normally ready without a stall
+		FRAME_QUERY& query = m_queries[m_currentQuery];
+		CollectQuery(query);
+
+		glBeginQuery(GL_TIME_ELAPSED, query.queryID);
+	}
+
+	m_frameStart = std::chrono::high_resolution_clock::now();
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method is used to stop timing the current frame.
+ ***********************************************************/
+void FrameProfiler::EndFrame()
+{
+	std::chrono::duration<double, std::milli> cpuTime =
+		std::chrono::high_resolution_clock::now() - m_frameStart;
+	m_cpuFrameTimes.push_back(cpuTime.count());
+
+	if (m_bGPUTiming == true)
+	{
+		glEndQuery(GL_TIME_ELAPSED);
+		m_queries[m_currentQuery].bPending = true;
+		m_currentQuery = (m_currentQuery + 1) % QUERY_RING_SIZE;
+	}
+}
+
+/***********************************************************
+ *  AddCounter()
+ *
+ *  This method is used to record a counter value, such as
+ *  the number of draw calls, for the current frame.
+ ***********************************************************/
+void FrameProfiler::AddCounter(const std::string& name, double value)
+{
+	m_counters[name].push_back(value);
+}
+
+/***********************************************************
+ *  Finish()
+ *
+ *  This method is used to collect the results of all of the
+ *  timer queries that are still outstanding.
+ ***********************************************************/
+void FrameProfiler::Finish()
+{
+	// collect in issue order so the GPU samples stay in frame order
+	for (int i = 0; i < QUERY_RING_SIZE; i++)
+	{
+		CollectQuery(m_queries[(m_currentQuery + i) % QUERY_RING_SIZE]);
+	}
+}
+
+/***********************************************************
+ *  CollectQuery()
+ *
+ *  This method is used to read the elapsed GPU time of a
+ *  previously issued timer query.
+ ***********************************************************/
+void FrameProfiler::CollectQuery(FRAME_QUERY& query)
+{
+	if (query.bPending == false)
+	{
+		return;
+	}
+
+	GLuint64 elapsedNanoseconds = 0;
+	glGetQueryObjectui64v(query.queryID, GL_QUERY_RESULT, &elapsedNanoseconds);
+	m_gpuFrameTimes.push_back((double)elapsedNanoseconds / 1000000.0);
+	query.bPending = false;
+}
+
+/***********************************************************
+ *  WriteJSON()
+ *
+ *  This method is used to write the frame time percentiles
+ *  and the counter statistics to a JSON file.
+ ***********************************************************/
+bool FrameProfiler::WriteJSON(const char* filename) const
+{
+	std::ofstream file(filename);
+	if (!file)
+	{
+		std::cout << "Could not write benchmark results:" << filename << std::endl;
+		return false;
+	}
+
+	file << std::fixed << std::setprecision(4);
+	file << "{\n";
+	file << "  \"frames\": " << m_cpuFrameTimes.size() << ",\n";
+
+	file << "  \"cpu_frame_ms\": ";
+	WriteStatistics(file, m_cpuFrameTimes);
+	file << ",\n";
+
+	file << "  \"gpu_frame_ms\": ";
+	if (m_bGPUTiming == true)
+	{
+		WriteStatistics(file, m_gpuFrameTimes);
+	}
+	else
+	{
+		file << "null";
+	}
+
+	std::map<std::string, std::vector<double> >::const_iterator counter;
+	for (counter = m_counters.begin(); counter != m_counters.end(); ++counter)
+	{
+		file << ",\n  \"" << counter->first << "\": ";
+		WriteStatistics(file, counter->second);
+	}
+	file << "\n}\n";
+
+	std::cout << "Saved benchmark results:" << filename << std::endl;
+
+	return true;
+}
+
+/***********************************************************
+ *  GetFrameCount()
+ *
+ *  This method is used to get the number of profiled frames.
+ ***********************************************************/
+int FrameProfiler::GetFrameCount() const
+{
+	return (int)m_cpuFrameTimes.size();
+}
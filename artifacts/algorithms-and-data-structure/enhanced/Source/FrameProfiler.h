@@ -0,0 +1,75 @@
+///////////////////////////////////////////////////////////////////////////////
+// frameprofiler.h
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  FrameProfiler
+ *
+ *  This class collects the CPU and GPU time of every frame,
+ *  along with any per-frame counters such as draw calls, and
+ *  writes the percentile statistics to a JSON report.
+ ***********************************************************/
+class FrameProfiler
+{
+public:
+	// constructor
+	FrameProfiler();
+	// destructor
+	~FrameProfiler();
+
+	// mark the start and the end of one frame
+	void BeginFrame();
+	void EndFrame();
+
+	// record a named counter value for the current frame
+	void AddCounter(const std::string& name, double value);
+
+	// wait for the outstanding GPU timer queries
+	void Finish();
+
+	// write the collected statistics as JSON
+	bool WriteJSON(const char* filename) const;
+
+	// number of profiled frames
+	int GetFrameCount() const;
+
+private:
+	// number of timer queries kept in flight so that reading
+	// a result never waits on the frame that was just issued
+	static const int QUERY_RING_SIZE = 4;
+
+	// GPU timer query for one frame
+	struct FRAME_QUERY
+	{
+		GLuint queryID;
+		bool bPending;
+	};
+
+	// timer queries used round-robin across frames
+	FRAME_QUERY m_queries[QUERY_RING_SIZE];
+	// index of the query for the current frame
+	int m_currentQuery;
+	// GPU timer queries are supported by the context
+	bool m_bGPUTiming;
+
+	// start of the current frame on the CPU
+	std::chrono::high_resolution_clock::time_point m_frameStart;
+
+	// collected samples in milliseconds
+	std::vector<double> m_cpuFrameTimes;
+	std::vector<double> m_gpuFrameTimes;
+	// collected per-frame counters
+	std::map<std::string, std::vector<double> > m_counters;
+
+	// read the result of a finished timer query
+	void CollectQuery(FRAME_QUERY& query);
+};
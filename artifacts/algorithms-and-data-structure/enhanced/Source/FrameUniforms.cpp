@@ -0,0 +1,259 @@
+///////////////////////////////////////////////////////////////////////////////
+// frameuniforms.cpp
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FrameUniforms.h"
+
+#include <cstddef>
+#include <cstring>
+
+// the structures must match the std140 offsets of the shader blocks
+static_assert(sizeof(FrameUniforms::DIRECTIONAL_LIGHT_DATA) == 64, "directional light must match std140");
+static_assert(sizeof(FrameUniforms::SPOT_LIGHT_DATA) == 96, "spot light must match std140");
+static_assert(offsetof(FrameUniforms::SPOT_LIGHT_DATA, cutOff) == 28, "spot light must match std140");
+static_assert(offsetof(FrameUniforms::SPOT_LIGHT_DATA, ambient) == 48, "spot light must match std140");
+static_assert(sizeof(FrameUniforms::CAMERA_DATA) == 208, "camera block must match std140");
+static_assert(sizeof(FrameUniforms::LIGHTS_DATA) == 176, "lights block must match std140");
+static_assert(offsetof(FrameUniforms::LIGHTS_DATA, pointLightCount) == 160, "lights block must match std140");
+
+/***********************************************************
+ *  FrameUniforms()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FrameUniforms::FrameUniforms()
+{
+	m_bufferID = 0;
+	m_lightsOffset = 0;
+	m_bufferSize = 0;
+	m_bDirty = true;
+
+	// value initialization zeroes the padding and leaves all of
+	// the lights inactive
+	m_camera = CAMERA_DATA();
+	m_lights = LIGHTS_DATA();
+	m_camera.view = glm::mat4(1.0f);
+	m_camera.projection = glm::mat4(1.0f);
+	m_camera.inverseViewProjection = glm::mat4(1.0f);
+	m_lights.lightClusterNear = 0.1f;
+	m_lights.lightClusterScale = 1.0f;
+}
+
+/***********************************************************
+ *  ~FrameUniforms()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+FrameUniforms::~FrameUniforms()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method is used for creating the uniform buffer.  The
+ *  lights block starts at the next offset that the driver
+ *  allows for a buffer range, and both ranges are bound to
+ *  their binding points for the rest of the run.
+ ***********************************************************/
+void FrameUniforms::Create()
+{
+	GLint offsetAlignment = 256;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &offsetAlignment);
+	if (offsetAlignment <= 0)
+	{
+		offsetAlignment = 256;
+	}
+
+	GLintptr cameraSize = (GLintptr)sizeof(CAMERA_DATA);
+	m_lightsOffset = ((cameraSize + offsetAlignment - 1) / offsetAlignment) * offsetAlignment;
+	m_bufferSize = (GLsizeiptr)(m_lightsOffset + sizeof(LIGHTS_DATA));
+	m_staging.assign((size_t)m_bufferSize, 0);
+
+	glGenBuffers(1, &m_bufferID);
+	glBindBuffer(GL_UNIFORM_BUFFER, m_bufferID);
+	glBufferData(GL_UNIFORM_BUFFER, m_bufferSize, NULL, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	glBindBufferRange(GL_UNIFORM_BUFFER, CAMERA_BINDING, m_bufferID, 0, sizeof(CAMERA_DATA));
+	glBindBufferRange(GL_UNIFORM_BUFFER, LIGHTS_BINDING, m_bufferID, m_lightsOffset, sizeof(LIGHTS_DATA));
+
+	m_bDirty = true;
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for releasing the uniform buffer.
+ ***********************************************************/
+void FrameUniforms::Destroy()
+{
+	if (m_bufferID != 0)
+	{
+		glDeleteBuffers(1, &m_bufferID);
+		m_bufferID = 0;
+	}
+}
+
+/***********************************************************
+ *  AttachProgram()
+ *
+ *  This method is used for connecting the FrameCamera and
+ *  FrameLights blocks of a linked shader program to the
+ *  shared binding points.  Blocks that the program does not
+ *  declare are skipped.
+ ***********************************************************/
+void FrameUniforms::AttachProgram(GLuint programID)
+{
+	GLuint cameraBlock = glGetUniformBlockIndex(programID, "FrameCamera");
+	if (cameraBlock != GL_INVALID_INDEX)
+	{
+		glUniformBlockBinding(programID, cameraBlock, CAMERA_BINDING);
+	}
+
+	GLuint lightsBlock = glGetUniformBlockIndex(programID, "FrameLights");
+	if (lightsBlock != GL_INVALID_INDEX)
+	{
+		glUniformBlockBinding(programID, lightsBlock, LIGHTS_BINDING);
+	}
+}
+
+/***********************************************************
+ *  SetCamera()
+ *
+ *  This method is used for setting the camera matrices and
+ *  position for the current frame.  The inverse of the view
+ *  projection is kept for turning screen depths back into
+ *  world positions.
+ ***********************************************************/
+void FrameUniforms::SetCamera(
+	const glm::mat4& view,
+	const glm::mat4& projection,
+	const glm::vec3& viewPosition)
+{
+	m_camera.view = view;
+	m_camera.projection = projection;
+	m_camera.inverseViewProjection = glm::inverse(projection * view);
+	m_camera.viewPosition = viewPosition;
+	m_bDirty = true;
+}
+
+/***********************************************************
+ *  SetDirectionalLight()
+ *
+ *  This method is used for setting the values of the
+ *  directional light.
+ ***********************************************************/
+void FrameUniforms::SetDirectionalLight(
+	glm::vec3 direction,
+	glm::vec3 ambient,
+	glm::vec3 diffuse,
+	glm::vec3 specular,
+	bool bActive)
+{
+	DIRECTIONAL_LIGHT_DATA& light = m_lights.directionalLight;
+	light.direction = direction;
+	light.ambient = ambient;
+	light.diffuse = diffuse;
+	light.specular = specular;
+	light.bActive = bActive ? 1 : 0;
+	m_bDirty = true;
+}
+
+/***********************************************************
+ *  SetPointLightClusters()
+ *
+ *  This method is used for setting the number of point lights
+ *  and the view depth slicing of the clusters that they were
+ *  binned into for the current frame.
+ ***********************************************************/
+void FrameUniforms::SetPointLightClusters(
+	int pointLightCount,
+	float lightClusterNear,
+	float lightClusterScale)
+{
+	m_lights.pointLightCount = pointLightCount;
+	m_lights.lightClusterNear = lightClusterNear;
+	m_lights.lightClusterScale = lightClusterScale;
+	m_bDirty = true;
+}
+
+/***********************************************************
+ *  Upload()
+ *
+ *  This method is used for writing the per-frame values into
+ *  the uniform buffer.  Both blocks are written with one
+ *  buffer update, which also orphans the previous contents
+ *  so the driver does not wait on frames still in flight.
+ ***********************************************************/
+void FrameUniforms::Upload()
+{
+	if ((m_bufferID == 0) || (m_bDirty == false))
+	{
+		return;
+	}
+
+	std::memcpy(&m_staging[0], &m_camera, sizeof(CAMERA_DATA));
+	std::memcpy(&m_staging[(size_t)m_lightsOffset], &m_lights, sizeof(LIGHTS_DATA));
+
+	glBindBuffer(GL_UNIFORM_BUFFER, m_bufferID);
+	glBufferData(GL_UNIFORM_BUFFER, m_bufferSize, &m_staging[0], GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	m_bDirty = false;
+}
+
+/***********************************************************
+ *  GetBufferID()
+ *
+ *  This method is used for getting the uniform buffer.
+ ***********************************************************/
+GLuint FrameUniforms::GetBufferID() const
+{
+	return(m_bufferID);
+}
+
+/***********************************************************
+ *  GetViewPosition()
+ *
+ *  This method is used for getting the camera position that
+ *  was set for the current frame.
+ ***********************************************************/
+glm::vec3 FrameUniforms::GetViewPosition() const
+{
+	return(m_camera.viewPosition);
+}
+
+/***********************************************************
+ *  GetView()
+ *
+ *  This method is used for getting the view matrix that was
+ *  set for the current frame.
+ ***********************************************************/
+glm::mat4 FrameUniforms::GetView() const
+{
+	return(m_camera.view);
+}
+
+/***********************************************************
+ *  GetViewProjection()
+ *
+ *  This method is used for getting the combined view and
+ *  projection matrix that was set for the current frame.
+ ***********************************************************/
+glm::mat4 FrameUniforms::GetViewProjection() const
+{
+	return(m_camera.projection * m_camera.view);
+}
+
+/***********************************************************
+ *  GetProjection()
+ *
+ *  This method is used for getting the projection matrix that
+ *  was set for the current frame.
+ ***********************************************************/
+glm::mat4 FrameUniforms::GetProjection() const
+{
+	return(m_camera.projection);
+}
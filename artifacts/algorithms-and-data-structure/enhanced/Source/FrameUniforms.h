@@ -0,0 +1,148 @@
+///////////////////////////////////////////////////////////////////////////////
+// frameuniforms.h
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  FrameUniforms
+ *
+ *  This class contains the per-frame shader data - the camera
+ *  matrices, the directional and spot lights and the light
+ *  cluster values - in one uniform buffer.
+ *  The values are collected on the CPU and written with a
+ *  single buffer update per frame.  The data is split into a
+ *  camera block and a lights block at fixed binding points,
+ *  so any shader program that declares the blocks shares the
+ *  same buffer.
+ ***********************************************************/
+class FrameUniforms
+{
+public:
+	// constructor
+	FrameUniforms();
+	// destructor
+	~FrameUniforms();
+
+	// uniform buffer binding points of the blocks
+	static const GLuint CAMERA_BINDING = 0;
+	static const GLuint LIGHTS_BINDING = 1;
+
+	// std140 layout of the directional light
+	struct DIRECTIONAL_LIGHT_DATA
+	{
+		glm::vec3 direction;
+		float padding0;
+		glm::vec3 ambient;
+		float padding1;
+		glm::vec3 diffuse;
+		float padding2;
+		glm::vec3 specular;
+		int bActive;
+	};
+
+	// std140 layout of the spot light
+	struct SPOT_LIGHT_DATA
+	{
+		glm::vec3 position;
+		float padding0;
+		glm::vec3 direction;
+		float cutOff;
+		float outerCutOff;
+		float constant;
+		float linear;
+		float quadratic;
+		glm::vec3 ambient;
+		float padding1;
+		glm::vec3 diffuse;
+		float padding2;
+		glm::vec3 specular;
+		int bActive;
+	};
+
+	// std140 layout of the FrameCamera block
+	struct CAMERA_DATA
+	{
+		glm::mat4 view;
+		glm::mat4 projection;
+		glm::mat4 inverseViewProjection;
+		glm::vec3 viewPosition;
+		float padding0;
+	};
+
+	// std140 layout of the FrameLights block, the point lights
+	// are kept in clusters by the ClusteredLights class instead
+	struct LIGHTS_DATA
+	{
+		DIRECTIONAL_LIGHT_DATA directionalLight;
+		SPOT_LIGHT_DATA spotLight;
+		int pointLightCount;
+		float lightClusterNear;
+		float lightClusterScale;
+		float padding0;
+	};
+
+	// create the uniform buffer and bind it to the binding points
+	void Create();
+	// release the uniform buffer
+	void Destroy();
+
+	// connect the blocks of a linked program to the binding points
+	static void AttachProgram(GLuint programID);
+
+	// set the camera values for the current frame
+	void SetCamera(
+		const glm::mat4& view,
+		const glm::mat4& projection,
+		const glm::vec3& viewPosition);
+
+	// set the values of the directional light
+	void SetDirectionalLight(
+		glm::vec3 direction,
+		glm::vec3 ambient,
+		glm::vec3 diffuse,
+		glm::vec3 specular,
+		bool bActive);
+
+	// set the number of point lights and the depth slicing of the
+	// light clusters they are binned into
+	void SetPointLightClusters(
+		int pointLightCount,
+		float lightClusterNear,
+		float lightClusterScale);
+
+	// write the changed values into the uniform buffer
+	void Upload();
+
+	// the uniform buffer
+	GLuint GetBufferID() const;
+	// the camera position set for the current frame
+	glm::vec3 GetViewPosition() const;
+	// the view set for the current frame
+	glm::mat4 GetView() const;
+	// the combined view and projection set for the current frame
+	glm::mat4 GetViewProjection() const;
+	// the projection set for the current frame
+	glm::mat4 GetProjection() const;
+
+private:
+	// uniform buffer holding both blocks
+	GLuint m_bufferID;
+	// byte offset of the lights block inside the buffer
+	GLintptr m_lightsOffset;
+	// total size of the buffer in bytes
+	GLsizeiptr m_bufferSize;
+	// CPU copy of the buffer contents
+	std::vector<unsigned char> m_staging;
+	// the CPU copy changed since the last upload
+	bool m_bDirty;
+
+	// the current values of the blocks
+	CAMERA_DATA m_camera;
+	LIGHTS_DATA m_lights;
+};
@@ -0,0 +1,181 @@
+///////////////////////////////////////////////////////////////////////////////
+// frustumculler.cpp
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FrustumCuller.h"
+
+#include <cmath>
+
+// SSE is available on every x64 build and on x86 builds with /arch:SSE2
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define FRUSTUM_CULLER_SSE 1
+#include <xmmintrin.h>
+#endif
+
+/***********************************************************
+ *  FrustumCuller()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FrustumCuller::FrustumCuller()
+{
+	// until a matrix is set, nothing is culled
+	for (int i = 0; i < PLANE_COUNT; i++)
+	{
+		m_planeX[i] = 0.0f;
+		m_planeY[i] = 0.0f;
+		m_planeZ[i] = 0.0f;
+		m_planeW[i] = 1.0f;
+	}
+}
+
+/***********************************************************
+ *  ~FrustumCuller()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+FrustumCuller::~FrustumCuller()
+{
+}
+
+/***********************************************************
+ *  SetViewProjection()
+ *
+ *  This method is used for extracting the frustum planes in
+ *  world space from the combined view and projection matrix.
+ *  Each plane is the sum or difference of the fourth row and
+ *  one of the other rows, normalized so that the plane
+ *  distance of a point is in world units.
+ ***********************************************************/
+void FrustumCuller::SetViewProjection(const glm::mat4& viewProjection)
+{
+	// glm matrices are indexed by column, then by row
+	glm::vec4 rows[4];
+	for (int row = 0; row < 4; row++)
+	{
+		rows[row] = glm::vec4(
+			viewProjection[0][row],
+			viewProjection[1][row],
+			viewProjection[2][row],
+			viewProjection[3][row]);
+	}
+
+	glm::vec4 planes[PLANE_COUNT];
+	planes[0] = rows[3] + rows[0];	// left
+	planes[1] = rows[3] - rows[0];	// right
+	planes[2] = rows[3] + rows[1];	// bottom
+	planes[3] = rows[3] - rows[1];	// top
+	planes[4] = rows[3] + rows[2];	// near
+	planes[5] = rows[3] - rows[2];	// far
+
+	for (int i = 0; i < PLANE_COUNT; i++)
+	{
+		float length = std::sqrt(
+			planes[i].x * planes[i].x +
+			planes[i].y * planes[i].y +
+			planes[i].z * planes[i].z);
+		if (length > 0.0f)
+		{
+			planes[i] = planes[i] / length;
+		}
+
+		m_planeX[i] = planes[i].x;
+		m_planeY[i] = planes[i].y;
+		m_planeZ[i] = planes[i].z;
+		m_planeW[i] = planes[i].w;
+	}
+}
+
+/***********************************************************
+ *  IsSphereVisible()
+ *
+ *  This method is used for testing one bounding sphere.  The
+ *  sphere is culled when it is completely behind any plane.
+ ***********************************************************/
+bool FrustumCuller::IsSphereVisible(glm::vec3 center, float radius) const
+{
+	for (int i = 0; i < PLANE_COUNT; i++)
+	{
+		float distance =
+			m_planeX[i] * center.x +
+			m_planeY[i] * center.y +
+			m_planeZ[i] * center.z +
+			m_planeW[i];
+		if (distance < -radius)
+		{
+			return(false);
+		}
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  TestSpheres()
+ *
+ *  This method is used for testing a batch of bounding
+ *  spheres.  With SSE, four spheres are tested against each
+ *  plane at once and the remaining spheres one at a time.
+ ***********************************************************/
+int FrustumCuller::TestSpheres(
+	const float* centerX,
+	const float* centerY,
+	const float* centerZ,
+	const float* radius,
+	int count,
+	unsigned char* visible) const
+{
+	int visibleCount = 0;
+	int index = 0;
+
+#ifdef FRUSTUM_CULLER_SSE
+	__m128 planeX[PLANE_COUNT];
+	__m128 planeY[PLANE_COUNT];
+	__m128 planeZ[PLANE_COUNT];
+	__m128 planeW[PLANE_COUNT];
+	for (int i = 0; i < PLANE_COUNT; i++)
+	{
+		planeX[i] = _mm_set1_ps(m_planeX[i]);
+		planeY[i] = _mm_set1_ps(m_planeY[i]);
+		planeZ[i] = _mm_set1_ps(m_planeZ[i]);
+		planeW[i] = _mm_set1_ps(m_planeW[i]);
+	}
+
+	const __m128 zero = _mm_setzero_ps();
+	for (; index + 4 <= count; index += 4)
+	{
+		__m128 x = _mm_loadu_ps(centerX + index);
+		__m128 y = _mm_loadu_ps(centerY + index);
+		__m128 z = _mm_loadu_ps(centerZ + index);
+		__m128 negativeRadius = _mm_sub_ps(zero, _mm_loadu_ps(radius + index));
+
+		__m128 outside = zero;
+		for (int i = 0; i < PLANE_COUNT; i++)
+		{
+			__m128 distance = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(planeX[i], x), _mm_mul_ps(planeY[i], y)),
+				_mm_add_ps(_mm_mul_ps(planeZ[i], z), planeW[i]));
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, negativeRadius));
+		}
+
+		int outsideMask = _mm_movemask_ps(outside);
+		for (int lane = 0; lane < 4; lane++)
+		{
+			unsigned char bVisible = ((outsideMask >> lane) & 1) ? 0 : 1;
+			visible[index + lane] = bVisible;
+			visibleCount += bVisible;
+		}
+	}
+#endif
+
+	// the spheres that do not fill a whole SSE register
+	for (; index < count; index++)
+	{
+		glm::vec3 center(centerX[index], centerY[index], centerZ[index]);
+		unsigned char bVisible = IsSphereVisible(center, radius[index]) ? 1 : 0;
+		visible[index] = bVisible;
+		visibleCount += bVisible;
+	}
+
+	return(visibleCount);
+}
@@ -0,0 +1,52 @@
+///////////////////////////////////////////////////////////////////////////////
+// frustumculler.h
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+/***********************************************************
+ *  FrustumCuller
+ *
+ *  This class holds the six planes of the view frustum and
+ *  tests batches of bounding spheres against them.  The
+ *  spheres are passed as separate arrays of X, Y, Z and
+ *  radius values so that four of them are tested at once
+ *  with SSE instructions.
+ ***********************************************************/
+class FrustumCuller
+{
+public:
+	// constructor
+	FrustumCuller();
+	// destructor
+	~FrustumCuller();
+
+	// number of frustum planes
+	static const int PLANE_COUNT = 6;
+
+	// extract the frustum planes from a view-projection matrix
+	void SetViewProjection(const glm::mat4& viewProjection);
+
+	// test a single bounding sphere against the frustum
+	bool IsSphereVisible(glm::vec3 center, float radius) const;
+
+	// test a batch of bounding spheres, writing 1 for each visible
+	// sphere and 0 for each culled one, and return the visible count
+	int TestSpheres(
+		const float* centerX,
+		const float* centerY,
+		const float* centerZ,
+		const float* radius,
+		int count,
+		unsigned char* visible) const;
+
+private:
+	// plane equations, with the normals pointing into the frustum,
+	// stored as one array per component
+	float m_planeX[PLANE_COUNT];
+	float m_planeY[PLANE_COUNT];
+	float m_planeZ[PLANE_COUNT];
+	float m_planeW[PLANE_COUNT];
+};
@@ -0,0 +1,260 @@
+///////////////////////////////////////////////////////////////////////////////
+// gbuffer.cpp
+///////////////////////////////////////////////////////////////////////////////
+
+#include "GBuffer.h"
+
+#include <iostream>
+
+// declaration of global variables and functions
+namespace
+{
+	// storage of every target - the normal keeps half floats so
+	// the lighting matches the forward path, and the material
+	// index is negative for surfaces that are not lit
+	const GLenum TARGET_FORMATS[GBuffer::TARGET_COUNT] =
+	{
+		GL_RGBA8,
+		GL_RGBA16F,
+		GL_R16I,
+		GL_DEPTH_COMPONENT24
+	};
+	const GLenum TARGET_PIXEL_FORMATS[GBuffer::TARGET_COUNT] =
+	{
+		GL_RGBA,
+		GL_RGBA,
+		GL_RED_INTEGER,
+		GL_DEPTH_COMPONENT
+	};
+	const GLenum TARGET_PIXEL_TYPES[GBuffer::TARGET_COUNT] =
+	{
+		GL_UNSIGNED_BYTE,
+		GL_HALF_FLOAT,
+		GL_SHORT,
+		GL_UNSIGNED_INT
+	};
+	const int TARGET_PIXEL_SIZES[GBuffer::TARGET_COUNT] = { 4, 8, 2, 4 };
+}
+
+/***********************************************************
+ *  GBuffer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+GBuffer::GBuffer()
+{
+	m_framebufferID = 0;
+	for (int target = 0; target < TARGET_COUNT; target++)
+	{
+		m_textureIDs[target] = 0;
+	}
+	m_vertexArrayID = 0;
+	m_previousFramebuffer = 0;
+	m_width = 0;
+	m_height = 0;
+}
+
+/***********************************************************
+ *  ~GBuffer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+GBuffer::~GBuffer()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  Resize()
+ *
+ *  This method is used for creating the framebuffer and its
+ *  targets the first time, and for reallocating the targets
+ *  whenever the passed in size changes.
+ ***********************************************************/
+bool GBuffer::Resize(int width, int height)
+{
+	if ((width <= 0) || (height <= 0))
+	{
+		return(false);
+	}
+	if ((m_framebufferID != 0) && (width == m_width) && (height == m_height))
+	{
+		return(true);
+	}
+
+	if (m_framebufferID == 0)
+	{
+		glGenFramebuffers(1, &m_framebufferID);
+		glGenTextures(TARGET_COUNT, m_textureIDs);
+		glGenVertexArrays(1, &m_vertexArrayID);
+	}
+	m_width = width;
+	m_height = height;
+
+	GLint previousFramebuffer = 0;
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebufferID);
+
+	for (int target = 0; target < TARGET_COUNT; target++)
+	{
+		// the lighting pass reads each pixel with texelFetch, so
+		// the targets are never filtered
+		glBindTexture(GL_TEXTURE_2D, m_textureIDs[target]);
+		glTexImage2D(
+			GL_TEXTURE_2D,
+			0,
+			TARGET_FORMATS[target],
+			width,
+			height,
+			0,
+			TARGET_PIXEL_FORMATS[target],
+			TARGET_PIXEL_TYPES[target],
+			NULL);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+		GLenum attachment = (target == DEPTH_TARGET) ?
+			GL_DEPTH_ATTACHMENT : (GLenum)(GL_COLOR_ATTACHMENT0 + target);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, m_textureIDs[target], 0);
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	const GLenum drawBuffers[DEPTH_TARGET] =
+	{
+		GL_COLOR_ATTACHMENT0 + ALBEDO_TARGET,
+		GL_COLOR_ATTACHMENT0 + NORMAL_TARGET,
+		GL_COLOR_ATTACHMENT0 + MATERIAL_TARGET
+	};
+	glDrawBuffers(DEPTH_TARGET, drawBuffers);
+
+	bool bComplete = (glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+	glBindFramebuffer(GL_FRAMEBUFFER, (GLuint)previousFramebuffer);
+
+	if (bComplete == false)
+	{
+		std::cout << "G-buffer framebuffer is not complete" << std::endl;
+		Destroy();
+		return(false);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  BeginGeometryPass()
+ *
+ *  This method is used for binding the framebuffer for the
+ *  geometry pass.  Only the depth is cleared, since the
+ *  lighting pass skips every pixel where no surface was drawn.
+ ***********************************************************/
+void GBuffer::BeginGeometryPass()
+{
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &m_previousFramebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebufferID);
+	glClear(GL_DEPTH_BUFFER_BIT);
+}
+
+/***********************************************************
+ *  EndGeometryPass()
+ *
+ *  This method is used for binding the framebuffer that was
+ *  bound before the geometry pass, so the lighting pass draws
+ *  into the window or the offscreen target.
+ ***********************************************************/
+void GBuffer::EndGeometryPass()
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, (GLuint)m_previousFramebuffer);
+}
+
+/***********************************************************
+ *  BindTargets()
+ *
+ *  This method is used for binding every target to the
+ *  passed in texture unit for the lighting pass.
+ ***********************************************************/
+void GBuffer::BindTargets(const int textureUnits[TARGET_COUNT]) const
+{
+	for (int target = 0; target < TARGET_COUNT; target++)
+	{
+		glActiveTexture(GL_TEXTURE0 + textureUnits[target]);
+		glBindTexture(GL_TEXTURE_2D, m_textureIDs[target]);
+	}
+	glActiveTexture(GL_TEXTURE0);
+}
+
+/***********************************************************
+ *  DrawFullScreenTriangle()
+ *
+ *  This method is used for drawing one triangle that covers
+ *  the whole screen.  The vertex shader places the corners
+ *  from the vertex index alone, so no vertex buffer is bound.
+ ***********************************************************/
+void GBuffer::DrawFullScreenTriangle() const
+{
+	glBindVertexArray(m_vertexArrayID);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	glBindVertexArray(0);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for releasing the framebuffer and its
+ *  targets.
+ ***********************************************************/
+void GBuffer::Destroy()
+{
+	if (m_framebufferID != 0)
+	{
+		glDeleteFramebuffers(1, &m_framebufferID);
+		glDeleteTextures(TARGET_COUNT, m_textureIDs);
+		glDeleteVertexArrays(1, &m_vertexArrayID);
+		m_framebufferID = 0;
+		m_vertexArrayID = 0;
+		for (int target = 0; target < TARGET_COUNT; target++)
+		{
+			m_textureIDs[target] = 0;
+		}
+	}
+	m_width = 0;
+	m_height = 0;
+}
+
+/***********************************************************
+ *  GetWidth()
+ *
+ *  This method is used for getting the width of the targets.
+ ***********************************************************/
+int GBuffer::GetWidth() const
+{
+	return(m_width);
+}
+
+/***********************************************************
+ *  GetHeight()
+ *
+ *  This method is used for getting the height of the targets.
+ ***********************************************************/
+int GBuffer::GetHeight() const
+{
+	return(m_height);
+}
+
+/***********************************************************
+ *  GetMemorySize()
+ *
+ *  This method is used for getting the bytes of memory held
+ *  by the targets.
+ ***********************************************************/
+int GBuffer::GetMemorySize() const
+{
+	int pixelSize = 0;
+	for (int target = 0; target < TARGET_COUNT; target++)
+	{
+		pixelSize += TARGET_PIXEL_SIZES[target];
+	}
+
+	return(m_width * m_height * pixelSize);
+}
@@ -0,0 +1,74 @@
+///////////////////////////////////////////////////////////////////////////////
+// gbuffer.h
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+/***********************************************************
+ *  GBuffer
+ *
+ *  This class holds the framebuffer that the geometry pass of
+ *  deferred shading renders into.  Every pixel keeps the
+ *  surface color, the world normal, the material index and
+ *  the depth of the nearest surface, so the lighting pass can
+ *  shade each visible pixel once with a single triangle that
+ *  covers the screen.  The targets follow the size of the
+ *  viewport, and the framebuffer that was bound before the
+ *  geometry pass is bound again for the lighting pass.
+ ***********************************************************/
+class GBuffer
+{
+public:
+	// constructor
+	GBuffer();
+	// destructor
+	~GBuffer();
+
+	// targets of the geometry pass, in draw buffer order
+	enum TARGET
+	{
+		ALBEDO_TARGET = 0,
+		NORMAL_TARGET,
+		MATERIAL_TARGET,
+		DEPTH_TARGET,
+		TARGET_COUNT
+	};
+
+	// create or resize the targets to match the passed in size
+	bool Resize(int width, int height);
+	// bind the framebuffer and clear its depth for the geometry pass
+	void BeginGeometryPass();
+	// bind the framebuffer that was bound before the geometry pass
+	void EndGeometryPass();
+	// bind the targets to consecutive texture units for reading
+	void BindTargets(const int textureUnits[TARGET_COUNT]) const;
+	// draw the triangle that covers the screen for the lighting pass
+	void DrawFullScreenTriangle() const;
+	// release the framebuffer and its targets
+	void Destroy();
+
+	// size of the targets
+	int GetWidth() const;
+	int GetHeight() const;
+	// bytes of memory held by the targets
+	int GetMemorySize() const;
+
+private:
+	// the targets cannot be shared between two objects
+	GBuffer(const GBuffer&);
+	GBuffer& operator=(const GBuffer&);
+
+	// framebuffer that the geometry pass renders into
+	GLuint m_framebufferID;
+	// texture of every target
+	GLuint m_textureIDs[TARGET_COUNT];
+	// empty vertex array for drawing without vertex buffers
+	GLuint m_vertexArrayID;
+	// framebuffer that was bound before the geometry pass
+	GLint m_previousFramebuffer;
+	// size of the targets
+	int m_width;
+	int m_height;
+};
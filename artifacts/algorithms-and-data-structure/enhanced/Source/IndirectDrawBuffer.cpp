@@ -0,0 +1,204 @@
+///////////////////////////////////////////////////////////////////////////////
+// indirectdrawbuffer.cpp
+///////////////////////////////////////////////////////////////////////////////
+
+#include "IndirectDrawBuffer.h"
+
+// glMultiDrawElementsIndirect reads five tightly packed integers per command
+static_assert(sizeof(IndirectDrawBuffer::DRAW_COMMAND) == 5 * sizeof(GLuint),
+	"draw command must match the indirect command layout");
+// the vertex shader reads each draw as one RGBA32I texel
+static_assert(sizeof(IndirectDrawBuffer::DRAW_DATA) == 4 * sizeof(GLint),
+	"draw data must match the buffer texture layout");
+
+/***********************************************************
+ *  IndirectDrawBuffer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+IndirectDrawBuffer::IndirectDrawBuffer()
+{
+	m_commandBufferID = 0;
+	m_drawDataBufferID = 0;
+	m_drawTableTextureID = 0;
+	m_capacity = 0;
+}
+
+/***********************************************************
+ *  ~IndirectDrawBuffer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+IndirectDrawBuffer::~IndirectDrawBuffer()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  IsSupported()
+ *
+ *  This method is used for checking that the context can
+ *  draw from an indirect buffer, which is core in OpenGL 4.3,
+ *  and that the shaders can read gl_DrawID through the
+ *  shader draw parameters.
+ ***********************************************************/
+bool IndirectDrawBuffer::IsSupported()
+{
+	bool bMultiDraw = (GLEW_VERSION_4_3 == GL_TRUE) || (GLEW_ARB_multi_draw_indirect == GL_TRUE);
+	bool bDrawID = (GLEW_ARB_shader_draw_parameters == GL_TRUE);
+
+	return(bMultiDraw && bDrawID);
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for removing all of the commands.  The
+ *  GPU buffers are kept for the next submission.
+ ***********************************************************/
+void IndirectDrawBuffer::Clear()
+{
+	m_commands.clear();
+	m_drawData.clear();
+}
+
+/***********************************************************
+ *  Add()
+ *
+ *  This method is used for adding a command that draws copies
+ *  of a mesh range.  The copies take their model matrices from
+ *  the per-instance buffer starting at the first instance.
+ ***********************************************************/
+void IndirectDrawBuffer::Add(
+	const SceneMeshes::MESH_RANGE& mesh,
+	int instanceCount,
+	int firstInstance,
+	int materialIndex,
+	int textureLayer)
+{
+	DRAW_COMMAND command;
+	command.count = (GLuint)mesh.nIndices;
+	command.instanceCount = (GLuint)instanceCount;
+	command.firstIndex = mesh.firstIndex;
+	command.baseVertex = mesh.baseVertex;
+	command.baseInstance = (GLuint)firstInstance;
+	m_commands.push_back(command);
+
+	DRAW_DATA drawData;
+	drawData.materialIndex = materialIndex;
+	drawData.textureLayer = textureLayer;
+	drawData.meshIndex = mesh.shape;
+	drawData.reserved = 0;
+	m_drawData.push_back(drawData);
+}
+
+/***********************************************************
+ *  GetCount()
+ *
+ *  This method is used for getting the number of commands.
+ ***********************************************************/
+int IndirectDrawBuffer::GetCount() const
+{
+	return((int)m_commands.size());
+}
+
+/***********************************************************
+ *  Upload()
+ *
+ *  This method is used for writing the commands and the draw
+ *  table into their GPU buffers.  The buffers are orphaned on
+ *  every upload so the CPU never waits on the previous frame,
+ *  and they only grow when there are more commands.
+ ***********************************************************/
+void IndirectDrawBuffer::Upload()
+{
+	if (m_commandBufferID == 0)
+	{
+		glGenBuffers(1, &m_commandBufferID);
+		glGenBuffers(1, &m_drawDataBufferID);
+		glGenTextures(1, &m_drawTableTextureID);
+	}
+
+	int commandCount = (int)m_commands.size();
+	if (commandCount > m_capacity)
+	{
+		m_capacity = commandCount * 2;
+	}
+	if (m_capacity == 0)
+	{
+		return;
+	}
+
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBufferID);
+	glBufferData(GL_DRAW_INDIRECT_BUFFER, m_capacity * sizeof(DRAW_COMMAND), NULL, GL_STREAM_DRAW);
+	if (commandCount > 0)
+	{
+		glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, commandCount * sizeof(DRAW_COMMAND), &m_commands[0]);
+	}
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+	glBindBuffer(GL_TEXTURE_BUFFER, m_drawDataBufferID);
+	glBufferData(GL_TEXTURE_BUFFER, m_capacity * sizeof(DRAW_DATA), NULL, GL_STREAM_DRAW);
+	if (commandCount > 0)
+	{
+		glBufferSubData(GL_TEXTURE_BUFFER, 0, commandCount * sizeof(DRAW_DATA), &m_drawData[0]);
+	}
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+	// the buffer texture follows the orphaned storage of the buffer
+	glBindTexture(GL_TEXTURE_BUFFER, m_drawTableTextureID);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32I, m_drawDataBufferID);
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
+}
+
+/***********************************************************
+ *  Bind()
+ *
+ *  This method is used for binding the command buffer for the
+ *  indirect draw and the draw table to a texture unit.
+ ***********************************************************/
+void IndirectDrawBuffer::Bind(int textureUnit) const
+{
+	glActiveTexture(GL_TEXTURE0 + textureUnit);
+	glBindTexture(GL_TEXTURE_BUFFER, m_drawTableTextureID);
+	glActiveTexture(GL_TEXTURE0);
+
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBufferID);
+}
+
+/***********************************************************
+ *  Unbind()
+ *
+ *  This method is used for releasing the command buffer after
+ *  the indirect draw.  The draw table stays on its unit.
+ ***********************************************************/
+void IndirectDrawBuffer::Unbind() const
+{
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for releasing the GPU buffers and the
+ *  buffer texture.
+ ***********************************************************/
+void IndirectDrawBuffer::Destroy()
+{
+	if (m_drawTableTextureID != 0)
+	{
+		glDeleteTextures(1, &m_drawTableTextureID);
+		m_drawTableTextureID = 0;
+	}
+	if (m_drawDataBufferID != 0)
+	{
+		glDeleteBuffers(1, &m_drawDataBufferID);
+		m_drawDataBufferID = 0;
+	}
+	if (m_commandBufferID != 0)
+	{
+		glDeleteBuffers(1, &m_commandBufferID);
+		m_commandBufferID = 0;
+	}
+	m_capacity = 0;
+}
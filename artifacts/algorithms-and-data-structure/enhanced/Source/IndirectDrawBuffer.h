@@ -0,0 +1,90 @@
+///////////////////////////////////////////////////////////////////////////////
+// indirectdrawbuffer.h
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SceneMeshes.h"
+
+#include <GL/glew.h>
+
+#include <vector>
+
+/***********************************************************
+ *  IndirectDrawBuffer
+ *
+ *  This class builds the commands of one multi-draw-indirect
+ *  submission on the CPU and uploads them with the values
+ *  that differ between the draws.  Every command draws a
+ *  range of the shared mesh buffers, starting at its base
+ *  instance in the per-instance model matrices.  The material,
+ *  texture layer and mesh of each command are kept in a draw
+ *  table that the vertex shader reads with gl_DrawID, through
+ *  a buffer texture so the shaders can stay at GLSL 3.30.
+ ***********************************************************/
+class IndirectDrawBuffer
+{
+public:
+	// constructor
+	IndirectDrawBuffer();
+	// destructor
+	~IndirectDrawBuffer();
+
+	// layout of one command read by glMultiDrawElementsIndirect
+	struct DRAW_COMMAND
+	{
+		GLuint count;
+		GLuint instanceCount;
+		GLuint firstIndex;
+		GLint baseVertex;
+		GLuint baseInstance;
+	};
+
+	// values of one command in the draw table, one RGBA32I texel
+	struct DRAW_DATA
+	{
+		GLint materialIndex;
+		// texture array layer, or -1 for the object color
+		GLint textureLayer;
+		// shape of the mesh, selecting its packed vertex quantization
+		GLint meshIndex;
+		GLint reserved;
+	};
+
+	// the context can draw indirect and the shaders can read gl_DrawID
+	static bool IsSupported();
+
+	// remove all of the commands
+	void Clear();
+	// add a command drawing copies of a mesh range
+	void Add(
+		const SceneMeshes::MESH_RANGE& mesh,
+		int instanceCount,
+		int firstInstance,
+		int materialIndex,
+		int textureLayer);
+	// number of commands
+	int GetCount() const;
+
+	// write the commands and the draw table into GPU buffers
+	void Upload();
+	// bind the command buffer and the draw table texture
+	void Bind(int textureUnit) const;
+	// release the command buffer binding
+	void Unbind() const;
+	// release the GPU buffers
+	void Destroy();
+
+private:
+	// commands and draw table values of the submission
+	std::vector<DRAW_COMMAND> m_commands;
+	std::vector<DRAW_DATA> m_drawData;
+	// buffer read by the indirect draw
+	GLuint m_commandBufferID;
+	// buffer holding the draw table
+	GLuint m_drawDataBufferID;
+	// buffer texture reading the draw table as RGBA32I texels
+	GLuint m_drawTableTextureID;
+	// number of commands the buffers were allocated for
+	int m_capacity;
+};
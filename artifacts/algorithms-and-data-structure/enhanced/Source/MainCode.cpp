@@ -4,6 +4,8 @@
 
 #include <iostream>         // error handling and output
 #include <cstdlib>          // EXIT_FAILURE
+#include <cstring>          // command line argument parsing
+#include <string>           // benchmark report file names
 
 #include <GL/glew.h>        // GLEW library
 #include "GLFW/glfw3.h"     // GLFW library
@@ -15,8 +17,11 @@
 
 #include "SceneManager.h"
 #include "ViewManager.h"
-#include "ShapeMeshes.h"
-#include "ShaderManager.h"
+#include "ShaderVariants.h"
+#include "FrameUniforms.h"
+#include "CameraPath.h"
+#include "SceneFile.h"
+#include "FrameProfiler.h"
 
 // Namespace for declaring global variables
 namespace
@@ -29,16 +34,106 @@ namespace
 
 	// scene manager object for managing the 3D scene prepare and render
 	SceneManager* g_SceneManager = nullptr;
-	// shader manager object for dynamic interaction with the shader code
-	ShaderManager* g_ShaderManager = nullptr;
+	// specialized shader programs built from the GLSL files
+	ShaderVariants* g_ShaderVariants = nullptr;
+	// per-frame uniform buffer for the camera and lights
+	FrameUniforms* g_FrameUniforms = nullptr;
 	// view manager object for managing the 3D view setup and projection to 2D
 	ViewManager* g_ViewManager = nullptr;
+
+	// camera path for replaying or recording the camera movement
+	CameraPath* g_CameraPath = nullptr;
+
+	// render into an offscreen framebuffer instead of a visible window
+	bool g_bOffscreen = false;
+	// number of frames to render when running offscreen or benchmarking
+	int g_FrameCount = 300;
+	// optional image file for the last offscreen frame
+	const char* g_OffscreenOutput = nullptr;
+
+	// render a fixed number of profiled frames and write a report
+	bool g_bBenchmark = false;
+	// file that the benchmark report is written to
+	const char* g_BenchmarkOutput = "benchmark.json";
+	// time step used when the camera is replayed
+	float g_FixedTimestep = 1.0f / 60.0f;
+	// camera path file to replay instead of live input
+	const char* g_ReplayCameraFile = nullptr;
+	// camera path file that the live camera is recorded into
+	const char* g_RecordCameraFile = nullptr;
+
+	// number of texture decoding threads, zero for one per core
+	int g_TextureThreads = 0;
+
+	// bind every texture to its own unit instead of one texture array
+	bool g_bTextureUnits = false;
+
+	// submit the draws in the order they are queued
+	bool g_bUnsortedDraws = false;
+
+	// draw every object, even those outside of the view
+	bool g_bNoCulling = false;
+
+	// draw every object separately instead of one indirect multi-draw
+	bool g_bNoMultiDraw = false;
+
+	// draw every object with the full mesh detail
+	bool g_bNoLevelOfDetail = false;
+
+	// store the meshes with packed vertices
+	bool g_bPackedVertices = false;
+
+	// keep the mesh triangles in their generated order
+	bool g_bNoIndexOptimization = false;
+
+	// number of extra objects added to stress the renderer
+	int g_StressObjects = 0;
+
+	// total number of point lights, zero for only the scene lights
+	int g_PointLights = 0;
+	// shade every point light instead of the lights of each cluster
+	bool g_bNoLightClusters = false;
+	// benchmark once per point light count from 4 up to 1024
+	bool g_bLightSweep = false;
+	const int LIGHT_SWEEP_FIRST = 4;
+	const int LIGHT_SWEEP_LAST = 1024;
+
+	// light the pixels of a G-buffer instead of every fragment
+	bool g_bDeferredShading = false;
+	// benchmark the forward and then the deferred render path
+	bool g_bComparePaths = false;
+
+	// file that the linked shader programs are kept in between
+	// runs, or NULL to compile them on every run
+	const char* g_ProgramCacheFile = "shader_programs.cache";
+	// compile every shader program when it is first drawn with,
+	// instead of starting them all up front
+	bool g_bSyncShaders = false;
+	// wait for the first frame and report its latency, which
+	// includes the shader programs it had to wait for
+	bool g_bFirstFrameLatency = false;
+	// time the shaders started loading, for the first frame latency
+	double g_StartupTime = 0.0;
+	bool g_bFirstFrame = true;
+
+	// binary scene file to load, or NULL for the default scene
+	const char* g_SceneFile = nullptr;
+	// text scene to convert, and the binary scene file to write
+	const char* g_ConvertSceneInput = nullptr;
+	const char* g_ConvertSceneOutput = nullptr;
 }
 
 // Function declarations - all functions that are called manually
 // need to be pre-declared at the beginning of the source code.
-bool InitializeGLFW();
+bool InitializeGLFW(bool bHeadless, int contextAPI);
 bool InitializeGLEW();
+void ParseCommandLine(int argc, char* argv[]);
+void SetupCameraPath();
+void RenderFrame();
+void RunOffscreen();
+void RunBenchmark();
+void ProfileFrames(const char* outputFile);
+std::string GetReportFile(const std::string& suffix);
 
 
 /***********************************************************
@@ -49,20 +144,54 @@ bool InitializeGLEW();
  ***********************************************************/
 int main(int argc, char* argv[])
 {
-	// if GLFW fails initialization, then terminate the application
-	if (InitializeGLFW() == false)
+	// check for the offscreen rendering options
+	ParseCommandLine(argc, argv);
+
+	// converting a scene needs no window, so it is done first
+	if ((NULL != g_ConvertSceneInput) && (NULL != g_ConvertSceneOutput))
 	{
-		return(EXIT_FAILURE);
+		bool bConverted = SceneFile::ConvertTextScene(g_ConvertSceneInput, g_ConvertSceneOutput);
+		return(bConverted ? EXIT_SUCCESS : EXIT_FAILURE);
 	}
 
-	// try to create a new shader manager object
-	g_ShaderManager = new ShaderManager();
 	// try to create a new view manager object
-	g_ViewManager = new ViewManager(
-		g_ShaderManager);
+	g_ViewManager = new ViewManager();
 
-	// try to create the main display window
-	g_Window = g_ViewManager->CreateDisplayWindow(WINDOW_TITLE);
+	// try to create the main display window - when running offscreen
+	// the window is hidden and only used to own the OpenGL context
+	if (g_bOffscreen == true)
+	{
+		// contexts that need no display server are tried first - a
+		// surfaceless EGL context on the GPU driver, then a software
+		// OSMesa one - and otherwise a hidden window on the normal
+		// platform is used
+		const int HEADLESS_CONTEXT_APIS[2] = { GLFW_EGL_CONTEXT_API, GLFW_OSMESA_CONTEXT_API };
+		for (int i = 0; (i < 2) && (g_Window == NULL); i++)
+		{
+			if (InitializeGLFW(true, HEADLESS_CONTEXT_APIS[i]) == true)
+			{
+				g_Window = g_ViewManager->CreateOffscreenWindow(WINDOW_TITLE);
+			}
+		}
+		if (g_Window == NULL)
+		{
+			std::cout << "INFO: No headless OpenGL context, using a hidden window" << std::endl;
+			if (InitializeGLFW(false, GLFW_NATIVE_CONTEXT_API) == true)
+			{
+				g_Window = g_ViewManager->CreateOffscreenWindow(WINDOW_TITLE);
+			}
+		}
+	}
+	else if (InitializeGLFW(false, GLFW_NATIVE_CONTEXT_API) == true)
+	{
+		g_Window = g_ViewManager->CreateDisplayWindow(WINDOW_TITLE);
+	}
+
+	// if GLFW fails to create any window, then terminate the application
+	if (g_Window == NULL)
+	{
+		return(EXIT_FAILURE);
+	}
 
 	// if GLEW fails initialization, then terminate the application
 	if (InitializeGLEW() == false)
@@ -70,39 +199,101 @@ int main(int argc, char* argv[])
 		return(EXIT_FAILURE);
 	}
 
-	// load the shader code from the external GLSL files
-	g_ShaderManager->LoadShaders(
+	// the offscreen framebuffer can only be created once the
+	// OpenGL functions have been loaded by GLEW
+	if ((g_bOffscreen == true) &&
+		(g_ViewManager->CreateOffscreenTarget() == false))
+	{
+		return(EXIT_FAILURE);
+	}
+
+	// load the shader code from the external GLSL files - each
+	// feature mask that the scene draws with is compiled into its
+	// own program, started up front once the scene is prepared
+	// where the driver can compile in the background
+	g_StartupTime = glfwGetTime();
+	g_ShaderVariants = new ShaderVariants();
+	g_ShaderVariants->SetAsyncCompile(!g_bSyncShaders);
+	if (g_ShaderVariants->LoadSources(
 		"shaders/vertexShader.glsl",
-		"shaders/fragmentShader.glsl");
-	g_ShaderManager->use();
+		"shaders/fragmentShader.glsl") == false)
+	{
+		return(EXIT_FAILURE);
+	}
+	// a warm start loads the programs linked by an earlier run
+	if (NULL != g_ProgramCacheFile)
+	{
+		g_ShaderVariants->OpenProgramCache(g_ProgramCacheFile);
+	}
 
-	// try to create a new scene manager object and prepare the 3D scene
-	g_SceneManager = new SceneManager(g_ShaderManager);
-	g_SceneManager->PrepareScene();
+	// the camera and lights are shared by all programs through one
+	// uniform buffer that is written once per frame
+	g_FrameUniforms = new FrameUniforms();
+	g_FrameUniforms->Create();
+	g_ViewManager->SetFrameUniforms(g_FrameUniforms);
 
-	// loop will keep running until the application is closed 
-	// or until an error has occurred
-	while (!glfwWindowShouldClose(g_Window))
+	// try to create a new scene manager object and prepare the 3D scene
+	g_SceneManager = new SceneManager(g_ShaderVariants, g_FrameUniforms);
+	g_SceneManager->SetTextureDecodeThreads(g_TextureThreads);
+	g_SceneManager->SetTextureArrayMode(!g_bTextureUnits);
+	g_SceneManager->SetDrawSorting(!g_bUnsortedDraws);
+	g_SceneManager->SetFrustumCulling(!g_bNoCulling);
+	g_SceneManager->SetMultiDrawIndirect(!g_bNoMultiDraw);
+	g_SceneManager->SetLevelOfDetail(!g_bNoLevelOfDetail);
+	g_SceneManager->SetPackedVertices(g_bPackedVertices);
+	g_SceneManager->SetIndexOptimization(!g_bNoIndexOptimization);
+	g_SceneManager->SetStressObjectCount(g_StressObjects);
+	g_SceneManager->SetPointLightCount(g_PointLights);
+	g_SceneManager->SetLightClusters(!g_bNoLightClusters);
+	g_SceneManager->SetDeferredShading(g_bDeferredShading);
+	if (NULL != g_SceneFile)
 	{
-		// Enable z-depth
-		glEnable(GL_DEPTH_TEST);
+		g_SceneManager->SetSceneFile(g_SceneFile);
+	}
+	g_SceneManager->PrepareScene();
+	g_ViewManager->SetSceneManager(g_SceneManager);
 
-		// Clear the frame and z buffers
-		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	// replay or record the camera movement when requested
+	SetupCameraPath();
 
-		// convert from 3D object space to 2D view
-		g_ViewManager->PrepareSceneView();
+	if (g_bBenchmark == true)
+	{
+		// render a fixed number of profiled frames
+		RunBenchmark();
+	}
+	else if (g_bOffscreen == true)
+	{
+		// render a fixed number of frames without presenting them
+		RunOffscreen();
+	}
+	else
+	{
+		// loop will keep running until the application is closed 
+		// or until an error has occurred
+		while (!glfwWindowShouldClose(g_Window))
+		{
+			RenderFrame();
 
-		// refresh the 3D scene
-		g_SceneManager->RenderScene();
+			// Flips the the back buffer with the front buffer every frame.
+			glfwSwapBuffers(g_Window);
 
+			// query the latest GLFW events
+			glfwPollEvents();
+		}
+	}
 
-		// Flips the the back buffer with the front buffer every frame.
-		glfwSwapBuffers(g_Window);
+	// compare the shader startup cost of cold and warm starts
+	int cachedVariants = g_ShaderVariants->GetCachedVariantCount();
+	std::cout << "INFO: Compiled " << (g_ShaderVariants->GetVariantCount() - cachedVariants)
+		<< " shader variants in " << g_ShaderVariants->GetCompileTime() << " ms, loaded "
+		<< cachedVariants << " from the program cache in "
+		<< g_ShaderVariants->GetCacheLoadTime() << " ms" << std::endl;
+	g_ShaderVariants->SaveProgramCache();
 
-		// query the latest GLFW events
-		glfwPollEvents();
+	// save the recorded camera movement so it can be replayed
+	if ((NULL != g_CameraPath) && (NULL != g_RecordCameraFile))
+	{
+		g_CameraPath->SaveToFile(g_RecordCameraFile);
 	}
 
 	// clear the allocated manager objects from memory
@@ -116,26 +307,504 @@ int main(int argc, char* argv[])
 		delete g_ViewManager;
 		g_ViewManager = NULL;
 	}
-	if (NULL != g_ShaderManager)
+	if (NULL != g_ShaderVariants)
+	{
+		delete g_ShaderVariants;
+		g_ShaderVariants = NULL;
+	}
+	if (NULL != g_FrameUniforms)
+	{
+		delete g_FrameUniforms;
+		g_FrameUniforms = NULL;
+	}
+	if (NULL != g_CameraPath)
 	{
-		delete g_ShaderManager;
-		g_ShaderManager = NULL;
+		delete g_CameraPath;
+		g_CameraPath = NULL;
 	}
 
 	// Terminates the program successfully
 	exit(EXIT_SUCCESS);
 }
 
+/***********************************************************
+ *	ParseCommandLine()
+ *
+ *  This function is used to read the optional command line
+ *  arguments.  Supported options are:
+ *    --offscreen             render without a visible window
+ *    --frames <count>        number of frames to render offscreen
+ *                            or to benchmark
+ *    --output <file.ppm>     save the last offscreen frame
+ *    --benchmark             profile the frames and write a report
+ *    --json <file.json>      file for the benchmark report
+ *    --camera-path <file>    replay a recorded camera path
+ *    --record-camera <file>  record the camera path on exit, which
+ *                            cannot be combined with a replay
+ *    --timestep <seconds>    fixed time step for camera replay
+ *    --texture-threads <n>   texture decoding threads, 1 is serial
+ *    --texture-units         bind textures to separate units instead
+ *                            of using one texture array
+ *    --unsorted              submit draws without sorting them
+ *    --no-culling            draw objects outside of the view too
+ *    --no-multi-draw         issue one draw call per state group
+ *                            instead of one indirect multi-draw
+ *    --no-lod                draw every object with the full mesh
+ *                            detail
+ *    --packed-vertices       store the meshes with 16-bit positions,
+ *                            octahedral normals and half-float
+ *                            texture coordinates
+ *    --no-index-optimize     keep the mesh triangles in their
+ *                            generated order instead of reordering
+ *                            them for the vertex cache
+ *    --stress-objects <n>    add a grid of n small objects to the
+ *                            scene for measuring large scenes
+ *    --lights <n>            total number of point lights, filled
+ *                            up with small generated lights
+ *    --no-light-clusters     shade every point light for every
+ *                            fragment instead of binning them
+ *    --light-sweep           benchmark with 4 up to 1024 point
+ *                            lights, one report per light count
+ *    --deferred              light the visible pixels of a G-buffer
+ *                            instead of every drawn fragment, which
+ *                            can also be switched with the F and G
+ *                            keys while the window is open
+ *    --compare-paths         benchmark the forward and then the
+ *                            deferred path, one report per path
+ *    --shader-cache <file>   file that the linked shader programs
+ *                            are kept in between runs
+ *    --no-shader-cache       compile every shader program, for
+ *                            measuring a cold start
+ *    --sync-shaders          compile each shader program when it
+ *                            is first drawn with, instead of all
+ *                            of them in the background up front
+ *    --first-frame-latency   wait for the first frame and report
+ *                            the time since the shaders started
+ *                            loading, not used with --benchmark
+ *    --scene <file.scene>    binary scene file to load
+ *    --convert-scene <file.txt> <file.scene>
+ *                            convert a text scene description to a
+ *                            binary scene file and exit
+ ***********************************************************/
+void ParseCommandLine(int argc, char* argv[])
+{
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::strcmp(argv[i], "--offscreen") == 0)
+		{
+			g_bOffscreen = true;
+		}
+		else if ((std::strcmp(argv[i], "--frames") == 0) && (i + 1 < argc))
+		{
+			g_FrameCount = std::atoi(argv[++i]);
+			if (g_FrameCount <= 0)
+			{
+				g_FrameCount = 1;
+			}
+		}
+		else if ((std::strcmp(argv[i], "--output") == 0) && (i + 1 < argc))
+		{
+			g_OffscreenOutput = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--benchmark") == 0)
+		{
+			g_bBenchmark = true;
+		}
+		else if ((std::strcmp(argv[i], "--json") == 0) && (i + 1 < argc))
+		{
+			g_BenchmarkOutput = argv[++i];
+		}
+		else if ((std::strcmp(argv[i], "--camera-path") == 0) && (i + 1 < argc))
+		{
+			g_ReplayCameraFile = argv[++i];
+		}
+		else if ((std::strcmp(argv[i], "--record-camera") == 0) && (i + 1 < argc))
+		{
+			g_RecordCameraFile = argv[++i];
+		}
+		else if ((std::strcmp(argv[i], "--timestep") == 0) && (i + 1 < argc))
+		{
+			g_FixedTimestep = (float)std::atof(argv[++i]);
+			if (g_FixedTimestep <= 0.0f)
+			{
+				g_FixedTimestep = 1.0f / 60.0f;
+			}
+		}
+		else if ((std::strcmp(argv[i], "--texture-threads") == 0) && (i + 1 < argc))
+		{
+			g_TextureThreads = std::atoi(argv[++i]);
+		}
+		else if (std::strcmp(argv[i], "--texture-units") == 0)
+		{
+			g_bTextureUnits = true;
+		}
+		else if (std::strcmp(argv[i], "--unsorted") == 0)
+		{
+			g_bUnsortedDraws = true;
+		}
+		else if (std::strcmp(argv[i], "--no-culling") == 0)
+		{
+			g_bNoCulling = true;
+		}
+		else if (std::strcmp(argv[i], "--no-multi-draw") == 0)
+		{
+			g_bNoMultiDraw = true;
+		}
+		else if (std::strcmp(argv[i], "--no-lod") == 0)
+		{
+			g_bNoLevelOfDetail = true;
+		}
+		else if (std::strcmp(argv[i], "--packed-vertices") == 0)
+		{
+			g_bPackedVertices = true;
+		}
+		else if (std::strcmp(argv[i], "--no-index-optimize") == 0)
+		{
+			g_bNoIndexOptimization = true;
+		}
+		else if ((std::strcmp(argv[i], "--stress-objects") == 0) && (i + 1 < argc))
+		{
+			g_StressObjects = std::atoi(argv[++i]);
+		}
+		else if ((std::strcmp(argv[i], "--lights") == 0) && (i + 1 < argc))
+		{
+			g_PointLights = std::atoi(argv[++i]);
+		}
+		else if (std::strcmp(argv[i], "--no-light-clusters") == 0)
+		{
+			g_bNoLightClusters = true;
+		}
+		else if (std::strcmp(argv[i], "--light-sweep") == 0)
+		{
+			g_bLightSweep = true;
+			g_bBenchmark = true;
+		}
+		else if (std::strcmp(argv[i], "--deferred") == 0)
+		{
+			g_bDeferredShading = true;
+		}
+		else if (std::strcmp(argv[i], "--compare-paths") == 0)
+		{
+			g_bComparePaths = true;
+			g_bBenchmark = true;
+		}
+		else if ((std::strcmp(argv[i], "--shader-cache") == 0) && (i + 1 < argc))
+		{
+			g_ProgramCacheFile = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--no-shader-cache") == 0)
+		{
+			g_ProgramCacheFile = nullptr;
+		}
+		else if (std::strcmp(argv[i], "--sync-shaders") == 0)
+		{
+			g_bSyncShaders = true;
+		}
+		else if (std::strcmp(argv[i], "--first-frame-latency") == 0)
+		{
+			g_bFirstFrameLatency = true;
+		}
+		else if ((std::strcmp(argv[i], "--scene") == 0) && (i + 1 < argc))
+		{
+			g_SceneFile = argv[++i];
+		}
+		else if ((std::strcmp(argv[i], "--convert-scene") == 0) && (i + 2 < argc))
+		{
+			g_ConvertSceneInput = argv[++i];
+			g_ConvertSceneOutput = argv[++i];
+		}
+		else
+		{
+			std::cout << "WARNING: Unknown command line argument: " << argv[i] << std::endl;
+		}
+	}
+
+	// a replayed camera ignores live input, so there is nothing
+	// to record, and the file would only get a copy of the path
+	if ((NULL != g_RecordCameraFile) &&
+		((NULL != g_ReplayCameraFile) || (g_bBenchmark == true)))
+	{
+		std::cout << "WARNING: --record-camera is ignored while a camera path is replayed" << std::endl;
+		g_RecordCameraFile = nullptr;
+	}
+
+	// waiting for the first frame would stall a profiled frame
+	if ((g_bFirstFrameLatency == true) && (g_bBenchmark == true))
+	{
+		std::cout << "WARNING: --first-frame-latency is ignored while benchmarking" << std::endl;
+		g_bFirstFrameLatency = false;
+	}
+}
+
+/***********************************************************
+ *	SetupCameraPath()
+ *
+ *  This function is used to connect the camera path to the
+ *  view manager.  Benchmarks always replay a path - the
+ *  built-in orbit is used when no path file is given - with
+ *  a fixed time step so every run renders the same frames.
+ ***********************************************************/
+void SetupCameraPath()
+{
+	if ((g_bBenchmark == true) || (NULL != g_ReplayCameraFile))
+	{
+		g_CameraPath = new CameraPath();
+
+		bool bLoaded = false;
+		if (NULL != g_ReplayCameraFile)
+		{
+			bLoaded = g_CameraPath->LoadFromFile(g_ReplayCameraFile);
+		}
+		if (bLoaded == false)
+		{
+			g_CameraPath->CreateDefaultPath();
+		}
+
+		g_ViewManager->SetCameraReplay(g_CameraPath);
+		g_ViewManager->SetFixedTimestep(g_FixedTimestep);
+	}
+	else if (NULL != g_RecordCameraFile)
+	{
+		g_CameraPath = new CameraPath();
+		g_ViewManager->SetCameraRecording(g_CameraPath);
+	}
+}
+
+/***********************************************************
+ *	RenderFrame()
+ *
+ *  This function is used to draw one frame of the 3D scene
+ *  into the currently bound framebuffer.
+ ***********************************************************/
+void RenderFrame()
+{
+	// Enable z-depth
+	glEnable(GL_DEPTH_TEST);
+
+	// Clear the frame and z buffers
+	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	// convert from 3D object space to 2D view
+	g_ViewManager->PrepareSceneView();
+
+	// refresh the 3D scene
+	g_SceneManager->RenderScene();
+
+	// when asked for, the first frame waits for the GPU once, so
+	// its latency includes the shader programs it had to wait for
+	if ((g_bFirstFrameLatency == true) && (g_bFirstFrame == true))
+	{
+		glFinish();
+		g_bFirstFrame = false;
+		std::cout << "INFO: First frame finished "
+			<< ((glfwGetTime() - g_StartupTime) * 1000.0) << " ms after startup, "
+			<< g_ShaderVariants->GetPendingCount() << " shader variants still compiling" << std::endl;
+	}
+}
+
+/***********************************************************
+ *	RunOffscreen()
+ *
+ *  This function is used to render the configured number of
+ *  frames into the offscreen framebuffer and report the
+ *  achieved frames per second.
+ ***********************************************************/
+void RunOffscreen()
+{
+	double startTime = glfwGetTime();
+
+	for (int frame = 0; frame < g_FrameCount; frame++)
+	{
+		RenderFrame();
+
+		// keep the event queue serviced like the windowed loop does
+		glfwPollEvents();
+	}
+
+	// wait for the GPU to finish before stopping the clock so
+	// that queued work is included in the measurement
+	glFinish();
+	double elapsedTime = glfwGetTime() - startTime;
+
+	std::cout << "INFO: Offscreen rendered " << g_FrameCount << " frames in "
+		<< elapsedTime << " seconds" << std::endl;
+	if (elapsedTime > 0.0)
+	{
+		std::cout << "INFO: Offscreen frames per second: "
+			<< (g_FrameCount / elapsedTime) << std::endl;
+	}
+
+	if (NULL != g_OffscreenOutput)
+	{
+		g_ViewManager->SaveOffscreenFrame(g_OffscreenOutput);
+	}
+}
+
+/***********************************************************
+ *	RunBenchmark()
+ *
+ *  This function is used to render the configured number of
+ *  frames along the replayed camera path while recording the
+ *  CPU and GPU frame times and the draw call counts, and then
+ *  write the statistics to a JSON report.  A light sweep runs
+ *  the same camera path once per point light count, and a
+ *  path comparison once per render path, adding the count or
+ *  the path to the name of each report.
+ ***********************************************************/
+void RunBenchmark()
+{
+	// never wait for the display refresh while measuring
+	if (g_bOffscreen == false)
+	{
+		glfwSwapInterval(0);
+	}
+
+	if (g_bLightSweep == true)
+	{
+		for (int lightCount = LIGHT_SWEEP_FIRST; lightCount <= LIGHT_SWEEP_LAST; lightCount *= 2)
+		{
+			g_SceneManager->SetPointLightCount(lightCount);
+			g_ViewManager->SetCameraReplay(g_CameraPath);
+
+			std::string reportFile = GetReportFile("_lights" + std::to_string(lightCount));
+			ProfileFrames(reportFile.c_str());
+			if (glfwWindowShouldClose(g_Window))
+			{
+				break;
+			}
+		}
+	}
+	else if (g_bComparePaths == true)
+	{
+		const bool bDeferredPaths[2] = { false, true };
+		for (int path = 0; path < 2; path++)
+		{
+			g_SceneManager->SetDeferredShading(bDeferredPaths[path]);
+			g_ViewManager->SetCameraReplay(g_CameraPath);
+
+			std::string reportFile = GetReportFile(bDeferredPaths[path] ? "_deferred" : "_forward");
+			ProfileFrames(reportFile.c_str());
+			if (glfwWindowShouldClose(g_Window))
+			{
+				break;
+			}
+		}
+	}
+	else
+	{
+		ProfileFrames(g_BenchmarkOutput);
+	}
+
+	if ((g_bOffscreen == true) && (NULL != g_OffscreenOutput))
+	{
+		g_ViewManager->SaveOffscreenFrame(g_OffscreenOutput);
+	}
+}
+
+/***********************************************************
+ *	ProfileFrames()
+ *
+ *  This function is used to render and profile the configured
+ *  number of frames, and write the report to the passed in
+ *  file.
+ ***********************************************************/
+void ProfileFrames(const char* outputFile)
+{
+	FrameProfiler profiler;
+
+	for (int frame = 0; frame < g_FrameCount; frame++)
+	{
+		profiler.BeginFrame();
+
+		RenderFrame();
+		if (g_bOffscreen == false)
+		{
+			glfwSwapBuffers(g_Window);
+		}
+		glfwPollEvents();
+
+		profiler.EndFrame();
+
+		const SceneManager::RENDER_STATS& stats = g_SceneManager->GetRenderStats();
+		profiler.AddCounter("draw_calls", stats.drawCalls);
+		profiler.AddCounter("program_changes", stats.programChanges);
+		profiler.AddCounter("fallback_programs", stats.fallbackPrograms);
+		profiler.AddCounter("texture_changes", stats.textureChanges);
+		profiler.AddCounter("material_changes", stats.materialChanges);
+		profiler.AddCounter("mesh_changes", stats.meshChanges);
+		profiler.AddCounter("visible_objects", stats.visibleObjects);
+		profiler.AddCounter("culled_objects", stats.culledObjects);
+		profiler.AddCounter("transform_updates", stats.transformUpdates);
+		profiler.AddCounter("indirect_commands", stats.indirectCommands);
+		profiler.AddCounter("triangles", stats.triangles);
+		profiler.AddCounter("point_lights", stats.pointLights);
+		profiler.AddCounter("light_indices", stats.lightIndices);
+		profiler.AddCounter("forward_pass_gpu_ms", stats.passTimes[SceneManager::FORWARD_PASS]);
+		profiler.AddCounter("geometry_pass_gpu_ms", stats.passTimes[SceneManager::GEOMETRY_PASS]);
+		profiler.AddCounter("lighting_pass_gpu_ms", stats.passTimes[SceneManager::LIGHTING_PASS]);
+
+		if (glfwWindowShouldClose(g_Window))
+		{
+			break;
+		}
+	}
+
+	profiler.Finish();
+	profiler.WriteJSON(outputFile);
+}
+
+/***********************************************************
+ *	GetReportFile()
+ *
+ *  This function is used to get the name of a benchmark
+ *  report, with the passed in suffix added to the configured
+ *  report name in front of its extension.
+ ***********************************************************/
+std::string GetReportFile(const std::string& suffix)
+{
+	std::string reportName = g_BenchmarkOutput;
+	std::string reportExtension;
+	size_t extensionStart = reportName.rfind('.');
+	if ((extensionStart != std::string::npos) &&
+		(reportName.find_first_of("/\\", extensionStart) == std::string::npos))
+	{
+		reportExtension = reportName.substr(extensionStart);
+		reportName.erase(extensionStart);
+	}
+
+	return(reportName + suffix + reportExtension);
+}
+
 /***********************************************************
  *	InitializeGLFW()
  *
- *  This function is used to initialize the GLFW library.
+ *  This function is used to initialize the GLFW library.  A
+ *  headless setup uses the null platform with the passed in
+ *  context API - EGL or OSMesa - which needs no display
+ *  server, and fails when GLFW is too old for it.  Otherwise
+ *  the normal platform is used, with a hidden window for the
+ *  offscreen mode.
  ***********************************************************/
-bool InitializeGLFW()
+bool InitializeGLFW(bool bHeadless, int contextAPI)
 {
 	// GLFW: initialize and configure library
 	// --------------------------------------
-	glfwInit();
+#ifdef GLFW_PLATFORM_NULL
+	// the platform hint is kept between initializations
+	glfwInitHint(GLFW_PLATFORM, (bHeadless == true) ? GLFW_PLATFORM_NULL : GLFW_ANY_PLATFORM);
+#else
+	if (bHeadless == true)
+	{
+		return(false);
+	}
+#endif
+
+	if (glfwInit() == GLFW_FALSE)
+	{
+		std::cerr << "Failed to initialize GLFW" << std::endl;
+		return false;
+	}
 
 #ifdef __APPLE__
 	// set the version of OpenGL and profile to use
@@ -148,6 +817,15 @@ bool InitializeGLFW()
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 #endif
+
+	if (g_bOffscreen == true)
+	{
+		// the window only owns the context, so it is never shown
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	}
+	// the null platform has no native context, so it uses a
+	// surfaceless EGL or a software OSMesa (llvmpipe) context
+	glfwWindowHint(GLFW_CONTEXT_CREATION_API, contextAPI);
 	// GLFW: end -------------------------------
 
 	return(true);
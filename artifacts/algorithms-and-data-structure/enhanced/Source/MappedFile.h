@@ -0,0 +1,49 @@
+///////////////////////////////////////////////////////////////////////////////
+// mappedfile.h
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+
+/***********************************************************
+ *  MappedFile
+ *
+ *  This class maps a whole file read-only into memory, so
+ *  its contents can be used in place without being read into
+ *  a buffer first.  The pages are only loaded by the operating
+ *  system as they are touched.
+ ***********************************************************/
+class MappedFile
+{
+public:
+	// constructor
+	MappedFile();
+	// destructor
+	~MappedFile();
+
+	// map the passed in file, closing any file mapped before
+	bool Open(const char* filename);
+	// unmap the file
+	void Close();
+
+	// a file is mapped
+	bool IsOpen() const;
+	// first byte of the mapped file
+	const unsigned char* GetData() const;
+	// size of the mapped file in bytes
+	size_t GetSize() const;
+
+private:
+	// the mapping cannot be shared between two objects
+	MappedFile(const MappedFile&);
+	MappedFile& operator=(const MappedFile&);
+
+	const unsigned char* m_pData;
+	size_t m_size;
+#ifdef _WIN32
+	// handles of the open file and of its mapping
+	void* m_fileHandle;
+	void* m_mappingHandle;
+#endif
+};
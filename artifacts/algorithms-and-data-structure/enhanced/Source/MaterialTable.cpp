@@ -0,0 +1,131 @@
+///////////////////////////////////////////////////////////////////////////////
+// materialtable.cpp
+///////////////////////////////////////////////////////////////////////////////
+
+#include "MaterialTable.h"
+
+// the shader reads each material as two RGBA32F texels
+static_assert(sizeof(MaterialTable::MATERIAL_DATA) == MaterialTable::TEXELS_PER_MATERIAL * 16,
+	"material data must match the buffer texture layout");
+
+/***********************************************************
+ *  MaterialTable()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+MaterialTable::MaterialTable()
+{
+	m_bufferID = 0;
+	m_textureID = 0;
+}
+
+/***********************************************************
+ *  ~MaterialTable()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+MaterialTable::~MaterialTable()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  Add()
+ *
+ *  This method is used for adding a material.  The material
+ *  reaches the GPU with the next Upload().
+ ***********************************************************/
+int MaterialTable::Add(glm::vec3 diffuseColor, glm::vec3 specularColor, float shininess)
+{
+	MATERIAL_DATA material;
+	material.diffuseShininess = glm::vec4(diffuseColor, shininess);
+	material.specular = glm::vec4(specularColor, 0.0f);
+	m_materials.push_back(material);
+
+	return((int)m_materials.size() - 1);
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for removing all of the materials.
+ ***********************************************************/
+void MaterialTable::Clear()
+{
+	m_materials.clear();
+}
+
+/***********************************************************
+ *  GetCount()
+ *
+ *  This method is used for getting the number of materials.
+ ***********************************************************/
+int MaterialTable::GetCount() const
+{
+	return((int)m_materials.size());
+}
+
+/***********************************************************
+ *  Upload()
+ *
+ *  This method is used for writing all of the materials into
+ *  the GPU buffer with one update, creating the buffer and
+ *  its buffer texture the first time.
+ ***********************************************************/
+void MaterialTable::Upload()
+{
+	if (m_bufferID == 0)
+	{
+		glGenBuffers(1, &m_bufferID);
+		glGenTextures(1, &m_textureID);
+	}
+
+	// an empty table still gets one material, so that index zero
+	// is always safe to read
+	MATERIAL_DATA fallback;
+	fallback.diffuseShininess = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);
+	fallback.specular = glm::vec4(0.0f);
+	const MATERIAL_DATA* pData = m_materials.empty() ? &fallback : &m_materials[0];
+	size_t materialCount = m_materials.empty() ? 1 : m_materials.size();
+
+	glBindBuffer(GL_TEXTURE_BUFFER, m_bufferID);
+	glBufferData(GL_TEXTURE_BUFFER, materialCount * sizeof(MATERIAL_DATA), pData, GL_STATIC_DRAW);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+	glBindTexture(GL_TEXTURE_BUFFER, m_textureID);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, m_bufferID);
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
+}
+
+/***********************************************************
+ *  Bind()
+ *
+ *  This method is used for binding the buffer texture to a
+ *  texture unit, where it stays for the rest of the run.
+ ***********************************************************/
+void MaterialTable::Bind(int textureUnit) const
+{
+	glActiveTexture(GL_TEXTURE0 + textureUnit);
+	glBindTexture(GL_TEXTURE_BUFFER, m_textureID);
+	glActiveTexture(GL_TEXTURE0);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for releasing the GPU buffer and the
+ *  buffer texture.
+ ***********************************************************/
+void MaterialTable::Destroy()
+{
+	if (m_textureID != 0)
+	{
+		glDeleteTextures(1, &m_textureID);
+		m_textureID = 0;
+	}
+	if (m_bufferID != 0)
+	{
+		glDeleteBuffers(1, &m_bufferID);
+		m_bufferID = 0;
+	}
+}
@@ -0,0 +1,64 @@
+///////////////////////////////////////////////////////////////////////////////
+// materialtable.h
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  MaterialTable
+ *
+ *  This class contains the lighting materials of the scene
+ *  in one GPU buffer, read by the fragment shader through a
+ *  buffer texture.  The materials are uploaded once, and a
+ *  draw only selects its material by index, so changing the
+ *  material costs a single integer uniform.  A buffer texture
+ *  is available with GLSL 3.30 and holds many thousands of
+ *  materials, where a uniform block may be limited to 16 KB.
+ ***********************************************************/
+class MaterialTable
+{
+public:
+	// constructor
+	MaterialTable();
+	// destructor
+	~MaterialTable();
+
+	// number of RGBA32F texels that hold one material
+	static const int TEXELS_PER_MATERIAL = 2;
+
+	// GPU layout of one material
+	struct MATERIAL_DATA
+	{
+		// diffuse color in xyz, shininess in w
+		glm::vec4 diffuseShininess;
+		// specular color in xyz, w is unused
+		glm::vec4 specular;
+	};
+
+	// add a material and get its index
+	int Add(glm::vec3 diffuseColor, glm::vec3 specularColor, float shininess);
+	// remove all of the materials
+	void Clear();
+	// number of materials
+	int GetCount() const;
+
+	// write all of the materials into the GPU buffer
+	void Upload();
+	// bind the buffer texture to the passed in texture unit
+	void Bind(int textureUnit) const;
+	// release the GPU buffer and the buffer texture
+	void Destroy();
+
+private:
+	// CPU copy of the materials
+	std::vector<MATERIAL_DATA> m_materials;
+	// buffer holding the materials
+	GLuint m_bufferID;
+	// buffer texture reading the buffer as RGBA32F texels
+	GLuint m_textureID;
+};
@@ -0,0 +1,473 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshoptimizer.cpp
+///////////////////////////////////////////////////////////////////////////////
+
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+
+const float MeshOptimizer::DEFAULT_OVERDRAW_THRESHOLD = 1.05f;
+
+// declaration of global variables and functions
+namespace
+{
+	// scoring of the vertex cache order, from Forsyth's paper
+	const int SCORING_CACHE_SIZE = 32;
+	const float CACHE_DECAY_POWER = 1.5f;
+	const float LAST_TRIANGLE_SCORE = 0.75f;
+	const float VALENCE_BOOST_SCALE = 2.0f;
+	const float VALENCE_BOOST_POWER = 0.5f;
+
+	// a cluster of the overdraw order
+	struct TRIANGLE_CLUSTER
+	{
+		size_t firstTriangle;
+		size_t triangleCount;
+		float sortKey;
+	};
+
+	/***********************************************************
+	 *  VertexScore()
+	 *
+	 *  Score a vertex by its place in the simulated LRU cache,
+	 *  where the vertices of the last triangle score a little
+	 *  less than the ones just behind them, and boost vertices
+	 *  with few triangles left so they are finished off before
+	 *  they are evicted.
+	 ***********************************************************/
+	float VertexScore(int cachePosition, int remainingTriangles)
+	{
+		if (remainingTriangles == 0)
+		{
+			return (-1.0f);
+		}
+
+		float score = 0.0f;
+		if (cachePosition >= 0)
+		{
+			if (cachePosition < 3)
+			{
+				score = LAST_TRIANGLE_SCORE;
+			}
+			else
+			{
+				float scale = 1.0f / (float)(SCORING_CACHE_SIZE - 3);
+				score = std::pow(1.0f - ((float)(cachePosition - 3) * scale), CACHE_DECAY_POWER);
+			}
+		}
+		score += VALENCE_BOOST_SCALE * std::pow((float)remainingTriangles, -VALENCE_BOOST_POWER);
+
+		return (score);
+	}
+
+	/***********************************************************
+	 *  FetchPosition()
+	 *
+	 *  Read the position of a vertex from the start of a vertex
+	 *  of the passed in size.
+	 ***********************************************************/
+	const glm::vec3& FetchPosition(const glm::vec3* pPositions, size_t vertexStride, GLuint vertex)
+	{
+		const char* pVertex = (const char*)pPositions + (vertex * vertexStride);
+		return (*(const glm::vec3*)pVertex);
+	}
+
+	/***********************************************************
+	 *  SimulateTriangle()
+	 *
+	 *  Run one triangle through a FIFO cache kept as the time
+	 *  each vertex entered it, and return how many of its
+	 *  vertices had to be transformed.  Moving the time ahead by
+	 *  more than the cache size empties the cache.
+	 ***********************************************************/
+	int SimulateTriangle(
+		const GLuint* pTriangle,
+		std::vector<unsigned int>& entryTimes,
+		unsigned int& time,
+		int cacheSize)
+	{
+		int misses = 0;
+		for (int corner = 0; corner < 3; corner++)
+		{
+			GLuint vertex = pTriangle[corner];
+			if ((time - entryTimes[vertex]) > (unsigned int)cacheSize)
+			{
+				entryTimes[vertex] = time;
+				time++;
+				misses++;
+			}
+		}
+
+		return (misses);
+	}
+
+	/***********************************************************
+	 *  IndicesInRange()
+	 *
+	 *  Check that every index refers to one of the vertices.
+	 ***********************************************************/
+	bool IndicesInRange(const std::vector<GLuint>& indices, size_t vertexCount)
+	{
+		for (size_t i = 0; i < indices.size(); i++)
+		{
+			if (indices[i] >= vertexCount)
+			{
+				return (false);
+			}
+		}
+
+		return (true);
+	}
+}
+
+/***********************************************************
+ *  OptimizeVertexCache()
+ *
+ *  This method is used for reordering the triangles so that
+ *  consecutive triangles share as many vertices as possible.
+ *  Every step draws the best scoring triangle that uses a
+ *  vertex of the simulated cache, and only the scores of the
+ *  vertices that moved in the cache are updated, so the
+ *  ordering takes linear time.  When no cached vertex has a
+ *  triangle left, the next triangle in the original order
+ *  starts a new strip.
+ ***********************************************************/
+void MeshOptimizer::OptimizeVertexCache(
+	std::vector<GLuint>& indices,
+	size_t vertexCount)
+{
+	size_t triangleCount = indices.size() / 3;
+	if ((triangleCount == 0) || (IndicesInRange(indices, vertexCount) == false))
+	{
+		return;
+	}
+
+	// triangles of each vertex, as ranges of one array whose
+	// front part holds the triangles that are not drawn yet
+	std::vector<int> remaining(vertexCount, 0);
+	for (size_t i = 0; i < triangleCount * 3; i++)
+	{
+		remaining[indices[i]]++;
+	}
+	std::vector<size_t> adjacencyStart(vertexCount + 1, 0);
+	for (size_t vertex = 0; vertex < vertexCount; vertex++)
+	{
+		adjacencyStart[vertex + 1] = adjacencyStart[vertex] + remaining[vertex];
+	}
+	std::vector<size_t> adjacency(triangleCount * 3);
+	std::vector<size_t> fillCursor(adjacencyStart.begin(), adjacencyStart.end() - 1);
+	for (size_t triangle = 0; triangle < triangleCount; triangle++)
+	{
+		for (int corner = 0; corner < 3; corner++)
+		{
+			GLuint vertex = indices[(triangle * 3) + corner];
+			adjacency[fillCursor[vertex]++] = triangle;
+		}
+	}
+
+	std::vector<int> cachePosition(vertexCount, -1);
+	std::vector<float> vertexScore(vertexCount);
+	for (size_t vertex = 0; vertex < vertexCount; vertex++)
+	{
+		vertexScore[vertex] = VertexScore(-1, remaining[vertex]);
+	}
+	std::vector<bool> drawn(triangleCount, false);
+	std::vector<GLuint> ordered;
+	ordered.reserve(triangleCount * 3);
+
+	// LRU cache, with room for the vertices of one more triangle
+	GLuint cache[SCORING_CACHE_SIZE + 3];
+	int cacheCount = 0;
+	size_t scanCursor = 0;
+	size_t bestTriangle = 0;
+	bool bHaveBest = false;
+
+	for (size_t step = 0; step < triangleCount; step++)
+	{
+		if (bHaveBest == false)
+		{
+			while (drawn[scanCursor] == true)
+			{
+				scanCursor++;
+			}
+			bestTriangle = scanCursor;
+		}
+
+		// draw the triangle and take it out of its vertex lists
+		const GLuint* pTriangle = &indices[bestTriangle * 3];
+		drawn[bestTriangle] = true;
+		for (int corner = 0; corner < 3; corner++)
+		{
+			GLuint vertex = pTriangle[corner];
+			ordered.push_back(vertex);
+
+			size_t first = adjacencyStart[vertex];
+			size_t last = first + remaining[vertex] - 1;
+			for (size_t i = first; i <= last; i++)
+			{
+				if (adjacency[i] == bestTriangle)
+				{
+					std::swap(adjacency[i], adjacency[last]);
+					break;
+				}
+			}
+			remaining[vertex]--;
+		}
+
+		// move the vertices of the triangle to the front of the
+		// cache, pushing the others back
+		GLuint newCache[SCORING_CACHE_SIZE + 3];
+		int newCount = 0;
+		for (int corner = 0; corner < 3; corner++)
+		{
+			newCache[newCount++] = pTriangle[corner];
+		}
+		for (int i = 0; i < cacheCount; i++)
+		{
+			GLuint vertex = cache[i];
+			if ((vertex != pTriangle[0]) && (vertex != pTriangle[1]) && (vertex != pTriangle[2]))
+			{
+				newCache[newCount++] = vertex;
+			}
+		}
+
+		// vertices pushed past the end of the cache lose their
+		// cache score
+		for (int i = SCORING_CACHE_SIZE; i < newCount; i++)
+		{
+			GLuint vertex = newCache[i];
+			cachePosition[vertex] = -1;
+			vertexScore[vertex] = VertexScore(-1, remaining[vertex]);
+		}
+		cacheCount = std::min(newCount, SCORING_CACHE_SIZE);
+		for (int i = 0; i < cacheCount; i++)
+		{
+			GLuint vertex = newCache[i];
+			cache[i] = vertex;
+			cachePosition[vertex] = i;
+			vertexScore[vertex] = VertexScore(i, remaining[vertex]);
+		}
+
+		// rescore the triangles touching the cache and pick the best
+		float bestScore = -1.0f;
+		bHaveBest = false;
+		for (int i = 0; i < newCount; i++)
+		{
+			GLuint vertex = newCache[i];
+			size_t first = adjacencyStart[vertex];
+			for (size_t j = first; j < first + remaining[vertex]; j++)
+			{
+				size_t triangle = adjacency[j];
+				const GLuint* pOther = &indices[triangle * 3];
+				float score = vertexScore[pOther[0]] + vertexScore[pOther[1]] + vertexScore[pOther[2]];
+
+				if ((i < cacheCount) && (score > bestScore))
+				{
+					bestScore = score;
+					bestTriangle = triangle;
+					bHaveBest = true;
+				}
+			}
+		}
+	}
+
+	indices.swap(ordered);
+}
+
+/***********************************************************
+ *  OptimizeOverdraw()
+ *
+ *  This method is used for reordering the triangles so that
+ *  the parts of the mesh facing away from its center are
+ *  drawn first and hide the parts behind them.  The vertex
+ *  cache order is cut into clusters wherever the cache starts
+ *  over, and again wherever the ACMR of a cluster so far has
+ *  come down to the threshold times the ACMR of the whole
+ *  cluster, so moving the clusters costs little cache reuse.
+ *  The clusters are then sorted by how far they face outward.
+ ***********************************************************/
+void MeshOptimizer::OptimizeOverdraw(
+	std::vector<GLuint>& indices,
+	const glm::vec3* pPositions,
+	size_t vertexStride,
+	size_t vertexCount,
+	float threshold)
+{
+	size_t triangleCount = indices.size() / 3;
+	if ((triangleCount < 2) || (NULL == pPositions) ||
+		(IndicesInRange(indices, vertexCount) == false))
+	{
+		return;
+	}
+
+	// hard boundaries, where every vertex of a triangle misses
+	std::vector<unsigned int> entryTimes(vertexCount, 0);
+	unsigned int time = DEFAULT_CACHE_SIZE + 1;
+	std::vector<size_t> hardStarts;
+	for (size_t triangle = 0; triangle < triangleCount; triangle++)
+	{
+		int misses = SimulateTriangle(&indices[triangle * 3], entryTimes, time, DEFAULT_CACHE_SIZE);
+		if ((triangle == 0) || (misses == 3))
+		{
+			hardStarts.push_back(triangle);
+		}
+	}
+	hardStarts.push_back(triangleCount);
+
+	// soft boundaries inside each hard cluster
+	std::vector<TRIANGLE_CLUSTER> clusters;
+	for (size_t h = 0; h + 1 < hardStarts.size(); h++)
+	{
+		size_t start = hardStarts[h];
+		size_t end = hardStarts[h + 1];
+
+		time += DEFAULT_CACHE_SIZE + 1;
+		int clusterMisses = 0;
+		for (size_t triangle = start; triangle < end; triangle++)
+		{
+			clusterMisses += SimulateTriangle(&indices[triangle * 3], entryTimes, time, DEFAULT_CACHE_SIZE);
+		}
+		float clusterThreshold = threshold * ((float)clusterMisses / (float)(end - start));
+
+		time += DEFAULT_CACHE_SIZE + 1;
+		int runningMisses = 0;
+		size_t clusterStart = start;
+		for (size_t triangle = start; triangle < end; triangle++)
+		{
+			runningMisses += SimulateTriangle(&indices[triangle * 3], entryTimes, time, DEFAULT_CACHE_SIZE);
+
+			size_t runningCount = triangle - clusterStart + 1;
+			bool bLast = (triangle + 1 == end);
+			if ((bLast == true) || ((float)runningMisses / (float)runningCount <= clusterThreshold))
+			{
+				TRIANGLE_CLUSTER cluster;
+				cluster.firstTriangle = clusterStart;
+				cluster.triangleCount = runningCount;
+				cluster.sortKey = 0.0f;
+				clusters.push_back(cluster);
+
+				clusterStart = triangle + 1;
+				runningMisses = 0;
+				time += DEFAULT_CACHE_SIZE + 1;
+			}
+		}
+	}
+	if (clusters.size() < 2)
+	{
+		return;
+	}
+
+	// area weighted center of the mesh
+	glm::vec3 meshCenter = glm::vec3(0.0f);
+	float meshArea = 0.0f;
+	for (size_t triangle = 0; triangle < triangleCount; triangle++)
+	{
+		const GLuint* pTriangle = &indices[triangle * 3];
+		const glm::vec3& a = FetchPosition(pPositions, vertexStride, pTriangle[0]);
+		const glm::vec3& b = FetchPosition(pPositions, vertexStride, pTriangle[1]);
+		const glm::vec3& c = FetchPosition(pPositions, vertexStride, pTriangle[2]);
+
+		float area = glm::length(glm::cross(b - a, c - a));
+		meshCenter += (a + b + c) * (area / 3.0f);
+		meshArea += area;
+	}
+	if (meshArea > 0.0f)
+	{
+		meshCenter = meshCenter * (1.0f / meshArea);
+	}
+
+	// a cluster facing away from the center sorts first
+	for (size_t i = 0; i < clusters.size(); i++)
+	{
+		TRIANGLE_CLUSTER& cluster = clusters[i];
+		glm::vec3 center = glm::vec3(0.0f);
+		glm::vec3 normal = glm::vec3(0.0f);
+		float area = 0.0f;
+		for (size_t triangle = cluster.firstTriangle; triangle < cluster.firstTriangle + cluster.triangleCount; triangle++)
+		{
+			const GLuint* pTriangle = &indices[triangle * 3];
+			const glm::vec3& a = FetchPosition(pPositions, vertexStride, pTriangle[0]);
+			const glm::vec3& b = FetchPosition(pPositions, vertexStride, pTriangle[1]);
+			const glm::vec3& c = FetchPosition(pPositions, vertexStride, pTriangle[2]);
+
+			glm::vec3 faceNormal = glm::cross(b - a, c - a);
+			float faceArea = glm::length(faceNormal);
+			center += (a + b + c) * (faceArea / 3.0f);
+			normal += faceNormal;
+			area += faceArea;
+		}
+
+		float normalLength = glm::length(normal);
+		if ((area > 0.0f) && (normalLength > 0.0f))
+		{
+			center = center * (1.0f / area);
+			cluster.sortKey = glm::dot(center - meshCenter, normal * (1.0f / normalLength));
+		}
+	}
+	std::stable_sort(clusters.begin(), clusters.end(),
+		[](const TRIANGLE_CLUSTER& a, const TRIANGLE_CLUSTER& b)
+		{
+			return (a.sortKey > b.sortKey);
+		});
+
+	std::vector<GLuint> ordered;
+	ordered.reserve(triangleCount * 3);
+	for (size_t i = 0; i < clusters.size(); i++)
+	{
+		size_t first = clusters[i].firstTriangle * 3;
+		size_t last = first + (clusters[i].triangleCount * 3);
+		ordered.insert(ordered.end(), indices.begin() + first, indices.begin() + last);
+	}
+
+	indices.swap(ordered);
+}
+
+/***********************************************************
+ *  CountCacheMisses()
+ *
+ *  This method is used for counting how many vertices a GPU
+ *  with a FIFO post-transform cache of the passed in size
+ *  would transform to draw the triangles.
+ ***********************************************************/
+int MeshOptimizer::CountCacheMisses(
+	const std::vector<GLuint>& indices,
+	size_t vertexCount,
+	int cacheSize)
+{
+	if (IndicesInRange(indices, vertexCount) == false)
+	{
+		return((int)indices.size());
+	}
+
+	std::vector<unsigned int> entryTimes(vertexCount, 0);
+	unsigned int time = cacheSize + 1;
+	int misses = 0;
+	for (size_t triangle = 0; triangle < indices.size() / 3; triangle++)
+	{
+		misses += SimulateTriangle(&indices[triangle * 3], entryTimes, time, cacheSize);
+	}
+
+	return(misses);
+}
+
+/***********************************************************
+ *  ComputeAcmr()
+ *
+ *  This method is used for getting the average cache miss
+ *  ratio, the number of vertices transformed per triangle,
+ *  which ranges from 3 down to about 0.5 for a regular grid.
+ ***********************************************************/
+float MeshOptimizer::ComputeAcmr(
+	const std::vector<GLuint>& indices,
+	size_t vertexCount,
+	int cacheSize)
+{
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0)
+	{
+		return(0.0f);
+	}
+
+	return((float)CountCacheMisses(indices, vertexCount, cacheSize) / (float)triangleCount);
+}
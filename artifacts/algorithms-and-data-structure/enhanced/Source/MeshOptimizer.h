@@ -0,0 +1,54 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshoptimizer.h
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  MeshOptimizer
+ *
+ *  This class reorders the triangles of an indexed triangle
+ *  list so the GPU transforms fewer vertices and shades fewer
+ *  hidden pixels.  The vertex cache order follows Tom
+ *  Forsyth's linear-speed optimizer, and the overdraw order
+ *  then sorts clusters of that order so the outward facing
+ *  parts of the mesh are drawn first.  It only works on the
+ *  indices, so it can be used for any mesh, and the winding
+ *  of every triangle is kept.
+ ***********************************************************/
+class MeshOptimizer
+{
+public:
+	// size of the FIFO vertex cache that is simulated
+	static const int DEFAULT_CACHE_SIZE = 16;
+	// ACMR that the overdraw order may add to the cache order
+	static const float DEFAULT_OVERDRAW_THRESHOLD;
+
+	// reorder the triangles for the post-transform vertex cache
+	static void OptimizeVertexCache(
+		std::vector<GLuint>& indices,
+		size_t vertexCount);
+	// reorder clusters of triangles so the outer ones draw first
+	static void OptimizeOverdraw(
+		std::vector<GLuint>& indices,
+		const glm::vec3* pPositions,
+		size_t vertexStride,
+		size_t vertexCount,
+		float threshold);
+
+	// number of vertices transformed with a FIFO vertex cache
+	static int CountCacheMisses(
+		const std::vector<GLuint>& indices,
+		size_t vertexCount,
+		int cacheSize);
+	// average number of vertices transformed per triangle
+	static float ComputeAcmr(
+		const std::vector<GLuint>& indices,
+		size_t vertexCount,
+		int cacheSize);
+};
@@ -0,0 +1,168 @@
+///////////////////////////////////////////////////////////////////////////////
+// passtimer.cpp
+///////////////////////////////////////////////////////////////////////////////
+
+#include "PassTimer.h"
+
+/***********************************************************
+ *  PassTimer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+PassTimer::PassTimer()
+{
+	m_currentFrame = 0;
+	m_bSupported = false;
+	m_bCreated = false;
+	for (int frame = 0; frame < QUERY_RING_SIZE; frame++)
+	{
+		for (int pass = 0; pass < MAX_PASSES; pass++)
+		{
+			m_frames[frame].beginQueryIDs[pass] = 0;
+			m_frames[frame].endQueryIDs[pass] = 0;
+			m_frames[frame].bIssued[pass] = false;
+		}
+	}
+	for (int pass = 0; pass < MAX_PASSES; pass++)
+	{
+		m_passTimes[pass] = 0.0;
+	}
+}
+
+/***********************************************************
+ *  ~PassTimer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+PassTimer::~PassTimer()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is used for moving to the queries of the next
+ *  frame.  Those were issued several frames ago, so their
+ *  pass times are read first, normally without a stall.  The
+ *  queries are created the first time, once a context exists.
+ ***********************************************************/
+void PassTimer::BeginFrame()
+{
+	if (m_bCreated == false)
+	{
+		// timestamp queries are core since OpenGL 3.3
+		m_bSupported = (GLEW_VERSION_3_3 || GLEW_ARB_timer_query);
+		if (m_bSupported == true)
+		{
+			for (int frame = 0; frame < QUERY_RING_SIZE; frame++)
+			{
+				glGenQueries(MAX_PASSES, m_frames[frame].beginQueryIDs);
+				glGenQueries(MAX_PASSES, m_frames[frame].endQueryIDs);
+			}
+		}
+		m_bCreated = true;
+	}
+	if (m_bSupported == false)
+	{
+		return;
+	}
+
+	m_currentFrame = (m_currentFrame + 1) % QUERY_RING_SIZE;
+	FRAME_QUERIES& queries = m_frames[m_currentFrame];
+
+	// a frame that issued no queries keeps the previous times
+	bool bAnyIssued = false;
+	for (int pass = 0; pass < MAX_PASSES; pass++)
+	{
+		bAnyIssued = bAnyIssued || queries.bIssued[pass];
+	}
+	if (bAnyIssued == false)
+	{
+		return;
+	}
+
+	for (int pass = 0; pass < MAX_PASSES; pass++)
+	{
+		m_passTimes[pass] = 0.0;
+		if (queries.bIssued[pass] == true)
+		{
+			GLuint64 beginTime = 0;
+			GLuint64 endTime = 0;
+			glGetQueryObjectui64v(queries.beginQueryIDs[pass], GL_QUERY_RESULT, &beginTime);
+			glGetQueryObjectui64v(queries.endQueryIDs[pass], GL_QUERY_RESULT, &endTime);
+			if (endTime > beginTime)
+			{
+				m_passTimes[pass] = (double)(endTime - beginTime) / 1000000.0;
+			}
+			queries.bIssued[pass] = false;
+		}
+	}
+}
+
+/***********************************************************
+ *  BeginPass()
+ *
+ *  This method is used for recording the GPU time when the
+ *  commands of a pass start.
+ ***********************************************************/
+void PassTimer::BeginPass(int pass)
+{
+	if ((m_bSupported == true) && (pass >= 0) && (pass < MAX_PASSES))
+	{
+		glQueryCounter(m_frames[m_currentFrame].beginQueryIDs[pass], GL_TIMESTAMP);
+	}
+}
+
+/***********************************************************
+ *  EndPass()
+ *
+ *  This method is used for recording the GPU time when the
+ *  commands of a pass have finished.
+ ***********************************************************/
+void PassTimer::EndPass(int pass)
+{
+	if ((m_bSupported == true) && (pass >= 0) && (pass < MAX_PASSES))
+	{
+		glQueryCounter(m_frames[m_currentFrame].endQueryIDs[pass], GL_TIMESTAMP);
+		m_frames[m_currentFrame].bIssued[pass] = true;
+	}
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for releasing the queries.
+ ***********************************************************/
+void PassTimer::Destroy()
+{
+	if ((m_bCreated == true) && (m_bSupported == true))
+	{
+		for (int frame = 0; frame < QUERY_RING_SIZE; frame++)
+		{
+			glDeleteQueries(MAX_PASSES, m_frames[frame].beginQueryIDs);
+			glDeleteQueries(MAX_PASSES, m_frames[frame].endQueryIDs);
+			for (int pass = 0; pass < MAX_PASSES; pass++)
+			{
+				m_frames[frame].bIssued[pass] = false;
+			}
+		}
+	}
+	m_bCreated = false;
+}
+
+/***********************************************************
+ *  GetPassTime()
+ *
+ *  This method is used for getting the GPU time of a pass in
+ *  milliseconds, from the frame that was read most recently.
+ ***********************************************************/
+double PassTimer::GetPassTime(int pass) const
+{
+	if ((pass < 0) || (pass >= MAX_PASSES))
+	{
+		return(0.0);
+	}
+
+	return(m_passTimes[pass]);
+}
@@ -0,0 +1,64 @@
+///////////////////////////////////////////////////////////////////////////////
+// passtimer.h
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+/***********************************************************
+ *  PassTimer
+ *
+ *  This class measures the GPU time of the render passes of
+ *  a frame.  Each pass is bracketed by two timestamp queries,
+ *  which unlike elapsed time queries can be issued while the
+ *  frame profiler times the whole frame.  The queries are
+ *  kept in a ring of frames and read back a few frames later,
+ *  so reading them never waits for the GPU to catch up.
+ ***********************************************************/
+class PassTimer
+{
+public:
+	// constructor
+	PassTimer();
+	// destructor
+	~PassTimer();
+
+	// number of passes that can be timed in one frame
+	static const int MAX_PASSES = 4;
+
+	// start a frame and read the times of an earlier frame
+	void BeginFrame();
+	// mark the start and the end of a pass on the GPU
+	void BeginPass(int pass);
+	void EndPass(int pass);
+	// release the queries
+	void Destroy();
+
+	// GPU time of a pass in the most recently read frame, in
+	// milliseconds, or zero if the pass was not drawn then
+	double GetPassTime(int pass) const;
+
+private:
+	// number of frames that the queries are kept in flight for
+	static const int QUERY_RING_SIZE = 4;
+
+	// timestamps of the passes of one frame
+	struct FRAME_QUERIES
+	{
+		GLuint beginQueryIDs[MAX_PASSES];
+		GLuint endQueryIDs[MAX_PASSES];
+		bool bIssued[MAX_PASSES];
+	};
+
+	// queries used round-robin across frames
+	FRAME_QUERIES m_frames[QUERY_RING_SIZE];
+	// index of the queries for the current frame
+	int m_currentFrame;
+	// timestamp queries are supported by the context
+	bool m_bSupported;
+	// the queries have been created
+	bool m_bCreated;
+	// pass times of the most recently read frame
+	double m_passTimes[MAX_PASSES];
+};
@@ -0,0 +1,350 @@
+///////////////////////////////////////////////////////////////////////////////
+// programcache.cpp
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ProgramCache.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+// declaration of global variables and functions
+namespace
+{
+	// identifies a program cache file and its layout version
+	const char CACHE_MAGIC[4] = { 'P', 'R', 'G', 'C' };
+	const uint32_t CACHE_VERSION = 1;
+
+	// a larger binary means the file is damaged
+	const uint32_t MAX_BINARY_SIZE = 64 * 1024 * 1024;
+
+	// starting value and multiplier of the 64-bit FNV-1a hash
+	const uint64_t HASH_OFFSET = 14695981039346656037ull;
+	const uint64_t HASH_PRIME = 1099511628211ull;
+
+	/***********************************************************
+	 *  HashBytes()
+	 *
+	 *  Add bytes to a 64-bit FNV-1a hash.
+	 ***********************************************************/
+	uint64_t HashBytes(const char* bytes, size_t size, uint64_t hash)
+	{
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= (uint64_t)(unsigned char)bytes[i];
+			hash *= HASH_PRIME;
+		}
+
+		return (hash);
+	}
+
+	/***********************************************************
+	 *  HashDriverString()
+	 *
+	 *  Add a driver string to a hash, with its terminator so the
+	 *  strings cannot run into each other.
+	 ***********************************************************/
+	uint64_t HashDriverString(GLenum name, uint64_t hash)
+	{
+		const char* value = (const char*)glGetString(name);
+		if (NULL == value)
+		{
+			value = "";
+		}
+
+		return (HashBytes(value, std::strlen(value) + 1, hash));
+	}
+}
+
+/***********************************************************
+ *  ProgramCache()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ProgramCache::ProgramCache()
+{
+	m_driverHash = 0;
+	m_sourceHash = 0;
+	m_bOpen = false;
+	m_bDirty = false;
+}
+
+/***********************************************************
+ *  ~ProgramCache()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ProgramCache::~ProgramCache()
+{
+	Close();
+}
+
+/***********************************************************
+ *  IsSupported()
+ *
+ *  This method is used for checking whether the context can
+ *  save and load program binaries.  A driver can support the
+ *  calls but offer no binary format, which is the same as no
+ *  support.
+ ***********************************************************/
+bool ProgramCache::IsSupported()
+{
+	// program binaries are core since OpenGL 4.1
+	if (!(GLEW_VERSION_4_1 || GLEW_ARB_get_program_binary))
+	{
+		return(false);
+	}
+
+	GLint formatCount = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+
+	return(formatCount > 0);
+}
+
+/***********************************************************
+ *  Open()
+ *
+ *  This method is used for reading the cached programs from
+ *  the passed in file.  The programs are dropped when the
+ *  file was written from other shader sources or by another
+ *  driver, vendor or version, and are then written again by
+ *  Save().  A missing file leaves the cache empty, and it is
+ *  filled as the programs are compiled.
+ ***********************************************************/
+bool ProgramCache::Open(const char* filename, const std::string& sources)
+{
+	Close();
+
+	if (IsSupported() == false)
+	{
+		std::cout << "INFO: Program binaries are not supported, the shaders are always compiled" << std::endl;
+		return(false);
+	}
+
+	m_filename = filename;
+	m_driverHash = HashDriverString(GL_VENDOR, HASH_OFFSET);
+	m_driverHash = HashDriverString(GL_RENDERER, m_driverHash);
+	m_driverHash = HashDriverString(GL_VERSION, m_driverHash);
+	m_sourceHash = HashBytes(sources.data(), sources.size(), HASH_OFFSET);
+	m_bOpen = true;
+	m_bDirty = false;
+
+	std::ifstream file(filename, std::ios::in | std::ios::binary);
+	if (!file)
+	{
+		return(true);
+	}
+
+	FILE_HEADER header;
+	if ((!file.read((char*)&header, sizeof(header))) ||
+		(std::memcmp(header.magic, CACHE_MAGIC, sizeof(header.magic)) != 0) ||
+		(header.version != CACHE_VERSION))
+	{
+		std::cout << "INFO: Ignoring program cache with an unknown layout:" << filename << std::endl;
+		m_bDirty = true;
+		return(true);
+	}
+	if ((header.driverHash != m_driverHash) || (header.sourceHash != m_sourceHash))
+	{
+		std::cout << "INFO: Program cache was built by another driver or from other shaders:" << filename << std::endl;
+		m_bDirty = true;
+		return(true);
+	}
+
+	for (uint32_t i = 0; i < header.programCount; i++)
+	{
+		PROGRAM_HEADER programHeader;
+		if ((!file.read((char*)&programHeader, sizeof(programHeader))) ||
+			(programHeader.binarySize == 0) ||
+			(programHeader.binarySize > MAX_BINARY_SIZE))
+		{
+			m_bDirty = true;
+			break;
+		}
+
+		PROGRAM_BINARY& binary = m_programs[programHeader.definesHash];
+		binary.binaryFormat = (GLenum)programHeader.binaryFormat;
+		binary.data.resize(programHeader.binarySize);
+		if (!file.read(&binary.data[0], programHeader.binarySize))
+		{
+			m_programs.erase(programHeader.definesHash);
+			m_bDirty = true;
+			break;
+		}
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  LoadProgram()
+ *
+ *  This method is used for creating a program from the cached
+ *  binary of the passed in defines.  A driver can reject a
+ *  binary even from the same version, for example after a
+ *  change of hardware, so the binary is dropped when the
+ *  program does not link and 0 is returned.
+ ***********************************************************/
+GLuint ProgramCache::LoadProgram(const std::string& defines)
+{
+	if (m_bOpen == false)
+	{
+		return(0);
+	}
+
+	std::map<uint64_t, PROGRAM_BINARY>::iterator found =
+		m_programs.find(HashBytes(defines.data(), defines.size(), HASH_OFFSET));
+	if (found == m_programs.end())
+	{
+		return(0);
+	}
+
+	const PROGRAM_BINARY& binary = found->second;
+	GLuint programID = glCreateProgram();
+	glProgramBinary(programID, binary.binaryFormat, &binary.data[0], (GLsizei)binary.data.size());
+
+	GLint bLinked = GL_FALSE;
+	glGetProgramiv(programID, GL_LINK_STATUS, &bLinked);
+	if (bLinked == GL_FALSE)
+	{
+		glDeleteProgram(programID);
+		m_programs.erase(found);
+		m_bDirty = true;
+		return(0);
+	}
+
+	return(programID);
+}
+
+/***********************************************************
+ *  PrepareProgram()
+ *
+ *  This method is used for asking the driver to keep the
+ *  binary of a program, before the program is linked.
+ ***********************************************************/
+void ProgramCache::PrepareProgram(GLuint programID) const
+{
+	if (m_bOpen == true)
+	{
+		glProgramParameteri(programID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
+}
+
+/***********************************************************
+ *  StoreProgram()
+ *
+ *  This method is used for keeping the binary of a linked
+ *  program under its defines, for writing with Save().
+ ***********************************************************/
+void ProgramCache::StoreProgram(const std::string& defines, GLuint programID)
+{
+	if (m_bOpen == false)
+	{
+		return;
+	}
+
+	GLint binaryLength = 0;
+	glGetProgramiv(programID, GL_PROGRAM_BINARY_LENGTH, &binaryLength);
+	if (binaryLength <= 0)
+	{
+		return;
+	}
+
+	PROGRAM_BINARY binary;
+	binary.binaryFormat = 0;
+	binary.data.resize((size_t)binaryLength);
+	GLsizei writtenLength = 0;
+	glGetProgramBinary(programID, binaryLength, &writtenLength, &binary.binaryFormat, &binary.data[0]);
+	if (writtenLength <= 0)
+	{
+		return;
+	}
+	binary.data.resize((size_t)writtenLength);
+
+	PROGRAM_BINARY& stored = m_programs[HashBytes(defines.data(), defines.size(), HASH_OFFSET)];
+	stored.binaryFormat = binary.binaryFormat;
+	stored.data.swap(binary.data);
+	m_bDirty = true;
+}
+
+/***********************************************************
+ *  Save()
+ *
+ *  This method is used for writing the cached programs to the
+ *  cache file, only when they differ from what was read.
+ ***********************************************************/
+bool ProgramCache::Save()
+{
+	if ((m_bOpen == false) || (m_bDirty == false))
+	{
+		return(true);
+	}
+
+	std::ofstream file(m_filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!file)
+	{
+		std::cout << "Could not write program cache:" << m_filename << std::endl;
+		return(false);
+	}
+
+	FILE_HEADER header;
+	std::memcpy(header.magic, CACHE_MAGIC, sizeof(header.magic));
+	header.version = CACHE_VERSION;
+	header.driverHash = m_driverHash;
+	header.sourceHash = m_sourceHash;
+	header.programCount = (uint32_t)m_programs.size();
+	header.padding = 0;
+	file.write((const char*)&header, sizeof(header));
+
+	std::map<uint64_t, PROGRAM_BINARY>::const_iterator program;
+	for (program = m_programs.begin(); program != m_programs.end(); ++program)
+	{
+		PROGRAM_HEADER programHeader;
+		programHeader.definesHash = program->first;
+		programHeader.binaryFormat = (uint32_t)program->second.binaryFormat;
+		programHeader.binarySize = (uint32_t)program->second.data.size();
+		file.write((const char*)&programHeader, sizeof(programHeader));
+		file.write(&program->second.data[0], program->second.data.size());
+	}
+
+	std::cout << "Saved program cache:" << m_filename << ", programs:" << m_programs.size() << std::endl;
+	m_bDirty = false;
+
+	return(true);
+}
+
+/***********************************************************
+ *  Close()
+ *
+ *  This method is used for forgetting the cached programs.
+ *  Anything not written by Save() is lost.
+ ***********************************************************/
+void ProgramCache::Close()
+{
+	m_programs.clear();
+	m_filename.clear();
+	m_bOpen = false;
+	m_bDirty = false;
+}
+
+/***********************************************************
+ *  IsOpen()
+ *
+ *  This method is used for checking whether the cache file
+ *  is in use.
+ ***********************************************************/
+bool ProgramCache::IsOpen() const
+{
+	return(m_bOpen);
+}
+
+/***********************************************************
+ *  GetProgramCount()
+ *
+ *  This method is used for getting the number of programs in
+ *  the cache.
+ ***********************************************************/
+int ProgramCache::GetProgramCount() const
+{
+	return((int)m_programs.size());
+}
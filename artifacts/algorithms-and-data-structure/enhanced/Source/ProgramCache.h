@@ -0,0 +1,93 @@
+///////////////////////////////////////////////////////////////////////////////
+// programcache.h
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  ProgramCache
+ *
+ *  This class keeps the binaries of linked shader programs in
+ *  a file, so the next run can load them with glProgramBinary
+ *  instead of compiling the shaders again.  The file is only
+ *  used when it was written from the same shader sources by
+ *  the same driver, and each program in it is found by the
+ *  #defines it was compiled with.  A binary that the driver
+ *  rejects is dropped, and the program is compiled instead.
+ ***********************************************************/
+class ProgramCache
+{
+public:
+	// constructor
+	ProgramCache();
+	// destructor
+	~ProgramCache();
+
+	// the context can save and load program binaries
+	static bool IsSupported();
+
+	// read the cache file for the passed in shader sources
+	bool Open(const char* filename, const std::string& sources);
+	// create a program from the cached binary of a set of defines,
+	// or 0 when there is none or the driver rejects it
+	GLuint LoadProgram(const std::string& defines);
+	// ask the driver to keep the binary of a program it links
+	void PrepareProgram(GLuint programID) const;
+	// keep the binary of a linked program for its defines
+	void StoreProgram(const std::string& defines, GLuint programID);
+	// write the cache file when programs were added or dropped
+	bool Save();
+	// forget the cached programs without writing them
+	void Close();
+
+	// the cache file is in use
+	bool IsOpen() const;
+	// number of programs in the cache
+	int GetProgramCount() const;
+
+private:
+	// layout of the start of the cache file
+	struct FILE_HEADER
+	{
+		char magic[4];
+		uint32_t version;
+		uint64_t driverHash;
+		uint64_t sourceHash;
+		uint32_t programCount;
+		uint32_t padding;
+	};
+
+	// layout in front of the binary of every program
+	struct PROGRAM_HEADER
+	{
+		uint64_t definesHash;
+		uint32_t binaryFormat;
+		uint32_t binarySize;
+	};
+
+	// a program binary in the format of the driver
+	struct PROGRAM_BINARY
+	{
+		GLenum binaryFormat;
+		std::vector<char> data;
+	};
+
+	// file the programs are read from and written to
+	std::string m_filename;
+	// driver and shader sources the programs were built with
+	uint64_t m_driverHash;
+	uint64_t m_sourceHash;
+	// program binaries by the hash of their defines
+	std::map<uint64_t, PROGRAM_BINARY> m_programs;
+	// the cache file is in use
+	bool m_bOpen;
+	// the programs differ from the cache file
+	bool m_bDirty;
+};
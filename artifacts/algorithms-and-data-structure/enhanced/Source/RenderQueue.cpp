@@ -0,0 +1,315 @@
+///////////////////////////////////////////////////////////////////////////////
+// renderqueue.cpp
+///////////////////////////////////////////////////////////////////////////////
+
+#include "RenderQueue.h"
+
+#include <algorithm>
+#include <cstring>
+
+// declaration of global variables and functions
+namespace
+{
+	// bit widths of the sort key fields, from the highest bits:
+	// program | texture | material | mesh | lod | depth
+	const int PROGRAM_BITS = 4;
+	const int TEXTURE_BITS = 12;
+	const int MATERIAL_BITS = 10;
+	const int MESH_BITS = 4;
+	const int LOD_BITS = 2;
+	const int DEPTH_BITS = 32;
+
+	const int LOD_SHIFT = DEPTH_BITS;
+	const int MESH_SHIFT = LOD_SHIFT + LOD_BITS;
+	const int MATERIAL_SHIFT = MESH_SHIFT + MESH_BITS;
+	const int TEXTURE_SHIFT = MATERIAL_SHIFT + MATERIAL_BITS;
+	const int PROGRAM_SHIFT = TEXTURE_SHIFT + TEXTURE_BITS;
+
+	/***********************************************************
+	 *  PackField()
+	 *
+	 *  Clamp a value into a key field.  Negative values, which
+	 *  mean "none", are stored as zero so that they sort first.
+	 ***********************************************************/
+	uint64_t PackField(int value, int bits)
+	{
+		uint64_t maxValue = (1ull << bits) - 1;
+		uint64_t field = (value < 0) ? 0 : (uint64_t)value + 1;
+
+		return (std::min(field, maxValue));
+	}
+
+	/***********************************************************
+	 *  ComparePriority()
+	 *
+	 *  Order two draws by their sort keys.
+	 ***********************************************************/
+	bool ComparePriority(
+		const RenderQueue::DRAW_ITEM& a,
+		const RenderQueue::DRAW_ITEM& b)
+	{
+		return (a.sortKey < b.sortKey);
+	}
+}
+
+/***********************************************************
+ *  RenderQueue()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+RenderQueue::RenderQueue()
+{
+	m_bSortDraws = true;
+}
+
+/***********************************************************
+ *  ~RenderQueue()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+RenderQueue::~RenderQueue()
+{
+	Clear();
+}
+
+/***********************************************************
+ *  MakeSortKey()
+ *
+ *  This method is used for building the sort key of a draw.
+ *  The depth is a non-negative distance, whose float bits
+ *  already sort in the same order as the values, so draws
+ *  with the same state are ordered front to back.
+ ***********************************************************/
+uint64_t RenderQueue::MakeSortKey(
+	int program,
+	int textureHandle,
+	int materialIndex,
+	int mesh,
+	int lod,
+	float depth)
+{
+	uint32_t depthBits = 0;
+	depth = std::max(depth, 0.0f);
+	std::memcpy(&depthBits, &depth, sizeof(depthBits));
+
+	uint64_t key = 0;
+	key |= PackField(program, PROGRAM_BITS) << PROGRAM_SHIFT;
+	key |= PackField(textureHandle, TEXTURE_BITS) << TEXTURE_SHIFT;
+	key |= PackField(materialIndex, MATERIAL_BITS) << MATERIAL_SHIFT;
+	key |= PackField(mesh, MESH_BITS) << MESH_SHIFT;
+	key |= PackField(lod, LOD_BITS) << LOD_SHIFT;
+	key |= (uint64_t)depthBits;
+
+	return(key);
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for removing all of the queued draws.
+ *  The memory is kept for the next frame.
+ ***********************************************************/
+void RenderQueue::Clear()
+{
+	m_items.clear();
+	m_matrices.clear();
+	m_sphereX.clear();
+	m_sphereY.clear();
+	m_sphereZ.clear();
+	m_sphereRadius.clear();
+}
+
+/***********************************************************
+ *  Add()
+ *
+ *  This method is used for queueing a draw of one or more
+ *  instances of a mesh that share the same state.
+ ***********************************************************/
+void RenderQueue::Add(
+	int program,
+	int mesh,
+	int lod,
+	int textureHandle,
+	int materialIndex,
+	const glm::mat4* modelMatrices,
+	const glm::vec4* boundingSpheres,
+	int instanceCount,
+	float depth)
+{
+	if ((NULL == modelMatrices) || (instanceCount <= 0))
+	{
+		return;
+	}
+
+	DRAW_ITEM item;
+	item.sortKey = MakeSortKey(program, textureHandle, materialIndex, mesh, lod, depth);
+	item.program = program;
+	item.mesh = mesh;
+	item.lod = lod;
+	item.textureHandle = textureHandle;
+	item.materialIndex = materialIndex;
+	item.firstMatrix = (int)m_matrices.size();
+	item.firstSphere = -1;
+	item.instanceCount = instanceCount;
+
+	m_matrices.insert(m_matrices.end(), modelMatrices, modelMatrices + instanceCount);
+	if (NULL != boundingSpheres)
+	{
+		item.firstSphere = (int)m_sphereX.size();
+		for (int i = 0; i < instanceCount; i++)
+		{
+			m_sphereX.push_back(boundingSpheres[i].x);
+			m_sphereY.push_back(boundingSpheres[i].y);
+			m_sphereZ.push_back(boundingSpheres[i].z);
+			m_sphereRadius.push_back(boundingSpheres[i].w);
+		}
+	}
+	m_items.push_back(item);
+}
+
+/***********************************************************
+ *  Cull()
+ *
+ *  This method is used for testing the bounding spheres of
+ *  all queued instances against the frustum in one batch.
+ *  The visible model matrices of each draw are then moved to
+ *  the front of its range, and draws that have no visible
+ *  instance left are removed from the queue.  Draws queued
+ *  without bounding spheres were culled before they were
+ *  added and are kept as they are.
+ ***********************************************************/
+void RenderQueue::Cull(const FrustumCuller& culler)
+{
+	int sphereCount = (int)m_sphereX.size();
+	if (sphereCount == 0)
+	{
+		return;
+	}
+
+	m_visible.resize(sphereCount);
+	culler.TestSpheres(
+		&m_sphereX[0],
+		&m_sphereY[0],
+		&m_sphereZ[0],
+		&m_sphereRadius[0],
+		sphereCount,
+		&m_visible[0]);
+
+	size_t keptItems = 0;
+	for (size_t i = 0; i < m_items.size(); i++)
+	{
+		DRAW_ITEM item = m_items[i];
+
+		// compact the visible instances in place, which never
+		// overwrites an instance that has not been read yet
+		int visibleInstances = item.instanceCount;
+		if (item.firstSphere >= 0)
+		{
+			visibleInstances = 0;
+			for (int instance = 0; instance < item.instanceCount; instance++)
+			{
+				if (m_visible[item.firstSphere + instance] != 0)
+				{
+					m_matrices[item.firstMatrix + visibleInstances] = m_matrices[item.firstMatrix + instance];
+					visibleInstances++;
+				}
+			}
+		}
+
+		if (visibleInstances > 0)
+		{
+			item.instanceCount = visibleInstances;
+			m_items[keptItems] = item;
+			keptItems++;
+		}
+	}
+	m_items.resize(keptItems);
+}
+
+/***********************************************************
+ *  GetInstanceCount()
+ *
+ *  This method is used for getting the number of instances
+ *  in the queued draws, which drops after Cull().
+ ***********************************************************/
+int RenderQueue::GetInstanceCount() const
+{
+	int instanceCount = 0;
+	for (size_t i = 0; i < m_items.size(); i++)
+	{
+		instanceCount += m_items[i].instanceCount;
+	}
+
+	return(instanceCount);
+}
+
+/***********************************************************
+ *  Sort()
+ *
+ *  This method is used for ordering the queued draws by their
+ *  sort keys.  The sort is stable, so draws with equal keys
+ *  keep the order they were added in and frames are repeatable.
+ ***********************************************************/
+void RenderQueue::Sort()
+{
+	if (m_bSortDraws == true)
+	{
+		std::stable_sort(m_items.begin(), m_items.end(), ComparePriority);
+	}
+}
+
+/***********************************************************
+ *  SetSorting()
+ *
+ *  This method is used for choosing whether the draws are
+ *  sorted or submitted in the order they were added, which is
+ *  useful for measuring what the sorting saves.
+ ***********************************************************/
+void RenderQueue::SetSorting(bool bSortDraws)
+{
+	m_bSortDraws = bSortDraws;
+}
+
+/***********************************************************
+ *  IsSorting()
+ *
+ *  This method is used for checking whether the draws are
+ *  sorted.
+ ***********************************************************/
+bool RenderQueue::IsSorting() const
+{
+	return(m_bSortDraws);
+}
+
+/***********************************************************
+ *  GetItems()
+ *
+ *  This method is used for getting the queued draws.
+ ***********************************************************/
+const std::vector<RenderQueue::DRAW_ITEM>& RenderQueue::GetItems() const
+{
+	return(m_items);
+}
+
+/***********************************************************
+ *  GetMatrices()
+ *
+ *  This method is used for getting the model matrices of one
+ *  of the queued draws.
+ ***********************************************************/
+const glm::mat4* RenderQueue::GetMatrices(const DRAW_ITEM& item) const
+{
+	return(&m_matrices[item.firstMatrix]);
+}
+
+/***********************************************************
+ *  GetAllMatrices()
+ *
+ *  This method is used for getting the model matrices of all
+ *  of the queued draws, so they can be uploaded at once.  The
+ *  first matrix of each draw is its offset into the array.
+ ***********************************************************/
+const std::vector<glm::mat4>& RenderQueue::GetAllMatrices() const
+{
+	return(m_matrices);
+}
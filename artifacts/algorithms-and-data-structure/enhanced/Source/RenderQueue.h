@@ -0,0 +1,113 @@
+///////////////////////////////////////////////////////////////////////////////
+// renderqueue.h
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "FrustumCuller.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  RenderQueue
+ *
+ *  This class collects the draws of one frame before any of
+ *  them are submitted.  Every draw gets a 64-bit sort key
+ *  built from its program, texture, material, mesh, detail
+ *  level and depth,
+ *  so sorting the queue groups the draws that share state and
+ *  the submission only has to change what actually differs.
+ *
+ *  Each queued instance also carries a world-space bounding
+ *  sphere, kept in separate arrays per component, so all of
+ *  the instances of a frame are culled in one batch.
+ ***********************************************************/
+class RenderQueue
+{
+public:
+	// constructor
+	RenderQueue();
+	// destructor
+	~RenderQueue();
+
+	// one queued draw, covering one or more instances
+	struct DRAW_ITEM
+	{
+		uint64_t sortKey;
+		int program;
+		int mesh;
+		int lod;
+		int textureHandle;
+		int materialIndex;
+		int firstMatrix;
+		int firstSphere;
+		int instanceCount;
+	};
+
+	// build the sort key from the state of a draw, most
+	// expensive state change in the highest bits
+	static uint64_t MakeSortKey(
+		int program,
+		int textureHandle,
+		int materialIndex,
+		int mesh,
+		int lod,
+		float depth);
+
+	// remove all of the queued draws
+	void Clear();
+
+	// queue a draw of one or more instances of a mesh, with a
+	// world-space bounding sphere (center, radius) per instance,
+	// or no spheres for instances that were already culled
+	void Add(
+		int program,
+		int mesh,
+		int lod,
+		int textureHandle,
+		int materialIndex,
+		const glm::mat4* modelMatrices,
+		const glm::vec4* boundingSpheres,
+		int instanceCount,
+		float depth);
+
+	// remove the instances outside the frustum, dropping draws
+	// that have no visible instances
+	void Cull(const FrustumCuller& culler);
+
+	// number of queued instances left in the draws
+	int GetInstanceCount() const;
+
+	// order the queued draws by their sort keys
+	void Sort();
+
+	// choose whether Sort() reorders the draws
+	void SetSorting(bool bSortDraws);
+	bool IsSorting() const;
+
+	// the queued draws in submission order
+	const std::vector<DRAW_ITEM>& GetItems() const;
+	// the model matrices of a queued draw
+	const glm::mat4* GetMatrices(const DRAW_ITEM& item) const;
+	// the model matrices of all of the queued draws, indexed by
+	// the first matrix of each draw
+	const std::vector<glm::mat4>& GetAllMatrices() const;
+
+private:
+	// queued draws
+	std::vector<DRAW_ITEM> m_items;
+	// model matrices of all of the queued draws
+	std::vector<glm::mat4> m_matrices;
+	// bounding spheres of all of the queued instances
+	std::vector<float> m_sphereX;
+	std::vector<float> m_sphereY;
+	std::vector<float> m_sphereZ;
+	std::vector<float> m_sphereRadius;
+	// culling result of every queued instance
+	std::vector<unsigned char> m_visible;
+	// sort the draws, or keep them in the order they were added
+	bool m_bSortDraws;
+};
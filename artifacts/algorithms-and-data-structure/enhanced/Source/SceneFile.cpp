@@ -0,0 +1,622 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenefile.cpp
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SceneFile.h"
+#include "SceneMeshes.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// declaration of global variables and functions
+namespace
+{
+	// identifies a binary scene file and its layout version
+	const char SCENE_MAGIC[4] = { 'S', 'C', 'N', 'B' };
+	const uint32_t SCENE_VERSION = 1;
+
+	// names of the meshes in the text format, in ShapeMesh order
+	const char* MESH_NAMES[] =
+	{
+		"Cylinder",
+		"Plane",
+		"Sphere",
+		"TaperedCylinder",
+		"Torus"
+	};
+	static_assert(sizeof(MESH_NAMES) / sizeof(MESH_NAMES[0]) == (size_t)SceneMeshes::ShapeMesh::Count,
+		"every mesh needs a name in the scene text format");
+
+	// the records are read in place, so their layout is fixed
+	static_assert(sizeof(SceneFile::TEXTURE_RECORD) == 8, "unexpected texture record size");
+	static_assert(sizeof(SceneFile::MATERIAL_RECORD) == 32, "unexpected material record size");
+	static_assert(sizeof(SceneFile::NODE_RECORD) == 40, "unexpected node record size");
+	static_assert(sizeof(SceneFile::OBJECT_RECORD) == 16, "unexpected object record size");
+
+	// node of the text format, before it is put in depth-first order
+	struct TEXT_NODE
+	{
+		std::string name;
+		std::string parent;
+		SceneFile::NODE_RECORD record;
+	};
+
+	// object of the text format, before its references are resolved
+	struct TEXT_OBJECT
+	{
+		std::string node;
+		std::string mesh;
+		std::string texture;
+		std::string material;
+		int line;
+	};
+
+	/***********************************************************
+	 *  AddString()
+	 *
+	 *  Append a zero-terminated string to the string table and
+	 *  return its offset.
+	 ***********************************************************/
+	uint32_t AddString(std::string& strings, const std::string& value)
+	{
+		uint32_t offset = (uint32_t)strings.size();
+		strings += value;
+		strings.push_back('\0');
+
+		return (offset);
+	}
+
+	/***********************************************************
+	 *  FindName()
+	 *
+	 *  Look up a name, where "-" means no reference.  Returns
+	 *  false when the name is not known.
+	 ***********************************************************/
+	bool FindName(const std::map<std::string, int>& names, const std::string& name, int32_t& index)
+	{
+		index = SceneFile::NONE;
+		if (name == "-")
+		{
+			return (true);
+		}
+
+		std::map<std::string, int>::const_iterator found = names.find(name);
+		if (found == names.end())
+		{
+			return (false);
+		}
+		index = (int32_t)found->second;
+
+		return (true);
+	}
+
+	/***********************************************************
+	 *  IsSectionValid()
+	 *
+	 *  Check that a 4-byte aligned array of records fits into
+	 *  the file.
+	 ***********************************************************/
+	bool IsSectionValid(uint32_t offset, uint32_t count, size_t recordSize, size_t fileSize)
+	{
+		if (((offset % 4) != 0) || (offset > fileSize))
+		{
+			return (false);
+		}
+
+		return ((uint64_t)count <= (uint64_t)((fileSize - offset) / recordSize));
+	}
+}
+
+/***********************************************************
+ *  SceneFile()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+SceneFile::SceneFile()
+{
+	m_pHeader = NULL;
+}
+
+/***********************************************************
+ *  ~SceneFile()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+SceneFile::~SceneFile()
+{
+	Close();
+}
+
+/***********************************************************
+ *  Open()
+ *
+ *  This method is used for mapping a binary scene file.  The
+ *  header and the references between the records are checked
+ *  once here, so the records can be trusted when they are used.
+ ***********************************************************/
+bool SceneFile::Open(const char* filename)
+{
+	Close();
+
+	if (m_file.Open(filename) == false)
+	{
+		std::cout << "ERROR: could not map scene file " << filename << std::endl;
+		return(false);
+	}
+
+	m_pHeader = (const FILE_HEADER*)m_file.GetData();
+	if (Validate() == false)
+	{
+		std::cout << "ERROR: " << filename << " is not a valid scene file" << std::endl;
+		Close();
+		return(false);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  Close()
+ *
+ *  This method is used for unmapping the scene file.  The
+ *  record pointers are invalid afterwards.
+ ***********************************************************/
+void SceneFile::Close()
+{
+	m_file.Close();
+	m_pHeader = NULL;
+}
+
+/***********************************************************
+ *  GetTextureCount()
+ *
+ *  These methods are used for getting the records of the
+ *  file, which point directly into the mapped memory, or
+ *  NULL when no file is open.
+ ***********************************************************/
+uint32_t SceneFile::GetTextureCount() const
+{
+	return((NULL != m_pHeader) ? m_pHeader->textureCount : 0);
+}
+
+const SceneFile::TEXTURE_RECORD* SceneFile::GetTextures() const
+{
+	return((NULL != m_pHeader) ? (const TEXTURE_RECORD*)GetSection(m_pHeader->textureOffset) : NULL);
+}
+
+uint32_t SceneFile::GetMaterialCount() const
+{
+	return((NULL != m_pHeader) ? m_pHeader->materialCount : 0);
+}
+
+const SceneFile::MATERIAL_RECORD* SceneFile::GetMaterials() const
+{
+	return((NULL != m_pHeader) ? (const MATERIAL_RECORD*)GetSection(m_pHeader->materialOffset) : NULL);
+}
+
+uint32_t SceneFile::GetNodeCount() const
+{
+	return((NULL != m_pHeader) ? m_pHeader->nodeCount : 0);
+}
+
+const SceneFile::NODE_RECORD* SceneFile::GetNodes() const
+{
+	return((NULL != m_pHeader) ? (const NODE_RECORD*)GetSection(m_pHeader->nodeOffset) : NULL);
+}
+
+uint32_t SceneFile::GetObjectCount() const
+{
+	return((NULL != m_pHeader) ? m_pHeader->objectCount : 0);
+}
+
+const SceneFile::OBJECT_RECORD* SceneFile::GetObjects() const
+{
+	return((NULL != m_pHeader) ? (const OBJECT_RECORD*)GetSection(m_pHeader->objectOffset) : NULL);
+}
+
+/***********************************************************
+ *  GetString()
+ *
+ *  This method is used for getting a string of the string
+ *  table by its offset.
+ ***********************************************************/
+const char* SceneFile::GetString(uint32_t offset) const
+{
+	if ((NULL == m_pHeader) || (offset >= m_pHeader->stringsSize))
+	{
+		return("");
+	}
+
+	return((const char*)GetSection(m_pHeader->stringsOffset) + offset);
+}
+
+/***********************************************************
+ *  ConvertTextScene()
+ *
+ *  This method is used for converting a text scene description
+ *  into a binary scene file.  The nodes may be listed in any
+ *  order; they are written in depth-first order with the roots
+ *  and the children of each node in the order of the text, and
+ *  the objects are written in the order of their nodes.
+ ***********************************************************/
+bool SceneFile::ConvertTextScene(const char* textFilename, const char* binaryFilename)
+{
+	std::ifstream textFile(textFilename);
+	if (!textFile)
+	{
+		std::cout << "ERROR: could not open scene text " << textFilename << std::endl;
+		return(false);
+	}
+
+	std::string strings;
+	std::vector<TEXTURE_RECORD> textures;
+	std::vector<MATERIAL_RECORD> materials;
+	std::vector<TEXT_NODE> textNodes;
+	std::vector<TEXT_OBJECT> textObjects;
+	std::map<std::string, int> textureNames;
+	std::map<std::string, int> materialNames;
+	std::map<std::string, int> nodeNames;
+
+	std::string line;
+	int lineNumber = 0;
+	while (std::getline(textFile, line))
+	{
+		lineNumber++;
+		if ((line.empty() == true) || (line[0] == '#') || (line[0] == '\r'))
+		{
+			continue;
+		}
+
+		std::istringstream values(line);
+		std::string keyword;
+		std::string name;
+		bool bValid = false;
+		values >> keyword >> name;
+
+		if (keyword == "texture")
+		{
+			std::string filename;
+			bValid = (bool)(values >> filename) && (textureNames.count(name) == 0);
+			if (bValid == true)
+			{
+				TEXTURE_RECORD record;
+				record.tagOffset = AddString(strings, name);
+				record.filenameOffset = AddString(strings, filename);
+				textureNames[name] = (int)textures.size();
+				textures.push_back(record);
+			}
+		}
+		else if (keyword == "material")
+		{
+			MATERIAL_RECORD record;
+			bValid = (bool)(values
+				>> record.diffuseColor[0] >> record.diffuseColor[1] >> record.diffuseColor[2]
+				>> record.specularColor[0] >> record.specularColor[1] >> record.specularColor[2]
+				>> record.shininess) && (materialNames.count(name) == 0);
+			if (bValid == true)
+			{
+				record.tagOffset = AddString(strings, name);
+				materialNames[name] = (int)materials.size();
+				materials.push_back(record);
+			}
+		}
+		else if (keyword == "node")
+		{
+			TEXT_NODE node;
+			node.name = name;
+			node.record.parent = NONE;
+			bValid = (bool)(values >> node.parent
+				>> node.record.scale[0] >> node.record.scale[1] >> node.record.scale[2]
+				>> node.record.rotationDegrees[0] >> node.record.rotationDegrees[1] >> node.record.rotationDegrees[2]
+				>> node.record.position[0] >> node.record.position[1] >> node.record.position[2])
+				&& (nodeNames.count(name) == 0);
+			if (bValid == true)
+			{
+				nodeNames[name] = (int)textNodes.size();
+				textNodes.push_back(node);
+			}
+		}
+		else if (keyword == "object")
+		{
+			TEXT_OBJECT object;
+			object.node = name;
+			object.line = lineNumber;
+			bValid = (bool)(values >> object.mesh >> object.texture >> object.material);
+			if (bValid == true)
+			{
+				textObjects.push_back(object);
+			}
+		}
+
+		if (bValid == false)
+		{
+			std::cout << "ERROR: " << textFilename << ":" << lineNumber
+				<< ": invalid or duplicate record" << std::endl;
+			return(false);
+		}
+	}
+
+	// collect the children of every node in the order of the text
+	int nodeCount = (int)textNodes.size();
+	std::vector<std::vector<int> > children(nodeCount);
+	std::vector<int> roots;
+	for (int i = 0; i < nodeCount; i++)
+	{
+		if (textNodes[i].parent == "-")
+		{
+			roots.push_back(i);
+			continue;
+		}
+
+		std::map<std::string, int>::const_iterator parent = nodeNames.find(textNodes[i].parent);
+		if (parent == nodeNames.end())
+		{
+			std::cout << "ERROR: node " << textNodes[i].name << " has an unknown parent "
+				<< textNodes[i].parent << std::endl;
+			return(false);
+		}
+		children[parent->second].push_back(i);
+	}
+
+	// number the nodes in depth-first order
+	std::vector<NODE_RECORD> nodes;
+	std::vector<int> nodeOrder(nodeCount, -1);
+	std::vector<int> stack;
+	nodes.reserve(nodeCount);
+	for (size_t root = 0; root < roots.size(); root++)
+	{
+		stack.push_back(roots[root]);
+		while (stack.empty() == false)
+		{
+			int node = stack.back();
+			stack.pop_back();
+
+			NODE_RECORD record = textNodes[node].record;
+			if (textNodes[node].parent != "-")
+			{
+				record.parent = nodeOrder[nodeNames[textNodes[node].parent]];
+			}
+			nodeOrder[node] = (int)nodes.size();
+			nodes.push_back(record);
+
+			// push in reverse so the first child is visited first
+			for (size_t child = children[node].size(); child > 0; child--)
+			{
+				stack.push_back(children[node][child - 1]);
+			}
+		}
+	}
+
+	// nodes that were never reached are part of a parent cycle
+	if ((int)nodes.size() != nodeCount)
+	{
+		std::cout << "ERROR: the nodes of " << textFilename << " contain a parent cycle" << std::endl;
+		return(false);
+	}
+
+	// resolve the references of the objects
+	std::vector<OBJECT_RECORD> objects;
+	std::vector<unsigned char> nodeUsed(nodeCount, 0);
+	for (size_t i = 0; i < textObjects.size(); i++)
+	{
+		const TEXT_OBJECT& textObject = textObjects[i];
+		OBJECT_RECORD record;
+		int32_t node = NONE;
+
+		record.mesh = (uint32_t)SceneMeshes::ShapeMesh::Count;
+		for (uint32_t mesh = 0; mesh < (uint32_t)SceneMeshes::ShapeMesh::Count; mesh++)
+		{
+			if (textObject.mesh == MESH_NAMES[mesh])
+			{
+				record.mesh = mesh;
+			}
+		}
+
+		bool bValid = FindName(nodeNames, textObject.node, node) && (node != NONE) &&
+			FindName(textureNames, textObject.texture, record.texture) &&
+			FindName(materialNames, textObject.material, record.material) &&
+			(record.mesh < (uint32_t)SceneMeshes::ShapeMesh::Count);
+		if ((bValid == true) && (nodeUsed[node] != 0))
+		{
+			bValid = false;
+		}
+		if (bValid == false)
+		{
+			std::cout << "ERROR: " << textFilename << ":" << textObject.line
+				<< ": unknown reference, or a second object on the same node" << std::endl;
+			return(false);
+		}
+
+		nodeUsed[node] = 1;
+		record.node = (uint32_t)nodeOrder[node];
+		objects.push_back(record);
+	}
+	std::stable_sort(objects.begin(), objects.end(),
+		[](const OBJECT_RECORD& a, const OBJECT_RECORD& b) { return a.node < b.node; });
+
+	// lay the sections out one after another behind the header
+	if (strings.empty() == true)
+	{
+		strings.push_back('\0');
+	}
+	while ((strings.size() % 4) != 0)
+	{
+		strings.push_back('\0');
+	}
+
+	FILE_HEADER header;
+	std::memcpy(header.magic, SCENE_MAGIC, sizeof(header.magic));
+	header.version = SCENE_VERSION;
+	header.textureCount = (uint32_t)textures.size();
+	header.textureOffset = (uint32_t)sizeof(FILE_HEADER);
+	header.materialCount = (uint32_t)materials.size();
+	header.materialOffset = header.textureOffset + header.textureCount * (uint32_t)sizeof(TEXTURE_RECORD);
+	header.nodeCount = (uint32_t)nodes.size();
+	header.nodeOffset = header.materialOffset + header.materialCount * (uint32_t)sizeof(MATERIAL_RECORD);
+	header.objectCount = (uint32_t)objects.size();
+	header.objectOffset = header.nodeOffset + header.nodeCount * (uint32_t)sizeof(NODE_RECORD);
+	header.stringsSize = (uint32_t)strings.size();
+	header.stringsOffset = header.objectOffset + header.objectCount * (uint32_t)sizeof(OBJECT_RECORD);
+	header.fileSize = header.stringsOffset + header.stringsSize;
+
+	std::ofstream binaryFile(binaryFilename, std::ios::binary);
+	if (!binaryFile)
+	{
+		std::cout << "ERROR: could not write scene file " << binaryFilename << std::endl;
+		return(false);
+	}
+
+	binaryFile.write((const char*)&header, sizeof(header));
+	if (textures.empty() == false)
+	{
+		binaryFile.write((const char*)&textures[0], textures.size() * sizeof(TEXTURE_RECORD));
+	}
+	if (materials.empty() == false)
+	{
+		binaryFile.write((const char*)&materials[0], materials.size() * sizeof(MATERIAL_RECORD));
+	}
+	if (nodes.empty() == false)
+	{
+		binaryFile.write((const char*)&nodes[0], nodes.size() * sizeof(NODE_RECORD));
+	}
+	if (objects.empty() == false)
+	{
+		binaryFile.write((const char*)&objects[0], objects.size() * sizeof(OBJECT_RECORD));
+	}
+	binaryFile.write(strings.data(), strings.size());
+
+	if (!binaryFile)
+	{
+		std::cout << "ERROR: could not write scene file " << binaryFilename << std::endl;
+		return(false);
+	}
+
+	std::cout << "INFO: Converted " << textFilename << " to " << binaryFilename << ": "
+		<< header.textureCount << " textures, " << header.materialCount << " materials, "
+		<< header.nodeCount << " nodes, " << header.objectCount << " objects" << std::endl;
+
+	return(true);
+}
+
+/***********************************************************
+ *  Validate()
+ *
+ *  This method is used for checking the mapped file before
+ *  any record is used: the header has to match, every section
+ *  has to fit into the file, the strings have to be terminated
+ *  and every reference has to point at an existing record.
+ *  The nodes have to be in depth-first order, the way the
+ *  scene graph adds them, so each parent is the previous node
+ *  or one of its ancestors, and a node holds one object.
+ ***********************************************************/
+bool SceneFile::Validate() const
+{
+	size_t fileSize = m_file.GetSize();
+	if ((NULL == m_pHeader) || (fileSize < sizeof(FILE_HEADER)))
+	{
+		return(false);
+	}
+
+	const FILE_HEADER& header = *m_pHeader;
+	if ((std::memcmp(header.magic, SCENE_MAGIC, sizeof(header.magic)) != 0) ||
+		(header.version != SCENE_VERSION) ||
+		(header.fileSize != fileSize))
+	{
+		return(false);
+	}
+
+	if ((IsSectionValid(header.textureOffset, header.textureCount, sizeof(TEXTURE_RECORD), fileSize) == false) ||
+		(IsSectionValid(header.materialOffset, header.materialCount, sizeof(MATERIAL_RECORD), fileSize) == false) ||
+		(IsSectionValid(header.nodeOffset, header.nodeCount, sizeof(NODE_RECORD), fileSize) == false) ||
+		(IsSectionValid(header.objectOffset, header.objectCount, sizeof(OBJECT_RECORD), fileSize) == false) ||
+		(IsSectionValid(header.stringsOffset, header.stringsSize, 1, fileSize) == false) ||
+		(header.stringsSize == 0))
+	{
+		return(false);
+	}
+
+	// the last string must be terminated inside the table
+	const char* strings = (const char*)GetSection(header.stringsOffset);
+	if (strings[header.stringsSize - 1] != '\0')
+	{
+		return(false);
+	}
+
+	const TEXTURE_RECORD* textures = GetTextures();
+	for (uint32_t i = 0; i < header.textureCount; i++)
+	{
+		if ((textures[i].tagOffset >= header.stringsSize) ||
+			(textures[i].filenameOffset >= header.stringsSize))
+		{
+			return(false);
+		}
+	}
+
+	const MATERIAL_RECORD* materials = GetMaterials();
+	for (uint32_t i = 0; i < header.materialCount; i++)
+	{
+		if (materials[i].tagOffset >= header.stringsSize)
+		{
+			return(false);
+		}
+	}
+
+	// the path from a root to the previous node, which is where
+	// the next node has to be added
+	const NODE_RECORD* nodes = GetNodes();
+	std::vector<int32_t> path;
+	for (uint32_t i = 0; i < header.nodeCount; i++)
+	{
+		if (nodes[i].parent == NONE)
+		{
+			path.clear();
+		}
+		else
+		{
+			while ((path.empty() == false) && (path.back() != nodes[i].parent))
+			{
+				path.pop_back();
+			}
+			if (path.empty() == true)
+			{
+				return(false);
+			}
+		}
+		path.push_back((int32_t)i);
+	}
+
+	const OBJECT_RECORD* objects = GetObjects();
+	std::vector<unsigned char> nodeUsed(header.nodeCount, 0);
+	for (uint32_t i = 0; i < header.objectCount; i++)
+	{
+		const OBJECT_RECORD& object = objects[i];
+		if ((object.node >= header.nodeCount) ||
+			(nodeUsed[object.node] != 0) ||
+			(object.mesh >= (uint32_t)SceneMeshes::ShapeMesh::Count) ||
+			((object.texture != NONE) && ((object.texture < 0) || ((uint32_t)object.texture >= header.textureCount))) ||
+			((object.material != NONE) && ((object.material < 0) || ((uint32_t)object.material >= header.materialCount))))
+		{
+			return(false);
+		}
+		nodeUsed[object.node] = 1;
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  GetSection()
+ *
+ *  This method is used for getting a pointer to a section of
+ *  the mapped file by its offset.
+ ***********************************************************/
+const void* SceneFile::GetSection(uint32_t offset) const
+{
+	return(m_file.GetData() + offset);
+}
@@ -0,0 +1,124 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenefile.h
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "MappedFile.h"
+
+#include <cstdint>
+
+/***********************************************************
+ *  SceneFile
+ *
+ *  This class reads a binary scene description through a
+ *  memory mapping.  The file is a header followed by packed
+ *  arrays of texture, material, node and object records and a
+ *  table of zero-terminated strings, so after the header has
+ *  been checked every record is used in place with no parsing
+ *  and no allocation.  The nodes are stored in depth-first
+ *  order, ready for the scene graph.
+ *
+ *  The binary files are written by ConvertTextScene() from a
+ *  text description with one record per line:
+ *    texture  <tag> <image file>
+ *    material <tag> <diffuse r g b> <specular r g b> <shininess>
+ *    node     <name> <parent name or -> <scale x y z>
+ *             <rotation x y z degrees> <position x y z>
+ *    object   <node name> <mesh name> <texture tag or -> <material tag or ->
+ *  Empty lines and lines starting with '#' are skipped.
+ ***********************************************************/
+class SceneFile
+{
+public:
+	// constructor
+	SceneFile();
+	// destructor
+	~SceneFile();
+
+	// value of a reference that is not set
+	static const int32_t NONE = -1;
+
+	// texture image and the tag it is registered with
+	struct TEXTURE_RECORD
+	{
+		uint32_t tagOffset;
+		uint32_t filenameOffset;
+	};
+
+	// lighting material
+	struct MATERIAL_RECORD
+	{
+		float diffuseColor[3];
+		float specularColor[3];
+		float shininess;
+		uint32_t tagOffset;
+	};
+
+	// scene graph node with its transformation relative to the parent
+	struct NODE_RECORD
+	{
+		int32_t parent;
+		float scale[3];
+		float rotationDegrees[3];
+		float position[3];
+	};
+
+	// mesh drawn at a node with a texture and material index
+	struct OBJECT_RECORD
+	{
+		uint32_t node;
+		uint32_t mesh;
+		int32_t texture;
+		int32_t material;
+	};
+
+	// map and check the passed in binary scene file
+	bool Open(const char* filename);
+	// unmap the file
+	void Close();
+
+	// the records of the file
+	uint32_t GetTextureCount() const;
+	const TEXTURE_RECORD* GetTextures() const;
+	uint32_t GetMaterialCount() const;
+	const MATERIAL_RECORD* GetMaterials() const;
+	uint32_t GetNodeCount() const;
+	const NODE_RECORD* GetNodes() const;
+	uint32_t GetObjectCount() const;
+	const OBJECT_RECORD* GetObjects() const;
+	// a string of the string table
+	const char* GetString(uint32_t offset) const;
+
+	// convert a text scene description into a binary scene file
+	static bool ConvertTextScene(const char* textFilename, const char* binaryFilename);
+
+private:
+	// first bytes of every binary scene file
+	struct FILE_HEADER
+	{
+		char magic[4];
+		uint32_t version;
+		uint32_t fileSize;
+		uint32_t textureCount;
+		uint32_t textureOffset;
+		uint32_t materialCount;
+		uint32_t materialOffset;
+		uint32_t nodeCount;
+		uint32_t nodeOffset;
+		uint32_t objectCount;
+		uint32_t objectOffset;
+		uint32_t stringsSize;
+		uint32_t stringsOffset;
+	};
+
+	// the mapped file
+	MappedFile m_file;
+	// header at the start of the mapped file
+	const FILE_HEADER* m_pHeader;
+
+	// check that the header and every record fit the file
+	bool Validate() const;
+	// pointer to a section of the mapped file
+	const void* GetSection(uint32_t offset) const;
+};
@@ -0,0 +1,288 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenegraph.cpp
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SceneGraph.h"
+
+#include <algorithm>
+#include <iostream>
+
+/***********************************************************
+ *  SceneGraph()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+SceneGraph::SceneGraph()
+{
+	m_firstDirty = 0;
+}
+
+/***********************************************************
+ *  ~SceneGraph()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+SceneGraph::~SceneGraph()
+{
+	Clear();
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for removing all of the nodes.
+ ***********************************************************/
+void SceneGraph::Clear()
+{
+	m_parents.clear();
+	m_localTransforms.clear();
+	m_worldMatrices.clear();
+	m_dirty.clear();
+	m_firstDirty = 0;
+	m_updatedNodes.clear();
+}
+
+/***********************************************************
+ *  Reserve()
+ *
+ *  This method is used for reserving the memory of the node
+ *  arrays up front, so that a large scene is not built through
+ *  repeated reallocation.
+ ***********************************************************/
+void SceneGraph::Reserve(int nodeCount)
+{
+	if (nodeCount <= 0)
+	{
+		return;
+	}
+
+	m_parents.reserve(nodeCount);
+	m_localTransforms.reserve(nodeCount);
+	m_worldMatrices.reserve(nodeCount);
+	m_dirty.reserve(nodeCount);
+}
+
+/***********************************************************
+ *  AddNode()
+ *
+ *  This method is used for adding a node to the graph.  A
+ *  node may only be added below the most recently added node
+ *  or one of its ancestors, so that every subtree occupies a
+ *  contiguous range of the array directly after its root.
+ ***********************************************************/
+int SceneGraph::AddNode(int parentIndex, const Transform& localTransform)
+{
+	if (NO_PARENT != parentIndex)
+	{
+		// walk up from the last node to find the parent on the
+		// current depth-first path
+		int ancestor = (int)m_parents.size() - 1;
+		while ((ancestor >= 0) && (ancestor != parentIndex))
+		{
+			ancestor = m_parents[ancestor];
+		}
+
+		if (ancestor != parentIndex)
+		{
+			std::cout << "ERROR: scene graph node " << parentIndex
+				<< " is not on the current depth-first path" << std::endl;
+			return(-1);
+		}
+	}
+
+	int nodeIndex = (int)m_parents.size();
+	m_parents.push_back(parentIndex);
+	m_localTransforms.push_back(localTransform);
+	m_worldMatrices.push_back(glm::mat4(1.0f));
+	m_dirty.push_back(0);
+	MarkDirty(nodeIndex);
+
+	return(nodeIndex);
+}
+
+/***********************************************************
+ *  SetLocalTransform()
+ *
+ *  These methods are used for changing the local
+ *  transformation of a node.  The node is flagged so that
+ *  its subtree is updated by the next UpdateWorldTransforms().
+ ***********************************************************/
+void SceneGraph::SetLocalTransform(int nodeIndex, const Transform& localTransform)
+{
+	if (false == IsValidNode(nodeIndex))
+	{
+		return;
+	}
+
+	m_localTransforms[nodeIndex] = localTransform;
+	MarkDirty(nodeIndex);
+}
+
+void SceneGraph::SetLocalScale(int nodeIndex, glm::vec3 scaleXYZ)
+{
+	if (false == IsValidNode(nodeIndex))
+	{
+		return;
+	}
+
+	m_localTransforms[nodeIndex].SetScale(scaleXYZ);
+	MarkDirty(nodeIndex);
+}
+
+void SceneGraph::SetLocalRotation(
+	int nodeIndex,
+	float XrotationDegrees,
+	float YrotationDegrees,
+	float ZrotationDegrees)
+{
+	if (false == IsValidNode(nodeIndex))
+	{
+		return;
+	}
+
+	m_localTransforms[nodeIndex].SetRotation(XrotationDegrees, YrotationDegrees, ZrotationDegrees);
+	MarkDirty(nodeIndex);
+}
+
+void SceneGraph::SetLocalPosition(int nodeIndex, glm::vec3 positionXYZ)
+{
+	if (false == IsValidNode(nodeIndex))
+	{
+		return;
+	}
+
+	m_localTransforms[nodeIndex].SetPosition(positionXYZ);
+	MarkDirty(nodeIndex);
+}
+
+/***********************************************************
+ *  GetLocalTransform()
+ *
+ *  This method is used for getting the local transformation
+ *  of a node.
+ ***********************************************************/
+const Transform& SceneGraph::GetLocalTransform(int nodeIndex) const
+{
+	return(m_localTransforms[nodeIndex]);
+}
+
+/***********************************************************
+ *  GetParent()
+ *
+ *  This method is used for getting the parent of a node.
+ ***********************************************************/
+int SceneGraph::GetParent(int nodeIndex) const
+{
+	return(m_parents[nodeIndex]);
+}
+
+/***********************************************************
+ *  GetWorldMatrix()
+ *
+ *  This method is used for getting the world matrix of a
+ *  node as of the last UpdateWorldTransforms().
+ ***********************************************************/
+const glm::mat4& SceneGraph::GetWorldMatrix(int nodeIndex) const
+{
+	return(m_worldMatrices[nodeIndex]);
+}
+
+/***********************************************************
+ *  UpdateWorldTransforms()
+ *
+ *  This method is used for bringing the world matrices up to
+ *  date.  Since parents come before their children, one pass
+ *  from the first changed node to the end of the array is
+ *  enough: a node is rebuilt when it changed itself or when
+ *  its parent was rebuilt earlier in the same pass.  Nodes
+ *  outside of the changed subtrees only cost a flag check.
+ ***********************************************************/
+int SceneGraph::UpdateWorldTransforms()
+{
+	int nodeCount = (int)m_parents.size();
+	int updateCount = 0;
+
+	m_updatedNodes.clear();
+	if (m_firstDirty >= nodeCount)
+	{
+		return(0);
+	}
+
+	for (int i = m_firstDirty; i < nodeCount; i++)
+	{
+		int parent = m_parents[i];
+		bool bParentUpdated = (parent >= m_firstDirty) && (0 != m_dirty[parent]);
+
+		if ((0 != m_dirty[i]) || (true == bParentUpdated))
+		{
+			const glm::mat4& localMatrix = m_localTransforms[i].GetMatrix();
+			if (NO_PARENT == parent)
+			{
+				m_worldMatrices[i] = localMatrix;
+			}
+			else
+			{
+				m_worldMatrices[i] = m_worldMatrices[parent] * localMatrix;
+			}
+
+			// flag the node as rebuilt for its children
+			m_dirty[i] = 1;
+			m_updatedNodes.push_back(i);
+			updateCount++;
+		}
+	}
+
+	// the pass is complete, so clear the flags it used
+	std::fill(m_dirty.begin() + m_firstDirty, m_dirty.end(), (unsigned char)0);
+	m_firstDirty = nodeCount;
+
+	return(updateCount);
+}
+
+/***********************************************************
+ *  GetUpdatedNodes()
+ *
+ *  This method is used for getting the nodes whose world
+ *  matrices were rebuilt by the last UpdateWorldTransforms(),
+ *  so that copies of those matrices can be refreshed.
+ ***********************************************************/
+const std::vector<int>& SceneGraph::GetUpdatedNodes() const
+{
+	return(m_updatedNodes);
+}
+
+/***********************************************************
+ *  GetNodeCount()
+ *
+ *  This method is used for getting the number of nodes.
+ ***********************************************************/
+int SceneGraph::GetNodeCount() const
+{
+	return((int)m_parents.size());
+}
+
+/***********************************************************
+ *  MarkDirty()
+ *
+ *  This method is used for flagging a node as changed and
+ *  moving the start of the next update back to it.
+ ***********************************************************/
+void SceneGraph::MarkDirty(int nodeIndex)
+{
+	m_dirty[nodeIndex] = 1;
+	if (nodeIndex < m_firstDirty)
+	{
+		m_firstDirty = nodeIndex;
+	}
+}
+
+/***********************************************************
+ *  IsValidNode()
+ *
+ *  This method is used for checking that an index refers to
+ *  a node of the graph.
+ ***********************************************************/
+bool SceneGraph::IsValidNode(int nodeIndex) const
+{
+	return((nodeIndex >= 0) && (nodeIndex < (int)m_parents.size()));
+}
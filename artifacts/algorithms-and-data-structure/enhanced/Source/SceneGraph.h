@@ -0,0 +1,84 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenegraph.h
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "Transform.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  SceneGraph
+ *
+ *  This class contains a hierarchy of transforms, where the
+ *  world matrix of every node is the world matrix of its
+ *  parent times its own local matrix.  The nodes are kept in
+ *  one flat array in depth-first order, so a parent always
+ *  comes before its children and the world matrices can be
+ *  brought up to date with a single pass over the array that
+ *  only touches the subtrees below a changed node.
+ ***********************************************************/
+class SceneGraph
+{
+public:
+	// constructor
+	SceneGraph();
+	// destructor
+	~SceneGraph();
+
+	// parent index of a node without a parent
+	static const int NO_PARENT = -1;
+
+	// remove all of the nodes
+	void Clear();
+	// reserve memory for the passed in number of nodes
+	void Reserve(int nodeCount);
+
+	// add a node below the passed in parent and get its index -
+	// the parent must be the last added node or one of its
+	// ancestors, which keeps the array in depth-first order
+	int AddNode(int parentIndex, const Transform& localTransform);
+
+	// change the local transformation of a node
+	void SetLocalTransform(int nodeIndex, const Transform& localTransform);
+	void SetLocalScale(int nodeIndex, glm::vec3 scaleXYZ);
+	void SetLocalRotation(int nodeIndex, float XrotationDegrees, float YrotationDegrees, float ZrotationDegrees);
+	void SetLocalPosition(int nodeIndex, glm::vec3 positionXYZ);
+
+	// the local transformation of a node
+	const Transform& GetLocalTransform(int nodeIndex) const;
+	// the parent of a node, or NO_PARENT
+	int GetParent(int nodeIndex) const;
+	// the world matrix of a node as of the last update
+	const glm::mat4& GetWorldMatrix(int nodeIndex) const;
+
+	// bring the world matrices of all changed subtrees up to
+	// date and get the number of matrices that were rebuilt
+	int UpdateWorldTransforms();
+	// the nodes rebuilt by the last update, in ascending order
+	const std::vector<int>& GetUpdatedNodes() const;
+
+	// number of nodes in the graph
+	int GetNodeCount() const;
+
+private:
+	// node values stored as parallel arrays in depth-first order
+	std::vector<int> m_parents;
+	std::vector<Transform> m_localTransforms;
+	std::vector<glm::mat4> m_worldMatrices;
+	// the node changed since the last update, or - during the
+	// update - its world matrix was rebuilt
+	std::vector<unsigned char> m_dirty;
+	// lowest index of a changed node, the update starts there
+	int m_firstDirty;
+	// nodes rebuilt by the last update
+	std::vector<int> m_updatedNodes;
+
+	// flag a node as changed
+	void MarkDirty(int nodeIndex);
+	// the index refers to a node of the graph
+	bool IsValidNode(int nodeIndex) const;
+};
@@ -3,42 +3,119 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "SceneManager.h"
+#include "MeshOptimizer.h"
 
 #ifndef STB_IMAGE_IMPLEMENTATION
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 #endif
 
-#include <glm/gtx/transform.hpp>
 
-// declaration of global variables
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <future>
+#include <iostream>
+#include <thread>
+
+// declaration of global variables and functions
 namespace
 {
-	const char* g_ModelName = "model";
-	const char* g_ColorValueName = "objectColor";
-	const char* g_TextureValueName = "objectTexture";
-	const char* g_UseTextureName = "bUseTexture";
-	const char* g_UseLightingName = "bUseLighting";
-}
+	// texture units kept for buffer and array samplers, counted
+	// down from the last unit, since samplers of different types
+	// cannot share a texture unit
+	const int TEXTURE_ARRAY_UNIT = 1;
+	const int MATERIAL_TABLE_UNIT = 2;
+	const int DRAW_TABLE_UNIT = 3;
+	const int LIGHT_TABLE_UNIT = 4;
+	const int LIGHT_GRID_UNIT = 5;
+	const int LIGHT_INDEX_UNIT = 6;
+	const int GBUFFER_FIRST_UNIT = 7;
+	const int RESERVED_TEXTURE_UNITS = GBUFFER_FIRST_UNIT + GBuffer::TARGET_COUNT - 1;
+
+	// generated point lights are spread over the table top, and
+	// each one only reaches the objects around it
+	const glm::vec3 GENERATED_LIGHTS_MINIMUM = glm::vec3(-9.0f, -0.5f, -9.0f);
+	const glm::vec3 GENERATED_LIGHTS_SIZE = glm::vec3(18.0f, 4.0f, 18.0f);
+	const float GENERATED_LIGHT_RADIUS = 3.0f;
+
+	// quantization boxes the vertex shader holds for packed
+	// vertices, which must match MAX_QUANTIZED_MESHES there
+	const int MAX_QUANTIZED_MESHES = 8;
+	static_assert((int)SceneMeshes::ShapeMesh::Count <= MAX_QUANTIZED_MESHES,
+		"every shape needs a quantization box in the vertex shader");
+
+	/***********************************************************
+	 *  GetDrawFeatures()
+	 *
+	 *  Get the shader features that differ between the draws of
+	 *  a frame, which select the program of a queued draw.
+	 ***********************************************************/
+	int GetDrawFeatures(int instanceCount, int textureHandle)
+	{
+		int features = 0;
+		if (instanceCount > 1)
+		{
+			features |= ShaderVariants::FEATURE_INSTANCING;
+		}
+		if (textureHandle >= 0)
+		{
+			features |= ShaderVariants::FEATURE_TEXTURE;
+		}
 
+		return (features);
+	}
+}
 
 /***********************************************************
  *  SceneManager()
  *
  *  The constructor for the class
  ***********************************************************/
-SceneManager::SceneManager(ShaderManager* pShaderManager)
+SceneManager::SceneManager(
+	ShaderVariants* pShaderVariants,
+	FrameUniforms* pFrameUniforms)
 {
-	m_pShaderManager = pShaderManager;
-	m_basicMeshes = new ShapeMeshes();
-
-	// initialize the texture collection
-	for (int i = 0; i < 16; i++)
+	m_pShaderVariants = pShaderVariants;
+	m_pShaderUniforms = NULL;
+	m_currentVariant = -1;
+	m_passFeatures = 0;
+	m_bUseLighting = false;
+	m_pFrameUniforms = pFrameUniforms;
+	m_basicMeshes = new SceneMeshes();
+
+	m_sceneFilename = "scenes/tabletop.scene";
+	m_sceneMaterialBase = 0;
+	m_textureDecodeThreads = 0;
+	m_bUseTextureArray = true;
+	m_renderStats.drawCalls = 0;
+	m_renderStats.programChanges = 0;
+	m_renderStats.fallbackPrograms = 0;
+	m_renderStats.textureChanges = 0;
+	m_renderStats.materialChanges = 0;
+	m_renderStats.meshChanges = 0;
+	m_renderStats.visibleObjects = 0;
+	m_renderStats.culledObjects = 0;
+	m_renderStats.transformUpdates = 0;
+	m_renderStats.indirectCommands = 0;
+	m_renderStats.triangles = 0;
+	m_renderStats.pointLights = 0;
+	m_renderStats.lightIndices = 0;
+	for (int pass = 0; pass < RENDER_PASS_COUNT; pass++)
 	{
-		m_textureIDs[i].tag = "/0";
-		m_textureIDs[i].ID = -1;
+		m_renderStats.passTimes[pass] = 0.0;
 	}
-	m_loadedTextures = 0;
+	m_pointLightCount = 0;
+	m_bLightClusters = true;
+	m_bDeferredShading = false;
+	m_bOtherPathRequested = false;
+	m_bFrustumCulling = true;
+	m_bLevelOfDetail = true;
+	m_bPackedVertices = false;
+	m_bOptimizeIndices = true;
+	m_bMultiDrawIndirect = true;
+	m_stressObjectCount = 0;
 }
 /***********************************************************
  *  ~SceneManager()
@@ -48,142 +125,333 @@ SceneManager::SceneManager(ShaderManager* pShaderManager)
 SceneManager::~SceneManager()
 {
 	// clear the allocated memory
-	m_pShaderManager = NULL;
+	m_pShaderVariants = NULL;
+	m_pShaderUniforms = NULL;
+	m_pFrameUniforms = NULL;
 	delete m_basicMeshes;
 	m_basicMeshes = NULL;
 	// destroy the created OpenGL textures
 	DestroyGLTextures();
+	m_materialTable.Destroy();
+	m_indirectDraws.Destroy();
+	m_pointLights.Destroy();
+	m_gBuffer.Destroy();
+	m_passTimer.Destroy();
 }
 
 
 /***********************************************************
- *  CreateGLTexture()
+ *  DecodeTextureImage()
  *
- *  This method is used for loading textures from image files,
- *  configuring the texture mapping parameters in OpenGL,
- *  generating the mipmaps, and loading the read texture into
- *  the next available texture slot in memory.
+ *  This method is used for parsing the image data from the
+ *  image file into memory.  It makes no OpenGL calls, so it
+ *  is safe to call from a worker thread.
  ***********************************************************/
-bool SceneManager::CreateGLTexture(const char* filename, std::string tag)
+bool SceneManager::DecodeTextureImage(TEXTURE_IMAGE& image)
 {
-	int width = 0;
-	int height = 0;
-	int colorChannels = 0;
-	GLuint textureID = 0;
-
-	// indicate to always flip images vertically when loaded
-	stbi_set_flip_vertically_on_load(true);
+	image.width = 0;
+	image.height = 0;
+	image.colorChannels = 0;
 
 	// try to parse the image data from the specified image file
-	unsigned char* image = stbi_load(
-		filename,
-		&width,
-		&height,
-		&colorChannels,
+	image.pixels = stbi_load(
+		image.filename.c_str(),
+		&image.width,
+		&image.height,
+		&image.colorChannels,
 		0);
 
-	// if the image was successfully read from the image file
-	if (image)
+	return (image.pixels != NULL);
+}
+
+/***********************************************************
+ *  UploadGLTexture()
+ *
+ *  This method is used for configuring the texture mapping
+ *  parameters in OpenGL, generating the mipmaps, and loading
+ *  the decoded image into the next available texture slot in
+ *  memory.  The decoded image data is freed afterwards.
+ ***********************************************************/
+bool SceneManager::UploadGLTexture(TEXTURE_IMAGE& image)
+{
+	GLuint textureID = 0;
+
+	// if the image was not read from the image file
+	if (image.pixels == NULL)
+	{
+		std::cout << "Could not load image:" << image.filename << std::endl;
+		return false;
+	}
+
+	// only RGB and RGBA images are supported - RGBA supports transparency
+	if ((image.colorChannels != 3) && (image.colorChannels != 4))
 	{
-		std::cout << "Successfully loaded image:" << filename << ", width:" << width << ", height:" << height << ", channels:" << colorChannels << std::endl;
+		std::cout << "Not implemented to handle image with " << image.colorChannels << " channels" << std::endl;
+		stbi_image_free(image.pixels);
+		image.pixels = NULL;
+		return false;
+	}
 
-		glGenTextures(1, &textureID);
-		glBindTexture(GL_TEXTURE_2D, textureID);
+	std::cout << "Successfully loaded image:" << image.filename << ", width:" << image.width << ", height:" << image.height << ", channels:" << image.colorChannels << std::endl;
 
-		// set the texture wrapping parameters
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		// set texture filtering parameters
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glGenTextures(1, &textureID);
+	glBindTexture(GL_TEXTURE_2D, textureID);
 
-		// if the loaded image is in RGB format
-		if (colorChannels == 3)
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
-		// if the loaded image is in RGBA format - it supports transparency
-		else if (colorChannels == 4)
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
-		else
+	// set the texture wrapping parameters
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	// set texture filtering parameters
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	// if the loaded image is in RGB format
+	if (image.colorChannels == 3)
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, image.width, image.height, 0, GL_RGB, GL_UNSIGNED_BYTE, image.pixels);
+	// if the loaded image is in RGBA format - it supports transparency
+	else
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, image.width, image.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image.pixels);
+
+	// generate the texture mipmaps for mapping textures to lower resolutions
+	glGenerateMipmap(GL_TEXTURE_2D);
+
+	// free the image data from local memory
+	stbi_image_free(image.pixels);
+	image.pixels = NULL;
+	glBindTexture(GL_TEXTURE_2D, 0); // Unbind the texture
+
+	// register the loaded texture and associate it with the special tag string
+	m_textures.Register(image.tag, textureID, image.width, image.height);
+
+	return true;
+}
+
+/***********************************************************
+ *  CreateGLTextures()
+ *
+ *  This method is used for loading a list of textures.  The
+ *  image files are decoded by a pool of worker threads, while
+ *  this thread - which owns the OpenGL context - uploads each
+ *  image as soon as it is ready.  The uploads happen in list
+ *  order, so the texture slots do not depend on the timing.
+ ***********************************************************/
+void SceneManager::CreateGLTextures(std::vector<TEXTURE_IMAGE>& images)
+{
+	if (images.empty() == true)
+	{
+		return;
+	}
+
+	// indicate to always flip images vertically when loaded - this
+	// is set before the workers start since it is shared by them
+	stbi_set_flip_vertically_on_load(true);
+
+	// decide how many decoding threads to use
+	int threadCount = m_textureDecodeThreads;
+	if (threadCount <= 0)
+	{
+		threadCount = (int)std::thread::hardware_concurrency();
+	}
+	threadCount = std::max(1, std::min(threadCount, (int)images.size()));
+
+	// a single thread decodes and uploads in place, like before
+	if (threadCount == 1)
+	{
+		for (size_t i = 0; i < images.size(); i++)
 		{
-			std::cout << "Not implemented to handle image with " << colorChannels << " channels" << std::endl;
-			return false;
+			DecodeTextureImage(images[i]);
+			UploadGLTexture(images[i]);
 		}
+		return;
+	}
 
-		// generate the texture mipmaps for mapping textures to lower resolutions
-		glGenerateMipmap(GL_TEXTURE_2D);
+	// one completion signal per image
+	std::vector<std::promise<void> > decoded(images.size());
+	std::vector<std::future<void> > ready;
+	for (size_t i = 0; i < decoded.size(); i++)
+	{
+		ready.push_back(decoded[i].get_future());
+	}
 
-		// free the image data from local memory
-		stbi_image_free(image);
-		glBindTexture(GL_TEXTURE_2D, 0); // Unbind the texture
+	// the workers take the next image from a shared counter
+	std::atomic<size_t> nextImage(0);
+	std::vector<std::thread> workers;
+	for (int i = 0; i < threadCount; i++)
+	{
+		workers.push_back(std::thread([&images, &decoded, &nextImage]()
+		{
+			size_t index = nextImage++;
+			while (index < images.size())
+			{
+				DecodeTextureImage(images[index]);
+				decoded[index].set_value();
+				index = nextImage++;
+			}
+		}));
+	}
 
-		// register the loaded texture and associate it with the special tag string
-		m_textureIDs[m_loadedTextures].ID = textureID;
-		m_textureIDs[m_loadedTextures].tag = tag;
-		m_loadedTextures++;
+	// upload in order while the remaining images are still decoding
+	for (size_t i = 0; i < images.size(); i++)
+	{
+		ready[i].wait();
+		UploadGLTexture(images[i]);
+	}
 
-		return true;
+	for (size_t i = 0; i < workers.size(); i++)
+	{
+		workers[i].join();
 	}
+}
+
+/***********************************************************
+ *  SetStressObjectCount()
+ *
+ *  This method is used for setting the number of small extra
+ *  objects that PrepareScene() adds to the scene.
+ ***********************************************************/
+void SceneManager::SetStressObjectCount(int objectCount)
+{
+	m_stressObjectCount = std::max(objectCount, 0);
+}
 
-	std::cout << "Could not load image:" << filename << std::endl;
+/***********************************************************
+ *  SetSceneFile()
+ *
+ *  This method is used for choosing the binary scene file
+ *  that PrepareScene() builds the scene from.
+ ***********************************************************/
+void SceneManager::SetSceneFile(const char* filename)
+{
+	m_sceneFilename = filename;
+}
 
-	// Error loading the image
-	return false;
+/***********************************************************
+ *  SetTextureDecodeThreads()
+ *
+ *  This method is used for setting the number of threads
+ *  that decode the texture images.  Zero uses one thread per
+ *  processor core and one decodes everything on this thread.
+ ***********************************************************/
+void SceneManager::SetTextureDecodeThreads(int threadCount)
+{
+	m_textureDecodeThreads = threadCount;
 }
 
 /***********************************************************
  *  BindGLTextures()
  *
  *  This method is used for binding the loaded textures to
- *  OpenGL texture memory slots.  There are up to 16 slots.
+ *  OpenGL texture memory slots.  In texture array mode the
+ *  whole scene uses one array on the last texture unit and
+ *  objects select a layer, so the number of textures is not
+ *  limited by the texture units.  Otherwise the slot of each
+ *  texture is its registry handle.  The units below the array
+ *  unit are kept for the buffer textures of the material,
+ *  draw and light tables, and for the G-buffer targets.
  ***********************************************************/
 void SceneManager::BindGLTextures()
 {
-	for (int i = 0; i < m_loadedTextures; i++)
+	GLint maxTextureUnits = 0;
+	glGetIntegerv(GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS, &maxTextureUnits);
+
+	int arrayUnit = maxTextureUnits - TEXTURE_ARRAY_UNIT;
+	int firstReservedUnit = maxTextureUnits - RESERVED_TEXTURE_UNITS;
+
+	if ((m_bUseTextureArray == true) && (m_textures.GetTextureArrayID() == 0))
 	{
-		// bind textures on corresponding texture units
-		glActiveTexture(GL_TEXTURE0 + i);
-		glBindTexture(GL_TEXTURE_2D, m_textureIDs[i].ID);
+		m_bUseTextureArray = m_textures.BuildTextureArray();
+	}
+
+	if (m_bUseTextureArray == true)
+	{
+		glActiveTexture(GL_TEXTURE0 + arrayUnit);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, m_textures.GetTextureArrayID());
+		glActiveTexture(GL_TEXTURE0);
+	}
+	else
+	{
+		int textureCount = m_textures.GetCount();
+		if (textureCount > firstReservedUnit)
+		{
+			std::cout << "WARNING: Only " << firstReservedUnit << " of " << textureCount
+				<< " textures can be bound to texture units" << std::endl;
+			textureCount = firstReservedUnit;
+		}
+
+		for (int i = 0; i < textureCount; i++)
+		{
+			// bind textures on corresponding texture units
+			glActiveTexture(GL_TEXTURE0 + i);
+			glBindTexture(GL_TEXTURE_2D, m_textures.GetTextureID(i));
+		}
 	}
 }
 
 /***********************************************************
- *  DestroyGLTextures()
+ *  SetTextureArrayMode()
  *
- *  This method is used for freeing the memory in all the
- *  used texture memory slots.
+ *  This method is used for choosing whether the scene
+ *  textures are used from one texture array, which is the
+ *  default, or bound to separate texture units.  It needs to
+ *  be called before the scene is prepared.
  ***********************************************************/
-void SceneManager::DestroyGLTextures()
+void SceneManager::SetTextureArrayMode(bool bUseTextureArray)
 {
-	for (int i = 0; i < m_loadedTextures; i++)
-	{
-		glDeleteTextures(1, &m_textureIDs[i].ID);
-	}
+	m_bUseTextureArray = bUseTextureArray;
 }
 
 /***********************************************************
- *  FindTextureID()
+ *  BindMaterialTable()
  *
- *  This method is used for getting an ID for the previously
- *  loaded texture bitmap associated with the passed in tag.
+ *  This method is used for uploading the defined materials to
+ *  the GPU once and binding the material table to the texture
+ *  unit below the texture array.  Draws then only select the
+ *  index of their material.
  ***********************************************************/
-int SceneManager::FindTextureID(std::string tag)
+void SceneManager::BindMaterialTable()
 {
-	int textureID = -1;
-	int index = 0;
-	bool bFound = false;
+	GLint maxTextureUnits = 0;
+	glGetIntegerv(GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS, &maxTextureUnits);
+	int materialUnit = maxTextureUnits - MATERIAL_TABLE_UNIT;
+
+	m_materialTable.Upload();
+	m_materialTable.Bind(materialUnit);
+}
 
-	while ((index < m_loadedTextures) && (bFound == false))
+/***********************************************************
+ *  BindDrawTable()
+ *
+ *  This method is used for giving the draw table of the
+ *  indirect submission its own texture unit, and for falling
+ *  back to separate draws when the indirect submission cannot
+ *  be used.  It needs the texture array, since one draw call
+ *  cannot switch between texture units.
+ ***********************************************************/
+void SceneManager::BindDrawTable()
+{
+	if (m_bMultiDrawIndirect == true)
 	{
-		if (m_textureIDs[index].tag.compare(tag) == 0)
+		if (IndirectDrawBuffer::IsSupported() == false)
 		{
-			textureID = m_textureIDs[index].ID;
-			bFound = true;
+			std::cout << "INFO: Indirect multi-draw is not supported, drawing separately" << std::endl;
+			m_bMultiDrawIndirect = false;
+		}
+		else if (m_bUseTextureArray == false)
+		{
+			std::cout << "INFO: Indirect multi-draw needs the texture array, drawing separately" << std::endl;
+			m_bMultiDrawIndirect = false;
 		}
-		else
-			index++;
 	}
+}
 
-	return(textureID);
+/***********************************************************
+ *  DestroyGLTextures()
+ *
+ *  This method is used for freeing the memory in all the
+ *  used texture memory slots.
+ ***********************************************************/
+void SceneManager::DestroyGLTextures()
+{
+	m_textures.Destroy();
 }
 
 /***********************************************************
@@ -194,175 +462,475 @@ int SceneManager::FindTextureID(std::string tag)
  ***********************************************************/
 int SceneManager::FindTextureSlot(std::string tag)
 {
-	int textureSlot = -1;
-	int index = 0;
-	bool bFound = false;
-
-	while ((index < m_loadedTextures) && (bFound == false))
+	return(m_textures.Find(tag));
+}
+/***********************************************************
+ *  FindMaterialIndex()
+ *
+ *  This method is used for getting the index of the defined
+ *  material that is associated with the passed in tag, or -1
+ *  if there is no such material.
+ ***********************************************************/
+int SceneManager::FindMaterialIndex(std::string tag)
+{
+	for (size_t i = 0; i < m_objectMaterials.size(); i++)
 	{
-		if (m_textureIDs[index].tag.compare(tag) == 0)
+		if (m_objectMaterials[i].tag.compare(tag) == 0)
 		{
-			textureSlot = index;
-			bFound = true;
+			return((int)i);
 		}
-		else
-			index++;
 	}
 
-	return(textureSlot);
+	return(-1);
 }
 /***********************************************************
- *  FindMaterial()
+ *  SetShaderMaterial()
  *
- *  This method is used for getting a material from the previously
- *  defined materials list that is associated with the passed in tag.
+ *  This method is used for selecting a material by its index.
+ *  The material values are already in the material table, so
+ *  only the index is passed into the shader.
  ***********************************************************/
-bool SceneManager::FindMaterial(std::string tag, OBJECT_MATERIAL& material)
+void SceneManager::SetShaderMaterial(
+	int materialIndex)
 {
-	if (m_objectMaterials.size() == 0)
+	if ((materialIndex < 0) || (materialIndex >= m_materialTable.GetCount()) ||
+		(NULL == m_pShaderUniforms))
 	{
-		return(false);
+		return;
 	}
 
-	int index = 0;
-	bool bFound = false;
-	while ((index < m_objectMaterials.size()) && (bFound == false))
+	m_pShaderUniforms->objectMaterialIndex.Set(materialIndex);
+}
+/***********************************************************
+ *  SetShaderTexture()
+ *
+ *  This method is used for setting the texture data
+ *  associated with the passed in handle into the shader.  A
+ *  negative handle draws with the object color, which the
+ *  program of the draw already does without a texture.
+ ***********************************************************/
+void SceneManager::SetShaderTexture(
+	int textureHandle)
+{
+	if ((NULL != m_pShaderUniforms) && (textureHandle >= 0))
 	{
-		if (m_objectMaterials[index].tag.compare(tag) == 0)
+
+		// the array sampler never changes, only the layer does
+		if (m_bUseTextureArray == true)
 		{
-			bFound = true;
-			material.diffuseColor = m_objectMaterials[index].diffuseColor;
-			material.specularColor = m_objectMaterials[index].specularColor;
-			material.shininess = m_objectMaterials[index].shininess;
+			m_pShaderUniforms->objectTextureLayer.Set(textureHandle);
 		}
 		else
 		{
-			index++;
+			m_pShaderUniforms->objectTexture.Set(textureHandle);
 		}
 	}
-
-	return(true);
 }
+
 /***********************************************************
- *  SetTransformations()
+ *  SubmitRenderQueue()
  *
- *  This method is used for setting the transform buffer
- *  using the passed in transformation values.
+ *  This method is used for culling, sorting and submitting
+ *  the queued draws.  The program, texture, material and mesh
+ *  are only set when they differ from the previous draw, and
+ *  the changes are counted in the frame statistics.  The
+ *  features of the draws are in the highest bits of the sort
+ *  key, so the draws of each program are submitted together.
  ***********************************************************/
-void SceneManager::SetTransformations(
-	glm::vec3 scaleXYZ,
-	float XrotationDegrees,
-	float YrotationDegrees,
-	float ZrotationDegrees,
-	glm::vec3 positionXYZ)
+void SceneManager::SubmitRenderQueue()
 {
-	// variables for this method
-	glm::mat4 modelView;
-	glm::mat4 scale;
-	glm::mat4 rotationX;
-	glm::mat4 rotationY;
-	glm::mat4 rotationZ;
-	glm::mat4 translation;
+	int queuedObjects = m_renderQueue.GetInstanceCount();
+	if ((m_bFrustumCulling == true) && (NULL != m_pFrameUniforms))
+	{
+		m_frustumCuller.SetViewProjection(m_pFrameUniforms->GetViewProjection());
+		m_renderQueue.Cull(m_frustumCuller);
+	}
+	m_renderStats.visibleObjects = m_renderQueue.GetInstanceCount();
+	m_renderStats.culledObjects += queuedObjects - m_renderStats.visibleObjects;
+
+	m_renderQueue.Sort();
+
+	const std::vector<RenderQueue::DRAW_ITEM>& queuedItems = m_renderQueue.GetItems();
+	for (size_t i = 0; i < queuedItems.size(); i++)
+	{
+		const RenderQueue::DRAW_ITEM& item = queuedItems[i];
+		m_renderStats.triangles += item.instanceCount *
+			m_basicMeshes->GetTriangleCount((ShapeMesh)item.mesh, item.lod);
+	}
+
+	if (m_bMultiDrawIndirect == true)
+	{
+		SubmitMultiDrawIndirect();
+		m_renderQueue.Clear();
+		return;
+	}
+
+	const std::vector<RenderQueue::DRAW_ITEM>& items = m_renderQueue.GetItems();
 
-	// set the scale value in the transform buffer
-	scale = glm::scale(scaleXYZ);
-	// set the rotation values in the transform buffer
-	rotationX = glm::rotate(glm::radians(XrotationDegrees), glm::vec3(1.0f, 0.0f, 0.0f));
-	rotationY = glm::rotate(glm::radians(YrotationDegrees), glm::vec3(0.0f, 1.0f, 0.0f));
-	rotationZ = glm::rotate(glm::radians(ZrotationDegrees), glm::vec3(0.0f, 0.0f, 1.0f));
-	// set the translation value in the transform buffer
-	translation = glm::translate(positionXYZ);
+	// nothing is assumed to be set at the start of the frame
+	unsigned int sceneFeatures = GetSceneFeatures();
+	int currentProgram = -1;
+	int currentTexture = -2;
+	int currentMaterial = -2;
+	int currentMesh = -1;
+	int currentShape = -1;
+	bool bProgramReady = false;
+	bool bPackedVertices = m_basicMeshes->IsPackedVertices();
 
-	modelView = translation * rotationZ * rotationY * rotationX * scale;
+	// every mesh is a range of the same buffers
+	m_basicMeshes->BindMeshes();
 
-	if (NULL != m_pShaderManager)
+	for (size_t i = 0; i < items.size(); i++)
 	{
-		m_pShaderManager->setMat4Value(g_ModelName, modelView);
+		const RenderQueue::DRAW_ITEM& item = items[i];
+
+		// every program keeps its own uniform values, so the
+		// values of the draw are set again after a change
+		if (item.program != currentProgram)
+		{
+			bProgramReady = UseShaderVariant(sceneFeatures | (unsigned int)item.program);
+			currentProgram = item.program;
+			currentTexture = -2;
+			currentMaterial = -2;
+			currentShape = -1;
+		}
+		if (bProgramReady == false)
+		{
+			continue;
+		}
+		if (item.textureHandle != currentTexture)
+		{
+			SetShaderTexture(item.textureHandle);
+			currentTexture = item.textureHandle;
+			m_renderStats.textureChanges++;
+		}
+		if (item.materialIndex != currentMaterial)
+		{
+			SetShaderMaterial(item.materialIndex);
+			currentMaterial = item.materialIndex;
+			m_renderStats.materialChanges++;
+		}
+		// a detail level is a different range of the buffers too
+		int mesh = (item.mesh * SceneMeshes::MAX_LOD_COUNT) + item.lod;
+		if (mesh != currentMesh)
+		{
+			// the levels of a shape share its quantization box
+			if ((bPackedVertices == true) && (item.mesh != currentShape))
+			{
+				m_pShaderUniforms->objectMeshIndex.Set(item.mesh);
+				currentShape = item.mesh;
+			}
+			currentMesh = mesh;
+			m_renderStats.meshChanges++;
+		}
+
+		// the instanced programs read the model matrices from
+		// the per-instance attribute
+		const glm::mat4* modelMatrices = m_renderQueue.GetMatrices(item);
+		if ((item.program & ShaderVariants::FEATURE_INSTANCING) != 0)
+		{
+			m_basicMeshes->DrawBoundMeshInstanced((ShapeMesh)item.mesh, modelMatrices, item.instanceCount, item.lod);
+		}
+		else
+		{
+			if (NULL != m_pShaderUniforms)
+			{
+				m_pShaderUniforms->model.Set(modelMatrices[0]);
+			}
+			m_basicMeshes->DrawBoundMesh((ShapeMesh)item.mesh, item.lod);
+		}
+		m_renderStats.drawCalls++;
 	}
+
+	m_basicMeshes->UnbindMeshes();
+	m_renderQueue.Clear();
 }
 
 /***********************************************************
- *  SetShaderColor()
+ *  SubmitMultiDrawIndirect()
  *
- *  This method is used for setting the passed in color
- *  into the shader for the next draw command
+ *  This method is used for submitting the sorted draws with
+ *  indirect multi-draw calls.  Every queued draw becomes a
+ *  command that starts at its first model matrix, and the
+ *  vertex shader finds its material and texture layer in the
+ *  draw table with gl_DrawID, so no state changes between the
+ *  draws.  The textured and the untextured draws need their
+ *  own programs, and each is drawn with one call.
  ***********************************************************/
-void SceneManager::SetShaderColor(
-	float redColorValue,
-	float greenColorValue,
-	float blueColorValue,
-	float alphaValue)
+void SceneManager::SubmitMultiDrawIndirect()
 {
-	// variables for this method
-	glm::vec4 currentColor;
+	const std::vector<RenderQueue::DRAW_ITEM>& items = m_renderQueue.GetItems();
+	if (items.empty() == true)
+	{
+		return;
+	}
 
-	currentColor.r = redColorValue;
-	currentColor.g = greenColorValue;
-	currentColor.b = blueColorValue;
-	currentColor.a = alphaValue;
+	m_indirectDraws.Clear();
+	for (size_t i = 0; i < items.size(); i++)
+	{
+		const RenderQueue::DRAW_ITEM& item = items[i];
+
+		// the texture handle is the layer in the texture array
+		m_indirectDraws.Add(
+			m_basicMeshes->GetMeshRange((ShapeMesh)item.mesh, item.lod),
+			item.instanceCount,
+			item.firstMatrix,
+			item.materialIndex,
+			item.textureHandle);
+	}
+	m_indirectDraws.Upload();
+
+	GLint maxTextureUnits = 0;
+	glGetIntegerv(GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS, &maxTextureUnits);
+
+	const std::vector<glm::mat4>& matrices = m_renderQueue.GetAllMatrices();
+	m_basicMeshes->UploadInstanceMatrices(&matrices[0], (int)matrices.size());
 
-	if (NULL != m_pShaderManager)
+	m_basicMeshes->BindMeshes();
+	m_indirectDraws.Bind(maxTextureUnits - DRAW_TABLE_UNIT);
+
+	// every command is drawn as instances, so only the texture
+	// feature differs, and the sort keeps those draws together
+	unsigned int drawFeatures = GetSceneFeatures() |
+		ShaderVariants::FEATURE_DRAW_TABLE | ShaderVariants::FEATURE_INSTANCING;
+	size_t firstDraw = 0;
+	while (firstDraw < items.size())
 	{
-		m_pShaderManager->setVec4Value(g_ColorValueName, currentColor);
+		int textureFeature = items[firstDraw].program & ShaderVariants::FEATURE_TEXTURE;
+		size_t endDraw = firstDraw + 1;
+		while ((endDraw < items.size()) &&
+			((items[endDraw].program & ShaderVariants::FEATURE_TEXTURE) == textureFeature))
+		{
+			endDraw++;
+		}
+
+		// the draw IDs of a call count from its first command
+		if (UseShaderVariant(drawFeatures | (unsigned int)textureFeature) == true)
+		{
+			m_pShaderUniforms->drawTableBase.Set((int)firstDraw);
+			m_basicMeshes->DrawBoundMeshesIndirect(
+				(GLintptr)(firstDraw * sizeof(IndirectDrawBuffer::DRAW_COMMAND)),
+				(int)(endDraw - firstDraw));
+			m_renderStats.drawCalls++;
+		}
+		firstDraw = endDraw;
 	}
+
+	m_indirectDraws.Unbind();
+	m_basicMeshes->UnbindMeshes();
+
+	m_renderStats.indirectCommands = m_indirectDraws.GetCount();
 }
+
 /***********************************************************
- *  SetShaderMaterial()
+ *  AddSceneObject()
  *
- *  This method is used for passing the material values
- *  into the shader.
+ *  This method is used for adding an object to the 3D scene.
+ *  The object is drawn with the world matrix of the passed in
+ *  scene graph node, so it follows any parent of that node.
+ *  Objects that share a mesh, texture and material are drawn
+ *  together as one instanced draw call.  An object without a
+ *  material is drawn with the first material, whichever way
+ *  the scene is submitted.
  ***********************************************************/
-void SceneManager::SetShaderMaterial(
-	std::string materialTag)
+int SceneManager::AddSceneObject(
+	ShapeMesh shape,
+	int textureHandle,
+	int materialIndex,
+	int nodeIndex)
 {
-	if (m_objectMaterials.size() > 0)
-	{
-		OBJECT_MATERIAL material;
-		bool bReturn = false;
+	const SceneMeshes::MESH_BOUNDS& bounds = m_basicMeshes->GetMeshBounds(shape);
 
-		// find the defined material that matches the tag
-		bReturn = FindMaterial(materialTag, material);
-		if (bReturn == true)
-		{
-			// pass the material properties into the shader
-			m_pShaderManager->setVec3Value("material.diffuseColor", material.diffuseColor);
-			m_pShaderManager->setVec3Value("material.specularColor", material.specularColor);
-			m_pShaderManager->setFloatValue("material.shininess", material.shininess);
-		}
+	if (materialIndex < 0)
+	{
+		materialIndex = 0;
 	}
+
+	return(m_entities.Create(
+		nodeIndex,
+		(int)shape,
+		textureHandle,
+		materialIndex,
+		bounds.center,
+		bounds.radius));
 }
+
 /***********************************************************
- *  SetShaderTexture()
+ *  AddStressObjects()
  *
- *  This method is used for setting the texture data
- *  associated with the passed in ID into the shader.
+ *  This method is used for covering the floor with a square
+ *  grid of small spheres, so that the renderer can be measured
+ *  with a scene of many thousands of objects.
  ***********************************************************/
-void SceneManager::SetShaderTexture(
-	std::string textureTag)
+void SceneManager::AddStressObjects(int objectCount)
 {
-	if (NULL != m_pShaderManager)
+	if (objectCount <= 0)
 	{
-		m_pShaderManager->setIntValue(g_UseTextureName, true);
+		return;
+	}
 
-		int textureID = -1;
-		textureID = FindTextureSlot(textureTag);
-		m_pShaderManager->setSampler2DValue(g_TextureValueName, textureID);
+	int gridSize = (int)std::ceil(std::sqrt((float)objectCount));
+	float floorSize = 28.0f;
+	float spacing = floorSize / (float)gridSize;
+	glm::vec3 scaleObject = glm::vec3(spacing * 0.3f);
+
+	// the objects use the ceramic look of the tea set
+	int textureHandle = m_textures.Find("teaTexture");
+	int materialIndex = FindMaterialIndex("Material4");
+
+	int field = m_sceneGraph.AddNode(SceneGraph::NO_PARENT,
+		Transform(glm::vec3(1.0f), 0.0f, 0.0f, 0.0f, glm::vec3(-0.5f * floorSize, -11.4f, -0.5f * floorSize)));
+	for (int i = 0; i < objectCount; i++)
+	{
+		glm::vec3 position = glm::vec3(
+			((float)(i % gridSize) + 0.5f) * spacing,
+			0.0f,
+			((float)(i / gridSize) + 0.5f) * spacing);
+
+		AddSceneObject(ShapeMesh::Sphere, textureHandle, materialIndex,
+			m_sceneGraph.AddNode(field, Transform(scaleObject, 0.0f, 0.0f, 0.0f, position)));
 	}
 }
 
 /***********************************************************
- *  SetTextureUVScale()
+ *  SetDrawSorting()
+ *
+ *  This method is used for choosing whether the queued draws
+ *  are sorted by state or submitted in the order they were
+ *  queued, to compare the number of state changes.
+ ***********************************************************/
+void SceneManager::SetDrawSorting(bool bSortDraws)
+{
+	m_renderQueue.SetSorting(bSortDraws);
+}
+
+/***********************************************************
+ *  SetFrustumCulling()
+ *
+ *  This method is used for choosing whether the objects
+ *  outside of the view frustum are skipped before drawing.
+ ***********************************************************/
+void SceneManager::SetFrustumCulling(bool bFrustumCulling)
+{
+	m_bFrustumCulling = bFrustumCulling;
+}
+
+/***********************************************************
+ *  SetLevelOfDetail()
+ *
+ *  This method is used for choosing whether objects that cover
+ *  little of the screen are drawn with coarser meshes, which
+ *  is the default.
+ ***********************************************************/
+void SceneManager::SetLevelOfDetail(bool bLevelOfDetail)
+{
+	m_bLevelOfDetail = bLevelOfDetail;
+}
+
+/***********************************************************
+ *  SetPackedVertices()
  *
- *  This method is used for setting the texture UV scale
- *  values into the shader.
+ *  This method is used for choosing whether the meshes are
+ *  stored with packed vertices, at half the size of the float
+ *  layout.  It needs to be called before the scene is
+ *  prepared.
  ***********************************************************/
-void SceneManager::SetTextureUVScale(float u, float v)
+void SceneManager::SetPackedVertices(bool bPackedVertices)
 {
-	if (NULL != m_pShaderManager)
+	m_bPackedVertices = bPackedVertices;
+}
+
+/***********************************************************
+ *  SetIndexOptimization()
+ *
+ *  This method is used for choosing whether the triangles of
+ *  the meshes are reordered for the vertex cache and for
+ *  overdraw as they load, which is the default.  It needs to
+ *  be called before the scene is prepared.
+ ***********************************************************/
+void SceneManager::SetIndexOptimization(bool bOptimizeIndices)
+{
+	m_bOptimizeIndices = bOptimizeIndices;
+}
+
+/***********************************************************
+ *  SetPointLightCount()
+ *
+ *  This method is used for setting the total number of point
+ *  lights.  The scene lights always stay, and generated
+ *  lights fill up the rest.  Lights that were already set up
+ *  are rebuilt, so the count can change between frames.
+ ***********************************************************/
+void SceneManager::SetPointLightCount(int lightCount)
+{
+	m_pointLightCount = lightCount;
+	if (m_pointLights.GetLightCount() > 0)
 	{
-		m_pShaderManager->setVec2Value("UVscale", glm::vec2(u, v));
+		SetupSceneLights();
 	}
 }
+
+/***********************************************************
+ *  SetLightClusters()
+ *
+ *  This method is used for choosing whether each fragment only
+ *  shades the point lights binned into its cluster, which is
+ *  the default, or loops over every point light.
+ ***********************************************************/
+void SceneManager::SetLightClusters(bool bLightClusters)
+{
+	m_bLightClusters = bLightClusters;
+}
+
+/***********************************************************
+ *  SetDeferredShading()
+ *
+ *  This method is used for choosing between the forward path,
+ *  which lights every fragment as it is drawn, and the
+ *  deferred path, which draws the surfaces into a G-buffer
+ *  and then lights each visible pixel once.  The path can be
+ *  changed between any two frames.
+ ***********************************************************/
+void SceneManager::SetDeferredShading(bool bDeferredShading)
+{
+	m_bDeferredShading = bDeferredShading;
+}
+
+/***********************************************************
+ *  IsDeferredShading()
+ *
+ *  This method is used for checking whether the deferred
+ *  render path is in use.
+ ***********************************************************/
+bool SceneManager::IsDeferredShading() const
+{
+	return(m_bDeferredShading);
+}
+
+/***********************************************************
+ *  SetMultiDrawIndirect()
+ *
+ *  This method is used for choosing whether the whole scene
+ *  is submitted with one indirect multi-draw call, which is
+ *  the default where the context supports it.  It needs to be
+ *  called before the scene is prepared.
+ ***********************************************************/
+void SceneManager::SetMultiDrawIndirect(bool bMultiDrawIndirect)
+{
+	m_bMultiDrawIndirect = bMultiDrawIndirect;
+}
+
+/***********************************************************
+ *  GetRenderStats()
+ *
+ *  This method is used for getting the statistics of the
+ *  most recently rendered frame.
+ ***********************************************************/
+const SceneManager::RENDER_STATS& SceneManager::GetRenderStats() const
+{
+	return(m_renderStats);
+}
+
 /***********************************************************
   *  LoadSceneTextures()
   *
@@ -372,90 +940,208 @@ void SceneManager::SetTextureUVScale(float u, float v)
   ***********************************************************/
 void SceneManager::LoadSceneTextures()
 {  
-	CreateGLTexture("textures/tea.jpg", "teaTexture");
-	CreateGLTexture("textures/wood.jpg", "woodTexture");
-	CreateGLTexture("textures/tree.jpg", "treeTexture");
-	CreateGLTexture("textures/floor.jpg", "floorTexture");
-	CreateGLTexture("textures/bamboo.jpg", "bambooTexture");
-	CreateGLTexture("textures/rug.jpg", "rugTexture");
-	CreateGLTexture("textures/wood2.jpg", "wood2Texture");
+	std::chrono::high_resolution_clock::time_point startTime =
+		std::chrono::high_resolution_clock::now();
+
+	// the textures are listed in the scene file
+	uint32_t textureCount = m_sceneFile.GetTextureCount();
+	const SceneFile::TEXTURE_RECORD* textures = m_sceneFile.GetTextures();
+
+	std::vector<TEXTURE_IMAGE> images;
+	for (uint32_t i = 0; i < textureCount; i++)
+	{
+		AddTextureImage(images,
+			m_sceneFile.GetString(textures[i].filenameOffset),
+			m_sceneFile.GetString(textures[i].tagOffset));
+	}
+
+	// decode in parallel and upload on this thread
+	CreateGLTextures(images);
 	BindGLTextures();
+
+	// look up the handles once, so the objects of the scene file
+	// refer to their textures by index
+	m_sceneTextureHandles.resize(textureCount);
+	for (uint32_t i = 0; i < textureCount; i++)
+	{
+		m_sceneTextureHandles[i] = m_textures.Find(m_sceneFile.GetString(textures[i].tagOffset));
+	}
+
+	std::chrono::duration<double, std::milli> loadTime =
+		std::chrono::high_resolution_clock::now() - startTime;
+	std::cout << "INFO: Loaded " << m_textures.GetCount() << " textures in "
+		<< loadTime.count() << " ms" << std::endl;
+}
+
+/***********************************************************
+ *  AddTextureImage()
+ *
+ *  This method is used for adding an image file to the list
+ *  of textures that will be loaded.
+ ***********************************************************/
+void SceneManager::AddTextureImage(
+	std::vector<TEXTURE_IMAGE>& images,
+	const char* filename,
+	std::string tag)
+{
+	TEXTURE_IMAGE image;
+	image.filename = filename;
+	image.tag = tag;
+	image.width = 0;
+	image.height = 0;
+	image.colorChannels = 0;
+	image.pixels = NULL;
+	images.push_back(image);
 }
+
+/***********************************************************
+ *  DefineObjectMaterials()
+ *
+ *  This method is used for defining the lighting materials
+ *  listed in the scene file.
+ ***********************************************************/
 void SceneManager::DefineObjectMaterials()
 {
-	OBJECT_MATERIAL Material1;
-	Material1.diffuseColor = glm::vec3(0.8f, 0.4f, 0.8f);
-	Material1.specularColor = glm::vec3(0.2f, 0.2f, 0.2f);
-	Material1.shininess = 1.0;
-	Material1.tag = "Material1";
-	m_objectMaterials.push_back(Material1);
-	OBJECT_MATERIAL Material2;
-	Material2.diffuseColor = glm::vec3(0.6f, 0.5f, 0.2f);
-	Material2.specularColor = glm::vec3(0.1f, 0.2f, 0.2f);
-	Material2.shininess = 1.0;
-	Material2.tag = "Material2";
-	m_objectMaterials.push_back(Material2);
-	OBJECT_MATERIAL Material3;
-	Material3.diffuseColor = glm::vec3(0.3f, 0.3f, 0.2f);
-	Material3.specularColor = glm::vec3(0.7f, 0.7f, 0.8f);
-	Material3.shininess = 8.0;
-	Material3.tag = "Material3";
-	m_objectMaterials.push_back(Material3);
-	OBJECT_MATERIAL Material4;
-	Material4.diffuseColor = glm::vec3(0.3f, 0.3f, 0.2f);
-	Material4.specularColor = glm::vec3(0.9f, 0.9f, 0.8f);
-	Material4.shininess = 10.0;
-	Material4.tag = "Material4";
-	m_objectMaterials.push_back(Material4);
-	OBJECT_MATERIAL Material5;
-	Material5.diffuseColor = glm::vec3(0.5f, 0.5f, 0.5f);
-	Material5.specularColor = glm::vec3(0.7f, 0.7f, 0.7f);
-	Material5.shininess = 6.0;
-	Material5.tag = "Material5";
-	m_objectMaterials.push_back(Material5);
-	OBJECT_MATERIAL Material6;
-	Material6.diffuseColor = glm::vec3(0.5f, 0.5f, 0.5f);
-	Material6.specularColor = glm::vec3(0.73f, 0.3f, 0.3f);
-	Material6.shininess = 6.0;
-	Material6.tag = "Material6";
-	m_objectMaterials.push_back(Material6);
+	// the materials are listed in the scene file, and the objects
+	// refer to them by their index in the file
+	uint32_t materialCount = m_sceneFile.GetMaterialCount();
+	const SceneFile::MATERIAL_RECORD* materials = m_sceneFile.GetMaterials();
+
+	m_sceneMaterialBase = (int)m_objectMaterials.size();
+	for (uint32_t i = 0; i < materialCount; i++)
+	{
+		const SceneFile::MATERIAL_RECORD& record = materials[i];
 
+		OBJECT_MATERIAL material;
+		material.diffuseColor = glm::vec3(record.diffuseColor[0], record.diffuseColor[1], record.diffuseColor[2]);
+		material.specularColor = glm::vec3(record.specularColor[0], record.specularColor[1], record.specularColor[2]);
+		material.shininess = record.shininess;
+		material.tag = m_sceneFile.GetString(record.tagOffset);
+		m_objectMaterials.push_back(material);
+		m_materialTable.Add(material.diffuseColor, material.specularColor, material.shininess);
+	}
 }
+
 /***********************************************************
  *  SetupSceneLights()
  *
  *  This method is called to add and configure the light
- *  sources for the 3D scene.  There are up to 4 light sources.
+ *  sources for the 3D scene.  The 4 scene lights reach the
+ *  whole scene, and generated lights fill up the requested
+ *  number of point lights.
  ***********************************************************/
 void SceneManager::SetupSceneLights()
 {
-	m_pShaderManager->setBoolValue(g_UseLightingName, true);
+	m_bUseLighting = true;
   
+	// the point lights are binned into view clusters every
+	// frame, so there is no fixed limit on their number
+	m_pointLights.Clear();
+
 	// point light 1
-	m_pShaderManager->setVec3Value("pointLights[0].position", -4.0f, 4.0f, 4.0f);
-	m_pShaderManager->setVec3Value("pointLights[0].ambient", 0.05f, 0.05f, 0.05f);
-	m_pShaderManager->setVec3Value("pointLights[0].diffuse", 0.8f, 0.8f, 0.8f);
-	m_pShaderManager->setVec3Value("pointLights[0].specular", 0.2f, 0.2f, 0.2f);
-	m_pShaderManager->setBoolValue("pointLights[0].bActive", true);
+	m_pointLights.AddLight(
+		glm::vec3(-4.0f, 4.0f, 4.0f),		// position
+		glm::vec3(0.05f, 0.05f, 0.05f),		// ambient
+		glm::vec3(0.8f, 0.8f, 0.8f),		// diffuse
+		glm::vec3(0.2f, 0.2f, 0.2f),		// specular
+		0.0f);								// radius
 	// point light 2
-	m_pShaderManager->setVec3Value("pointLights[1].position", 4.0f, 4.0f, 4.0f);
-	m_pShaderManager->setVec3Value("pointLights[1].ambient", 0.05f, 0.05f, 0.05f);
-	m_pShaderManager->setVec3Value("pointLights[1].diffuse", 0.8f, 0.8f, 0.8f);
-	m_pShaderManager->setVec3Value("pointLights[1].specular", 0.2f, 0.2f, 0.2f);
-	m_pShaderManager->setBoolValue("pointLights[1].bActive", true);
+	m_pointLights.AddLight(
+		glm::vec3(4.0f, 4.0f, 4.0f),
+		glm::vec3(0.05f, 0.05f, 0.05f),
+		glm::vec3(0.8f, 0.8f, 0.8f),
+		glm::vec3(0.2f, 0.2f, 0.2f),
+		0.0f);
 	// point light 3
-	m_pShaderManager->setVec3Value("pointLights[2].position", 0.0f, 6.0f, 2.0f);
-	m_pShaderManager->setVec3Value("pointLights[2].ambient", 0.05f, 0.05f, 0.05f);
-	m_pShaderManager->setVec3Value("pointLights[2].diffuse", 1.0f, 1.0f, 1.0f);
-	m_pShaderManager->setVec3Value("pointLights[2].specular", 0.2f, 0.2f, 0.2f);
-	m_pShaderManager->setBoolValue("pointLights[2].bActive", true);
+	m_pointLights.AddLight(
+		glm::vec3(0.0f, 6.0f, 2.0f),
+		glm::vec3(0.05f, 0.05f, 0.05f),
+		glm::vec3(1.0f, 1.0f, 1.0f),
+		glm::vec3(0.2f, 0.2f, 0.2f),
+		0.0f);
 	// point light 4
-	m_pShaderManager->setVec3Value("pointLights[3].position", -3.0f, 6.0f, 6.0f);
-	m_pShaderManager->setVec3Value("pointLights[3].ambient", 0.05f, 0.05f, 0.05f);
-	m_pShaderManager->setVec3Value("pointLights[3].diffuse", 0.3f, 0.3f, 0.3f);
-	m_pShaderManager->setVec3Value("pointLights[3].specular", 0.8f, 0.8f, 0.8f);
-	m_pShaderManager->setBoolValue("pointLights[3].bActive", true);
+	m_pointLights.AddLight(
+		glm::vec3(-3.0f, 6.0f, 6.0f),
+		glm::vec3(0.05f, 0.05f, 0.05f),
+		glm::vec3(0.3f, 0.3f, 0.3f),
+		glm::vec3(0.8f, 0.8f, 0.8f),
+		0.0f);
+
+	AddGeneratedLights(m_pointLightCount - m_pointLights.GetLightCount());
+}
+
+/***********************************************************
+ *  AddGeneratedLights()
+ *
+ *  This method is used for adding small colored point lights
+ *  spread over the table top, for measuring scenes with many
+ *  lights.  The positions and colors come from a fixed low
+ *  discrepancy sequence, so every run places the same lights.
+ ***********************************************************/
+void SceneManager::AddGeneratedLights(int lightCount)
+{
+	for (int i = 0; i < lightCount; i++)
+	{
+		// fractional parts of multiples of irrational numbers
+		// spread the lights evenly without clumping
+		float sequence = (float)(i + 1);
+		glm::vec3 spread = glm::vec3(
+			sequence * 0.7548777f,
+			sequence * 0.4142136f,
+			sequence * 0.5698403f);
+		spread = spread - glm::floor(spread);
+		glm::vec3 position = GENERATED_LIGHTS_MINIMUM + (spread * GENERATED_LIGHTS_SIZE);
+
+		// fully saturated color from the hue around the color wheel
+		float hue = (sequence * 0.6180340f) - std::floor(sequence * 0.6180340f);
+		glm::vec3 color = glm::vec3(
+			glm::clamp(std::fabs(hue * 6.0f - 3.0f) - 1.0f, 0.0f, 1.0f),
+			glm::clamp(2.0f - std::fabs(hue * 6.0f - 2.0f), 0.0f, 1.0f),
+			glm::clamp(2.0f - std::fabs(hue * 6.0f - 4.0f), 0.0f, 1.0f));
+
+		m_pointLights.AddLight(
+			position,
+			glm::vec3(0.0f),
+			color * 0.6f,
+			color * 0.3f,
+			GENERATED_LIGHT_RADIUS);
+	}
+}
+
+/***********************************************************
+ *  UpdatePointLights()
+ *
+ *  This method is used for binning the point lights into the
+ *  clusters of the current view, writing them to the GPU and
+ *  binding them for the frame.  With the clusters turned off
+ *  only the lights are written, and every fragment loops over
+ *  all of them.  The light count and cluster slicing go into
+ *  the per-frame uniform buffer shared by every program.
+ ***********************************************************/
+void SceneManager::UpdatePointLights()
+{
+	if ((m_bLightClusters == true) && (NULL != m_pFrameUniforms))
+	{
+		m_pointLights.Build(m_pFrameUniforms->GetView(), m_pFrameUniforms->GetProjection());
+		m_renderStats.lightIndices = m_pointLights.GetStats().lightIndices;
+	}
+	m_pointLights.Upload();
+	m_renderStats.pointLights = m_pointLights.GetLightCount();
 
+	GLint maxTextureUnits = 0;
+	glGetIntegerv(GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS, &maxTextureUnits);
+	int lightUnit = maxTextureUnits - LIGHT_TABLE_UNIT;
+	int gridUnit = maxTextureUnits - LIGHT_GRID_UNIT;
+	int indexUnit = maxTextureUnits - LIGHT_INDEX_UNIT;
+	m_pointLights.Bind(lightUnit, gridUnit, indexUnit);
+
+	if (NULL != m_pFrameUniforms)
+	{
+		m_pFrameUniforms->SetPointLightClusters(
+			m_pointLights.GetLightCount(),
+			m_pointLights.GetNearDepth(),
+			m_pointLights.GetSliceScale());
+	}
 }
 
 /***********************************************************
@@ -467,18 +1153,344 @@ void SceneManager::SetupSceneLights()
  ***********************************************************/
 void SceneManager::PrepareScene()
 {
-	// load the textures for the 3D scene
+	// the textures, materials and objects are described by the
+	// scene file, which is only mapped while the scene is built
+	bool bSceneFile = m_sceneFile.Open(m_sceneFilename.c_str());
+	if (bSceneFile == false)
+	{
+		std::cout << "WARNING: the scene is empty - convert a scene text with --convert-scene" << std::endl;
+	}
+
+	// load the textures for the 3D scene, which only sets up the
+	// texture units when there is no scene file
 	LoadSceneTextures();
-	// define the materials for objects in the scene
-	DefineObjectMaterials();
+	if (bSceneFile == true)
+	{
+		// define the materials for objects in the scene
+		DefineObjectMaterials();
+	}
+	BindMaterialTable();
+	BindDrawTable();
 	// add and define the light sources for the scene
 	SetupSceneLights();
 
+	m_basicMeshes->SetPackedVertices(m_bPackedVertices);
+	m_basicMeshes->SetIndexOptimization(m_bOptimizeIndices);
 	m_basicMeshes->LoadCylinderMesh();
 	m_basicMeshes->LoadPlaneMesh();     // Load the plane for the table/ground
 	m_basicMeshes->LoadSphereMesh();
 	m_basicMeshes->LoadTaperedCylinderMesh();
 	m_basicMeshes->LoadTorusMesh();
+	ReportMeshMemory();
+
+	// place the objects once - they are not rebuilt every frame,
+	// and only the stress objects are placed without a scene file
+	DefineSceneObjects();
+	m_sceneFile.Close();
+
+	// the programs of the path in use compile while the first
+	// frames are drawn, and the other path follows the first frame
+	RequestShaderVariants(m_bDeferredShading);
+	m_bOtherPathRequested = false;
+}
+
+/***********************************************************
+ *  GetSceneFeatures()
+ *
+ *  This method is used for getting the shader features that
+ *  every draw of the scene shares in the pass being drawn.
+ ***********************************************************/
+unsigned int SceneManager::GetSceneFeatures() const
+{
+	unsigned int features = m_passFeatures;
+	if (m_bUseLighting == true)
+	{
+		features |= ShaderVariants::FEATURE_LIGHTING;
+	}
+	if (m_bUseTextureArray == true)
+	{
+		features |= ShaderVariants::FEATURE_TEXTURE_ARRAY;
+	}
+	if (m_basicMeshes->IsPackedVertices() == true)
+	{
+		features |= ShaderVariants::FEATURE_PACKED_VERTICES;
+	}
+	if (m_bLightClusters == true)
+	{
+		features |= ShaderVariants::FEATURE_LIGHT_CLUSTERS;
+	}
+
+	return(features);
+}
+
+/***********************************************************
+ *  RequestShaderVariants()
+ *
+ *  This method is used for starting the compiles of every
+ *  program that a render path draws with, so the driver works
+ *  on all of them at once instead of one at a time as each
+ *  is first drawn.  The fallbacks are started first, since
+ *  they are drawn with until the others are ready.  Nothing
+ *  is started when the driver cannot compile in the
+ *  background, and each program is compiled when first drawn.
+ ***********************************************************/
+void SceneManager::RequestShaderVariants(bool bDeferredShading)
+{
+	if (NULL == m_pShaderVariants)
+	{
+		return;
+	}
+
+	// draw features of the draws that the render queue submits
+	std::vector<unsigned int> drawFeatures;
+	if (m_bMultiDrawIndirect == true)
+	{
+		drawFeatures.push_back(ShaderVariants::FEATURE_DRAW_TABLE | ShaderVariants::FEATURE_INSTANCING);
+		drawFeatures.push_back(ShaderVariants::FEATURE_DRAW_TABLE | ShaderVariants::FEATURE_INSTANCING |
+			ShaderVariants::FEATURE_TEXTURE);
+	}
+	else
+	{
+		drawFeatures.push_back(0);
+		drawFeatures.push_back(ShaderVariants::FEATURE_INSTANCING);
+		drawFeatures.push_back(ShaderVariants::FEATURE_TEXTURE);
+		drawFeatures.push_back(ShaderVariants::FEATURE_INSTANCING | ShaderVariants::FEATURE_TEXTURE);
+	}
+
+	// the pass features are only set while a pass is drawn
+	unsigned int sceneFeatures = GetSceneFeatures();
+	unsigned int passFeatures = 0;
+	if (bDeferredShading == true)
+	{
+		passFeatures = ShaderVariants::FEATURE_GEOMETRY_PASS;
+	}
+
+	std::vector<unsigned int> features;
+	for (size_t i = 0; i < drawFeatures.size(); i++)
+	{
+		features.push_back(sceneFeatures | passFeatures | drawFeatures[i]);
+	}
+	if (bDeferredShading == true)
+	{
+		features.push_back((sceneFeatures &
+			(ShaderVariants::FEATURE_LIGHTING | ShaderVariants::FEATURE_LIGHT_CLUSTERS)) |
+			ShaderVariants::FEATURE_LIGHTING_PASS);
+	}
+
+	for (size_t i = 0; i < features.size(); i++)
+	{
+		m_pShaderVariants->RequestVariant(ShaderVariants::GetFallbackFeatures(features[i]));
+	}
+	for (size_t i = 0; i < features.size(); i++)
+	{
+		m_pShaderVariants->RequestVariant(features[i]);
+	}
+}
+
+/***********************************************************
+ *  UseShaderVariant()
+ *
+ *  This method is used for making the program of a feature
+ *  mask current, only when it is not current already.  While
+ *  the program is still compiling, the simpler fallback
+ *  program draws the same vertices in its place.  A program
+ *  that is used for the first time is set up first.  It
+ *  returns false when neither program compiles, and the
+ *  draws that need it are skipped.
+ ***********************************************************/
+bool SceneManager::UseShaderVariant(unsigned int features)
+{
+	if (NULL == m_pShaderVariants)
+	{
+		return(false);
+	}
+
+	bool bCompiled = false;
+	int variant = m_pShaderVariants->GetReadyVariant(features, bCompiled);
+	unsigned int fallbackFeatures = ShaderVariants::GetFallbackFeatures(features);
+	if ((variant < 0) && (fallbackFeatures != features))
+	{
+		variant = m_pShaderVariants->GetVariant(fallbackFeatures, bCompiled);
+		if (variant >= 0)
+		{
+			m_renderStats.fallbackPrograms++;
+		}
+	}
+	if (variant < 0)
+	{
+		// nothing simpler draws the same vertices, so wait for it
+		variant = m_pShaderVariants->GetVariant(features, bCompiled);
+	}
+	if (variant < 0)
+	{
+		return(false);
+	}
+
+	// compiling a variant can move the uniforms of the others
+	m_pShaderUniforms = &m_pShaderVariants->GetUniforms(variant);
+	if (variant != m_currentVariant)
+	{
+		m_pShaderVariants->Use(variant);
+		m_currentVariant = variant;
+		m_renderStats.programChanges++;
+	}
+	if (bCompiled == true)
+	{
+		SetupShaderProgram();
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  SetupShaderProgram()
+ *
+ *  This method is used for setting the values that stay the
+ *  same for the whole run into the current program once it
+ *  is compiled - its uniform blocks, the texture units of its
+ *  samplers and the quantization box of every mesh.  The
+ *  draws then only set the values that change between them.
+ ***********************************************************/
+void SceneManager::SetupShaderProgram()
+{
+	FrameUniforms::AttachProgram(m_pShaderUniforms->GetProgramID());
+
+	GLint maxTextureUnits = 0;
+	glGetIntegerv(GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS, &maxTextureUnits);
+
+	m_pShaderUniforms->objectTexture.Set(0);
+	m_pShaderUniforms->objectTextureArray.Set(maxTextureUnits - TEXTURE_ARRAY_UNIT);
+	m_pShaderUniforms->materialTable.Set(maxTextureUnits - MATERIAL_TABLE_UNIT);
+	m_pShaderUniforms->drawTable.Set(maxTextureUnits - DRAW_TABLE_UNIT);
+	m_pShaderUniforms->lightTable.Set(maxTextureUnits - LIGHT_TABLE_UNIT);
+	m_pShaderUniforms->lightGrid.Set(maxTextureUnits - LIGHT_GRID_UNIT);
+	m_pShaderUniforms->lightIndices.Set(maxTextureUnits - LIGHT_INDEX_UNIT);
+	m_pShaderUniforms->gBufferAlbedo.Set(maxTextureUnits - (GBUFFER_FIRST_UNIT + GBuffer::ALBEDO_TARGET));
+	m_pShaderUniforms->gBufferNormal.Set(maxTextureUnits - (GBUFFER_FIRST_UNIT + GBuffer::NORMAL_TARGET));
+	m_pShaderUniforms->gBufferMaterial.Set(maxTextureUnits - (GBUFFER_FIRST_UNIT + GBuffer::MATERIAL_TARGET));
+	m_pShaderUniforms->gBufferDepth.Set(maxTextureUnits - (GBUFFER_FIRST_UNIT + GBuffer::DEPTH_TARGET));
+
+	if (m_basicMeshes->IsPackedVertices() == false)
+	{
+		return;
+	}
+
+	glm::vec3 centers[(int)ShapeMesh::Count];
+	glm::vec3 scales[(int)ShapeMesh::Count];
+	for (int i = 0; i < (int)ShapeMesh::Count; i++)
+	{
+		centers[i] = m_basicMeshes->GetMeshBounds((ShapeMesh)i).center;
+		scales[i] = m_basicMeshes->GetQuantizationScale((ShapeMesh)i);
+	}
+	m_pShaderUniforms->meshQuantizationCenter.SetArray(centers, (int)ShapeMesh::Count);
+	m_pShaderUniforms->meshQuantizationScale.SetArray(scales, (int)ShapeMesh::Count);
+}
+
+/***********************************************************
+ *  ReportMeshMemory()
+ *
+ *  This method is used for closing any gaps in the buffer
+ *  shared by the meshes and printing how it is used, along
+ *  with how many vertices the simulated vertex cache misses
+ *  per triangle (ACMR) before and after the triangles were
+ *  reordered.
+ ***********************************************************/
+void SceneManager::ReportMeshMemory()
+{
+	m_basicMeshes->DefragmentArena();
+
+	BufferArena::ARENA_STATS stats = m_basicMeshes->GetArenaStats();
+	std::cout << "INFO: Mesh buffer holds " << stats.allocationCount << " allocations, "
+		<< (stats.usedBytes / 1024) << " of " << (stats.capacity / 1024) << " KB used, "
+		<< stats.freeBlockCount << " free blocks, largest "
+		<< (stats.largestFreeBlock / 1024) << " KB, grown " << stats.growCount << " times"
+		<< std::endl;
+	std::cout << "INFO: Mesh vertices are " << (m_basicMeshes->IsPackedVertices() ? "packed" : "float")
+		<< ", " << m_basicMeshes->GetVertexSize() << " bytes each" << std::endl;
+
+	SceneMeshes::CACHE_STATS cacheStats = m_basicMeshes->GetCacheStats();
+	if (cacheStats.triangleCount > 0)
+	{
+		float triangles = (float)cacheStats.triangleCount;
+		std::cout << "INFO: Mesh ACMR " << (cacheStats.generatedMisses / triangles) << " as generated, "
+			<< (cacheStats.uploadedMisses / triangles) << " as uploaded, over "
+			<< cacheStats.triangleCount << " triangles with a "
+			<< MeshOptimizer::DEFAULT_CACHE_SIZE << " vertex cache" << std::endl;
+	}
+}
+
+/***********************************************************
+ *  DefineSceneObjects()
+ *
+ *  This method is used for placing the objects of the 3D
+ *  scene from the scene file.  The nodes are already in
+ *  depth-first order, so they go straight into the scene
+ *  graph, and compound objects such as the teapot and the
+ *  cups keep their parts as children of one parent node.
+ ***********************************************************/
+void SceneManager::DefineSceneObjects()
+{
+	std::chrono::high_resolution_clock::time_point startTime =
+		std::chrono::high_resolution_clock::now();
+
+	m_sceneGraph.Clear();
+	m_entities.Clear();
+
+	uint32_t nodeCount = m_sceneFile.GetNodeCount();
+	uint32_t objectCount = m_sceneFile.GetObjectCount();
+	m_sceneGraph.Reserve((int)nodeCount + m_stressObjectCount + 1);
+	m_entities.Reserve((int)objectCount + m_stressObjectCount);
+
+	// the records are read directly from the mapped file
+	const SceneFile::NODE_RECORD* nodes = m_sceneFile.GetNodes();
+	for (uint32_t i = 0; i < nodeCount; i++)
+	{
+		const SceneFile::NODE_RECORD& node = nodes[i];
+		int nodeIndex = m_sceneGraph.AddNode(node.parent, Transform(
+			glm::vec3(node.scale[0], node.scale[1], node.scale[2]),
+			node.rotationDegrees[0],
+			node.rotationDegrees[1],
+			node.rotationDegrees[2],
+			glm::vec3(node.position[0], node.position[1], node.position[2])));
+
+		// the objects refer to the nodes by index, so one missing
+		// node would move every object after it
+		if (nodeIndex != (int)i)
+		{
+			std::cout << "ERROR: could not add node " << i
+				<< " of the scene file, its objects are not placed" << std::endl;
+			m_sceneGraph.Clear();
+			objectCount = 0;
+			break;
+		}
+	}
+
+	const SceneFile::OBJECT_RECORD* objects = m_sceneFile.GetObjects();
+	for (uint32_t i = 0; i < objectCount; i++)
+	{
+		const SceneFile::OBJECT_RECORD& object = objects[i];
+
+		int textureHandle = TextureRegistry::INVALID_HANDLE;
+		if (object.texture != SceneFile::NONE)
+		{
+			textureHandle = m_sceneTextureHandles[object.texture];
+		}
+		int materialIndex = -1;
+		if (object.material != SceneFile::NONE)
+		{
+			materialIndex = m_sceneMaterialBase + object.material;
+		}
+
+		AddSceneObject((ShapeMesh)object.mesh, textureHandle, materialIndex, (int)object.node);
+	}
+
+	// extra objects for measuring large scenes
+	AddStressObjects(m_stressObjectCount);
+
+	std::chrono::duration<double, std::milli> loadTime =
+		std::chrono::high_resolution_clock::now() - startTime;
+	std::cout << "INFO: Placed " << m_entities.GetCount() << " objects in "
+		<< loadTime.count() << " ms" << std::endl;
 }
 
 /***********************************************************
@@ -488,149 +1500,187 @@ void SceneManager::PrepareScene()
  ***********************************************************/
 void SceneManager::RenderScene()
 {
-	// plate
-	glm::vec3 scalePlate = glm::vec3(4.0f, 0.05f, 4.0f); // Adjust the size to be wider and thinner for a plate
-	SetTransformations(scalePlate, 0.0f, 0.0f, 0.0f, glm::vec3(0.0f, -0.8f, 0.0f)); // Position it just above the table
-	SetShaderTexture("bambooTexture"); // Use a suitable texture for the plate
-	SetShaderMaterial("Material2"); // Material for the plate
-	m_basicMeshes->DrawCylinderMesh(); // Draw the plate (still using DrawCylinderMesh, but with adjusted scale)
-
-	// table
-	glm::vec3 scaleTable = glm::vec3(10.0f, 0.01f, 10.0f); // Adjust size for a circular appearance
-	SetTransformations(scaleTable, 0.0f, 0.0f, 0.0f, glm::vec3(0.0f, -1.0f, 0.0f)); // Position the circular table
-	SetShaderTexture("woodTexture"); // Use a wood texture for the table
-	SetShaderMaterial("Material2");
-	m_basicMeshes->DrawCylinderMesh();
-
-	// Drawing table legs
-	glm::vec3 legScale = glm::vec3(0.2f, 10.0f, 0.2f); // Larger scale for table legs
-	SetShaderTexture("woodTexture"); // Use wood texture for legs
-	SetShaderMaterial("Material2");
-
-	// Position for Leg 1 (front-left)
-	SetTransformations(legScale, 0.0f, 0.0f, 0.0f, glm::vec3(-4.0f, -11.0f, 4.0f)); // Position it under the table
-	SetShaderTexture("woodTexture"); // Use wood texture for legs
-	SetShaderMaterial("Material2");
-	m_basicMeshes->DrawCylinderMesh(); // Draw Leg 1
-
-	// Position for Leg 2 (front-right)
-	SetTransformations(legScale, 0.0f, 0.0f, 0.0f, glm::vec3(4.0f, -11.0f, 4.0f)); // Position it under the table
-	SetShaderTexture("woodTexture"); // Use wood texture for legs
-	SetShaderMaterial("Material2");
-	m_basicMeshes->DrawCylinderMesh(); // Draw Leg 2
-
-	// Position for Leg 3 (back-left)
-	SetTransformations(legScale, 0.0f, 0.0f, 0.0f, glm::vec3(-4.0f, -11.0f, -4.0f)); // Position it under the table
-	SetShaderTexture("woodTexture"); // Use wood texture for legs
-	SetShaderMaterial("Material2");
-	m_basicMeshes->DrawCylinderMesh(); // Draw Leg 3
-
-	// Position for Leg 4 (back-right)
-	SetTransformations(legScale, 0.0f, 0.0f, 0.0f, glm::vec3(4.0f, -11.0f, -4.0f)); // Position it under the table
-	SetShaderTexture("woodTexture"); // Use wood texture for legs
-	SetShaderMaterial("Material2");
-	m_basicMeshes->DrawCylinderMesh(); // Draw Leg 4
-
-	// teapot base
-	glm::vec3 scaleTeapotBase = glm::vec3(1.2f, 0.5f, 1.2f); // Scale for teapot base
-	SetTransformations(scaleTeapotBase, 0.0f, 0.0f, 0.0f, glm::vec3(0.0f, -0.5f, 0.0f)); // Position it
-	SetShaderTexture("teaTexture"); // Use a ceramic texture
-	SetShaderMaterial("Material4"); // Material for the cup
-	m_basicMeshes->DrawSphereMesh(); // Draw the teapot body
-
-	// Teapot Lid
-	glm::vec3 scaleTeapotLid = glm::vec3(0.6f, 0.3f, 0.6f); // Scale for teapot lid
-	SetTransformations(scaleTeapotLid, 0.0f, 0.0f, 0.0f, glm::vec3(0.0f, 0.0f, 0.0f)); // Position it on top
-	SetShaderTexture("teaTexture"); // Use a ceramic texture
-	SetShaderMaterial("Material4"); // Material for the cup
-	m_basicMeshes->DrawSphereMesh(); // Draw the teapot lid
-
-	// Teapot Lid2
-	glm::vec3 scaleTeapotLid2 = glm::vec3(0.1f, 0.2f, 0.1f); // Scale for teapot lid
-	SetTransformations(scaleTeapotLid2, 0.0f, 0.0f, 0.0f, glm::vec3(0.0f, 0.3f, 0.0f)); // Position it on top
-	SetShaderTexture("teaTexture"); // Use a ceramic texture
-	SetShaderMaterial("Material4"); // Material for the cup
-	m_basicMeshes->DrawSphereMesh(); // Draw the teapot lid
-
-	//teapot spout
-	glm::vec3 scaleTeapotSpout = glm::vec3(0.2f, 0.4f, 0.2f); // Scale for spout
-	SetTransformations(scaleTeapotSpout, 0.0f, 0.0f, 0.0f, glm::vec3(1.0f, -0.3f, 0.0f)); // Position it on the side
-	SetShaderTexture("teaTexture"); // Use a ceramic texture
-	SetShaderMaterial("Material4"); // Material for the cup
-	m_basicMeshes->DrawTaperedCylinderMesh(); // Draw the spout
-	//teapot handle
-	glm::vec3 scaleCupHandle = glm::vec3(0.15f, 0.5f, 0.15f); // Scale for handle
-	SetTransformations(scaleCupHandle, 0.0f, 0.0f, 0.0f, glm::vec3(-1.0f, 0.0f, -0.0f)); // Position it
-	SetShaderTexture("teaTexture"); // Use a ceramic texture
-	SetShaderMaterial("Material4"); // Material for the cup
-	m_basicMeshes->DrawTorusMesh(); // Draw the cup handle
-	//cup body
-	glm::vec3 scaleCupBody = glm::vec3(0.5f, 0.3f, 0.5f); // Scale for cup body
-	SetTransformations(scaleCupBody, 0.0f, 0.0f, 0.0f, glm::vec3(2.5f, -0.75f, 1.5f)); // Position it next to the teapot
-	SetShaderTexture("teaTexture"); // Use a ceramic texture
-	SetShaderMaterial("Material4"); // Material for the cup
-	m_basicMeshes->DrawCylinderMesh(); // Draw the cup body
-
-	// Cup Base
-	glm::vec3 scaleCupBase = glm::vec3(0.45f, 0.05f, 0.45f); // Scale for cup base
-	SetTransformations(scaleCupBase, 0.0f, 0.0f, 0.0f, glm::vec3(2.5f, -0.75f - 0.05f, 1.5f)); // Position it just below the cup body
-	SetShaderTexture("teaTexture"); // Use a ceramic texture
-	SetShaderMaterial("Material4"); // Material for the cup
-	m_basicMeshes->DrawCylinderMesh(); // Draw the cup base
-
-	// Cup Handle
-	glm::vec3 scaleCupHandle2 = glm::vec3(0.1f, 0.3f, 0.1f); // Scale for cup handle
-	SetTransformations(scaleCupHandle2, 0.0f, 0.0f, 0.0f, glm::vec3(2.0f, -0.5f, 1.5f)); // Position the handle
-	SetShaderTexture("teaTexture"); // Use a ceramic texture
-	SetShaderMaterial("Material4"); // Material for the cup
-	m_basicMeshes->DrawTorusMesh(); // Draw the cup handle
-
-	// Second Cup Body
-	glm::vec3 scaleCupBody2 = glm::vec3(0.5f, 0.3f, 0.5f); // Scale for second cup body
-	SetTransformations(scaleCupBody2, 0.0f, 0.0f, 0.0f, glm::vec3(-1.5f, -0.75f, 1.5f)); // Position it on the left side of the plate
-	SetShaderTexture("teaTexture"); // Use a ceramic texture
-	SetShaderMaterial("Material4"); // Material for the cup
-	m_basicMeshes->DrawCylinderMesh(); // Draw the second cup body
-
-	// Second Cup Base
-	glm::vec3 scaleCupBase2 = glm::vec3(0.45f, 0.05f, 0.45f); // Scale for second cup base
-	SetTransformations(scaleCupBase2, 0.0f, 0.0f, 0.0f, glm::vec3(-1.5f, -0.75f - 0.05f, 1.5f)); // Position it just below the second cup body
-	SetShaderTexture("teaTexture"); // Use a ceramic texture
-	SetShaderMaterial("Material4"); // Material for the cup
-	m_basicMeshes->DrawCylinderMesh(); // Draw the second cup base
-
-	// Second Cup Handle
-	glm::vec3 scaleCupHandle3 = glm::vec3(0.1f, 0.3f, 0.1f); // Scale for second cup handle
-	SetTransformations(scaleCupHandle3, 0.0f, 0.0f, 0.0f, glm::vec3(-2.0f, -0.5f, 1.5f)); // Position the handle to the left of the second cup body
-	SetShaderTexture("teaTexture"); // Use a ceramic texture
-	SetShaderMaterial("Material4"); // Material for the cup
-	m_basicMeshes->DrawTorusMesh(); // Draw the second cup handle
-
-	// Drawing the floor as a plane
-	glm::vec3 scaleFloor = glm::vec3(30.0f, 1.0f, 30.0f);
-	SetTransformations(scaleFloor, 0.0f, 0.0f, 0.0f, glm::vec3(0.0f, -11.5f, 0.0f));
-	SetShaderTexture("floorTexture");
-	SetShaderMaterial("Material6");
-	m_basicMeshes->DrawPlaneMesh();
-
-	// Circular Rug under the table
-	glm::vec3 scaleRug = glm::vec3(15.0f, 0.5f, 15.0f);// (slightly larger than table)
-	SetTransformations(scaleRug, 0.0f, 0.0f, 0.0f, glm::vec3(0.0f, -11.01f, 0.0f)); // Position just below the table
-	SetShaderTexture("rugTexture"); // Use a rug texture or a colored material
-	m_basicMeshes->DrawCylinderMesh(); // Draw the rug (cylinder scaled to look like a flat disk)
-
-	// Create the barrel
-	glm::vec3 scaleBarrelBody = glm::vec3(3.0f, 6.5f, 3.0f);  // Larger dimensions for the barrel
-	SetTransformations(scaleBarrelBody, 0.0f, 0.0f, 0.0f, glm::vec3(-12.0f, -11.5f, 0.0f));  // Positioned level with the floor
-	SetShaderTexture("wood2Texture");  // Use a wood texture for the barrel
-	SetShaderMaterial("Material2");  // Use appropriate material for wooden texture
-	m_basicMeshes->DrawCylinderMesh();  // Draw the main barrel body
-
-	// Create the barrel
-	glm::vec3 scaleBarrel2Body = glm::vec3(3.0f, 6.5f, 3.0f);  // Larger dimensions for the barrel
-	SetTransformations(scaleBarrel2Body, 0.0f, 0.0f, 0.0f, glm::vec3(12.0f, -11.5f, 0.0f));  // Positioned level with the floor
-	SetShaderTexture("wood2Texture");  // Use a wood texture for the barrel
-	SetShaderMaterial("Material2");  // Use appropriate material for wooden texture
-	m_basicMeshes->DrawCylinderMesh();  // Draw the main barrel body
+	// reset the statistics for this frame
+	m_renderStats.drawCalls = 0;
+	m_renderStats.programChanges = 0;
+	m_renderStats.fallbackPrograms = 0;
+	m_renderStats.textureChanges = 0;
+	m_renderStats.materialChanges = 0;
+	m_renderStats.meshChanges = 0;
+	m_renderStats.visibleObjects = 0;
+	m_renderStats.culledObjects = 0;
+	m_renderStats.transformUpdates = 0;
+	m_renderStats.indirectCommands = 0;
+	m_renderStats.triangles = 0;
+	m_renderStats.pointLights = 0;
+	m_renderStats.lightIndices = 0;
+	// the first draw of the frame sets its program
+	m_currentVariant = -1;
+
+	// read the pass times of an earlier frame
+	m_passTimer.BeginFrame();
+	for (int pass = 0; pass < RENDER_PASS_COUNT; pass++)
+	{
+		m_renderStats.passTimes[pass] = m_passTimer.GetPassTime(pass);
+	}
 
+	// bin the point lights into the clusters of this view, and
+	// write the camera and lights in one buffer update
+	UpdatePointLights();
+	if (NULL != m_pFrameUniforms)
+	{
+		m_pFrameUniforms->Upload();
+	}
+
+	// rebuild the world matrices of the subtrees that have moved
+	// and refresh the objects drawn at those nodes
+	m_renderStats.transformUpdates = m_sceneGraph.UpdateWorldTransforms();
+	m_entities.UpdateTransforms(m_sceneGraph);
+
+	// cull all of the objects in one batch
+	int visibleObjects = m_entities.GetCount();
+	glm::vec3 viewPosition(0.0f);
+	if (NULL != m_pFrameUniforms)
+	{
+		viewPosition = m_pFrameUniforms->GetViewPosition();
+		m_frustumCuller.SetViewProjection(m_pFrameUniforms->GetViewProjection());
+	}
+	if ((m_bFrustumCulling == true) && (NULL != m_pFrameUniforms))
+	{
+		visibleObjects = m_entities.Cull(&m_frustumCuller);
+	}
+	else
+	{
+		m_entities.Cull(NULL);
+	}
+	m_renderStats.culledObjects = m_entities.GetCount() - visibleObjects;
+
+	// pick the mesh detail level of the visible objects
+	if ((m_bLevelOfDetail == true) && (NULL != m_pFrameUniforms))
+	{
+		int lodCounts[(int)ShapeMesh::Count];
+		for (int mesh = 0; mesh < (int)ShapeMesh::Count; mesh++)
+		{
+			lodCounts[mesh] = m_basicMeshes->GetLodCount((ShapeMesh)mesh);
+		}
+		m_entities.SelectLods(
+			m_pFrameUniforms->GetProjection(),
+			viewPosition,
+			lodCounts,
+			(int)ShapeMesh::Count);
+	}
+	else
+	{
+		m_entities.ResetLods();
+	}
+
+	// group the visible objects by state and queue each group
+	// as one draw, without culling the instances a second time
+	m_entities.BuildBatches(viewPosition, m_renderQueue.IsSorting());
+
+	const std::vector<EntityStore::DRAW_BATCH>& batches = m_entities.GetBatches();
+	for (size_t i = 0; i < batches.size(); i++)
+	{
+		const EntityStore::DRAW_BATCH& batch = batches[i];
+
+		// the features of the draw select its program
+		m_renderQueue.Add(
+			GetDrawFeatures(batch.instanceCount, batch.textureHandle),
+			batch.mesh,
+			batch.lod,
+			batch.textureHandle,
+			batch.materialIndex,
+			m_entities.GetBatchMatrices(batch),
+			NULL,
+			batch.instanceCount,
+			batch.depth);
+	}
+
+	// sort the queued draws and draw them
+	if (m_bDeferredShading == true)
+	{
+		SubmitDeferred();
+	}
+	else
+	{
+		m_passTimer.BeginPass(FORWARD_PASS);
+		SubmitRenderQueue();
+		m_passTimer.EndPass(FORWARD_PASS);
+	}
+
+	// the other path is only compiled once the first frame no
+	// longer competes with it for the compile threads
+	if (m_bOtherPathRequested == false)
+	{
+		RequestShaderVariants(!m_bDeferredShading);
+		m_bOtherPathRequested = true;
+	}
+}
+
+/***********************************************************
+ *  SubmitDeferred()
+ *
+ *  This method is used for drawing the queued draws with
+ *  deferred shading.  The geometry pass draws the surfaces
+ *  into the G-buffer without lighting them, and the lighting
+ *  pass then shades every pixel that holds a surface once,
+ *  however many surfaces were drawn over each other there.
+ *  The G-buffer keeps one surface per pixel, so the surfaces
+ *  are treated as opaque.
+ ***********************************************************/
+void SceneManager::SubmitDeferred()
+{
+	GLint viewport[4] = { 0, 0, 0, 0 };
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	if ((NULL == m_pShaderVariants) ||
+		(m_gBuffer.Resize(viewport[2], viewport[3]) == false))
+	{
+		// fall back to the forward path
+		m_passTimer.BeginPass(FORWARD_PASS);
+		SubmitRenderQueue();
+		m_passTimer.EndPass(FORWARD_PASS);
+		return;
+	}
+
+	// the material index and normal targets cannot be blended
+	GLboolean bBlending = glIsEnabled(GL_BLEND);
+	glDisable(GL_BLEND);
+
+	m_passTimer.BeginPass(GEOMETRY_PASS);
+	m_gBuffer.BeginGeometryPass();
+	m_passFeatures = ShaderVariants::FEATURE_GEOMETRY_PASS;
+	SubmitRenderQueue();
+	m_passFeatures = 0;
+	m_gBuffer.EndGeometryPass();
+	m_passTimer.EndPass(GEOMETRY_PASS);
+
+	if (bBlending == GL_TRUE)
+	{
+		glEnable(GL_BLEND);
+	}
+
+	GLint maxTextureUnits = 0;
+	glGetIntegerv(GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS, &maxTextureUnits);
+	int targetUnits[GBuffer::TARGET_COUNT];
+	for (int target = 0; target < GBuffer::TARGET_COUNT; target++)
+	{
+		targetUnits[target] = maxTextureUnits - (GBUFFER_FIRST_UNIT + target);
+	}
+
+	m_passTimer.BeginPass(LIGHTING_PASS);
+	m_gBuffer.BindTargets(targetUnits);
+
+	// only the lighting features matter to the lighting pass
+	unsigned int lightingFeatures = GetSceneFeatures() &
+		(ShaderVariants::FEATURE_LIGHTING | ShaderVariants::FEATURE_LIGHT_CLUSTERS);
+	if (UseShaderVariant(lightingFeatures | ShaderVariants::FEATURE_LIGHTING_PASS) == true)
+	{
+		// the screen triangle is the only thing drawn, so it is
+		// never hidden by the depth of the target framebuffer
+		glDisable(GL_DEPTH_TEST);
+		m_gBuffer.DrawFullScreenTriangle();
+		glEnable(GL_DEPTH_TEST);
+		m_renderStats.drawCalls++;
+	}
+	m_passTimer.EndPass(LIGHTING_PASS);
 }
\ No newline at end of file
@@ -4,8 +4,21 @@
 
 #pragma once
 
-#include "ShaderManager.h"
-#include "ShapeMeshes.h"
+#include "ShaderVariants.h"
+#include "ShaderUniforms.h"
+#include "FrameUniforms.h"
+#include "MaterialTable.h"
+#include "IndirectDrawBuffer.h"
+#include "ClusteredLights.h"
+#include "GBuffer.h"
+#include "PassTimer.h"
+#include "SceneMeshes.h"
+#include "TextureRegistry.h"
+#include "RenderQueue.h"
+#include "FrustumCuller.h"
+#include "EntityStore.h"
+#include "SceneFile.h"
+#include "SceneGraph.h"
 
 #include <string>
 #include <vector>
@@ -20,15 +33,21 @@ class SceneManager
 {
 public:
 	// constructor
-	SceneManager(ShaderManager* pShaderManager);
+	SceneManager(
+		ShaderVariants* pShaderVariants,
+		FrameUniforms* pFrameUniforms);
 	// destructor
 	~SceneManager();
 
-	// properties for loaded texture access
-	struct TEXTURE_INFO
+	// image data decoded from a texture file
+	struct TEXTURE_IMAGE
 	{
+		std::string filename;
 		std::string tag;
-		uint32_t ID;
+		int width;
+		int height;
+		int colorChannels;
+		unsigned char* pixels;
 	};
 
 	// properties for object materials
@@ -40,53 +59,162 @@ public:
 		std::string tag;
 	};
 
+	// basic shape meshes used by the 3D scene
+	typedef SceneMeshes::ShapeMesh ShapeMesh;
+
+	// passes of the forward and deferred render paths
+	enum RENDER_PASS
+	{
+		FORWARD_PASS = 0,
+		GEOMETRY_PASS,
+		LIGHTING_PASS,
+		RENDER_PASS_COUNT
+	};
+
+	// per-frame rendering statistics
+	struct RENDER_STATS
+	{
+		int drawCalls;
+		int programChanges;
+		// program selections drawn with a fallback program while
+		// the specialized one was still compiling
+		int fallbackPrograms;
+		int textureChanges;
+		int materialChanges;
+		int meshChanges;
+		int visibleObjects;
+		int culledObjects;
+		int transformUpdates;
+		int indirectCommands;
+		int triangles;
+		int pointLights;
+		int lightIndices;
+		// GPU time of each pass in milliseconds, read back a few
+		// frames after the pass was drawn
+		double passTimes[RENDER_PASS_COUNT];
+	};
+
 private:
-	// pointer to shader manager object
-	ShaderManager* m_pShaderManager;
+	// specialized shader programs built for each feature mask
+	ShaderVariants* m_pShaderVariants;
+	// uniform handles of the program in use
+	const ShaderUniforms* m_pShaderUniforms;
+	// variant of the program in use, or -1 at the start of a frame
+	int m_currentVariant;
+	// features of the render pass being drawn
+	unsigned int m_passFeatures;
+	// the scene is lit by its light sources
+	bool m_bUseLighting;
+	// pointer to the per-frame uniform buffer
+	FrameUniforms* m_pFrameUniforms;
 	// pointer to basic shapes object
-	ShapeMeshes* m_basicMeshes;
-	// the number of loaded textures
-	int m_loadedTextures;
-	// loaded textures info
-	TEXTURE_INFO m_textureIDs[16];
+	SceneMeshes* m_basicMeshes;
+	// number of threads used for decoding texture images
+	int m_textureDecodeThreads;
+	// use the scene textures from one texture array
+	bool m_bUseTextureArray;
+	// loaded textures indexed by handle
+	TextureRegistry m_textures;
+	// binary scene description that the scene is built from
+	std::string m_sceneFilename;
+	// the mapped scene description while the scene is prepared
+	SceneFile m_sceneFile;
+	// texture handle of each texture of the scene file
+	std::vector<int> m_sceneTextureHandles;
+	// index of the first material of the scene file
+	int m_sceneMaterialBase;
 	// defined object materials
 	std::vector<OBJECT_MATERIAL> m_objectMaterials;
+	// the defined materials in GPU memory, in the same order
+	MaterialTable m_materialTable;
+	// point lights binned into view clusters every frame
+	ClusteredLights m_pointLights;
+	// total number of point lights, filled up with generated ones
+	int m_pointLightCount;
+	// shade only the point lights of the cluster of each fragment
+	bool m_bLightClusters;
+	// light the visible pixels of a G-buffer instead of every fragment
+	bool m_bDeferredShading;
+	// the programs of the render path not in use have been requested
+	bool m_bOtherPathRequested;
+	// surfaces kept by the geometry pass of deferred shading
+	GBuffer m_gBuffer;
+	// GPU time of the render passes
+	PassTimer m_passTimer;
+	// transform hierarchy of the 3D scene
+	SceneGraph m_sceneGraph;
+	// drawable objects of the 3D scene
+	EntityStore m_entities;
+	// number of extra objects added to stress the renderer
+	int m_stressObjectCount;
+	// draws collected for the current frame
+	RenderQueue m_renderQueue;
+	// submit the whole queue with one indirect multi-draw call
+	bool m_bMultiDrawIndirect;
+	// commands and draw table of the indirect submission
+	IndirectDrawBuffer m_indirectDraws;
+	// view frustum of the current frame
+	FrustumCuller m_frustumCuller;
+	// skip the objects outside of the view frustum
+	bool m_bFrustumCulling;
+	// draw small objects with coarser meshes
+	bool m_bLevelOfDetail;
+	// store the meshes with packed vertices
+	bool m_bPackedVertices;
+	// reorder the triangles of the meshes as they load
+	bool m_bOptimizeIndices;
+	// statistics for the most recently rendered frame
+	RENDER_STATS m_renderStats;
 
 	// methods for managing OpenGL textures
-	bool CreateGLTexture(const char* filename, std::string tag);
-	bool FindMaterial(std::string tag, OBJECT_MATERIAL& material);
+	static bool DecodeTextureImage(TEXTURE_IMAGE& image);
+	bool UploadGLTexture(TEXTURE_IMAGE& image);
+	void CreateGLTextures(std::vector<TEXTURE_IMAGE>& images);
+	void AddTextureImage(
+		std::vector<TEXTURE_IMAGE>& images,
+		const char* filename,
+		std::string tag);
+	int FindMaterialIndex(std::string tag);
+	void BindMaterialTable();
+	void BindDrawTable();
 	void BindGLTextures();
 	void DestroyGLTextures();
-	int FindTextureID(std::string tag);
 	int FindTextureSlot(std::string tag);
 
-	// set the transformation values 
-	// into the transform buffer
-	void SetTransformations(
-		glm::vec3 scaleXYZ,
-		float XrotationDegrees,
-		float YrotationDegrees,
-		float ZrotationDegrees,
-		glm::vec3 positionXYZ);
-
-	// set the color values into the shader
-	void SetShaderColor(
-		float redColorValue,
-		float greenColorValue,
-		float blueColorValue,
-		float alphaValue);
-
 	// set the texture data into the shader
 	void SetShaderTexture(
-		std::string textureTag);
+		int textureHandle);
 
 	// set the object material into the shader
 	void SetShaderMaterial(
-		std::string materialTag);
+		int materialIndex);
+
+	// sort the queued draws and submit them to OpenGL
+	void SubmitRenderQueue();
+	// submit the sorted draws with one indirect multi-draw call
+	void SubmitMultiDrawIndirect();
+	// draw the queue into the G-buffer and then light its pixels
+	void SubmitDeferred();
 
-	// set the texture UV scale into the shader
-	void SetTextureUVScale(
-		float u, float v);
+	// add an object drawn at a scene graph node and get its index
+	int AddSceneObject(
+		ShapeMesh shape,
+		int textureHandle,
+		int materialIndex,
+		int nodeIndex);
+	// add a grid of small objects for measuring large scenes
+	void AddStressObjects(int objectCount);
+	// compact the mesh buffer and print its memory statistics
+	void ReportMeshMemory();
+	// features shared by every draw of the scene and pass
+	unsigned int GetSceneFeatures() const;
+	// make the program of a feature mask current, or its fallback
+	// while it is compiling
+	bool UseShaderVariant(unsigned int features);
+	// start compiling the programs that a render path draws with
+	void RequestShaderVariants(bool bDeferredShading);
+	// set the sampler units and quantization boxes of a new program
+	void SetupShaderProgram();
 
 public:
 
@@ -99,6 +227,45 @@ public:
 	void LoadSceneTextures();
 	// pre-set light sources for 3D scene
 	void SetupSceneLights();
+	// add point lights spread over the table for measuring many lights
+	void AddGeneratedLights(int lightCount);
+	// bin the point lights for the view and bind them for the frame
+	void UpdatePointLights();
 	// pre-define the object materials for lighting
 	void DefineObjectMaterials();
+	// place the objects of the 3D scene
+	void DefineSceneObjects();
+
+	// set the number of threads used for decoding texture images
+	void SetTextureDecodeThreads(int threadCount);
+	// choose between one texture array and separate texture units
+	void SetTextureArrayMode(bool bUseTextureArray);
+
+	// choose whether the queued draws are sorted by state
+	void SetDrawSorting(bool bSortDraws);
+	// choose whether objects outside the view are skipped
+	void SetFrustumCulling(bool bFrustumCulling);
+	// choose whether the scene is drawn with one indirect multi-draw
+	void SetMultiDrawIndirect(bool bMultiDrawIndirect);
+	// choose whether small objects are drawn with coarser meshes
+	void SetLevelOfDetail(bool bLevelOfDetail);
+	// choose whether the meshes are stored with packed vertices
+	void SetPackedVertices(bool bPackedVertices);
+	// set the total number of point lights in the scene
+	void SetPointLightCount(int lightCount);
+	// choose whether the point lights are binned into clusters
+	void SetLightClusters(bool bLightClusters);
+	// choose between the forward and the deferred render path
+	void SetDeferredShading(bool bDeferredShading);
+	// the deferred render path is in use
+	bool IsDeferredShading() const;
+	// choose whether the mesh triangles are reordered as they load
+	void SetIndexOptimization(bool bOptimizeIndices);
+	// set the number of extra objects added by PrepareScene()
+	void SetStressObjectCount(int objectCount);
+	// set the binary scene file that PrepareScene() loads
+	void SetSceneFile(const char* filename);
+
+	// get the statistics for the most recently rendered frame
+	const RENDER_STATS& GetRenderStats() const;
 };
\ No newline at end of file
@@ -0,0 +1,1053 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenemeshes.cpp
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SceneMeshes.h"
+#include "MeshOptimizer.h"
+
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+// the packed vertex keeps every attribute four byte aligned
+static_assert(sizeof(SceneMeshes::PACKED_VERTEX) == 16,
+	"packed vertex must match the packed attribute layout");
+
+// declaration of global variables and functions
+namespace
+{
+	// vertex attribute locations used by the vertex shader
+	const GLuint POSITION_LOCATION = 0;
+	const GLuint NORMAL_LOCATION = 1;
+	const GLuint TEXCOORD_LOCATION = 2;
+	// the instance model matrix uses four consecutive locations
+	const GLuint INSTANCE_MODEL_LOCATION = 3;
+
+	// number of model matrices the instance buffer starts with
+	const int INITIAL_INSTANCE_CAPACITY = 64;
+	// bytes the shared mesh buffer starts with, enough for the
+	// basic shapes without growing
+	const GLsizeiptr INITIAL_ARENA_CAPACITY = 256 * 1024;
+
+	// tessellation of the generated shapes
+	const int CYLINDER_SLICES = 36;
+	const int SPHERE_STACKS = 18;
+	const int SPHERE_SLICES = 36;
+	const int TORUS_MAIN_SEGMENTS = 36;
+	const int TORUS_TUBE_SEGMENTS = 18;
+	// fewest segments around any shape at the coarsest level
+	const int MIN_LOD_SEGMENTS = 6;
+	const int MIN_LOD_STACKS = 4;
+
+	// dimensions of the generated shapes
+	const float TAPERED_TOP_RADIUS = 0.5f;
+	const float TORUS_MAIN_RADIUS = 1.0f;
+	const float TORUS_TUBE_RADIUS = 0.1f;
+
+	const float PI = 3.14159265358979f;
+
+	// smallest half size of a quantization box, so flat shapes do
+	// not divide by zero
+	const float MIN_QUANTIZATION_SCALE = 1.0e-6f;
+
+	/***********************************************************
+	 *  AddVertex()
+	 *
+	 *  Append a vertex and return its index.
+	 ***********************************************************/
+	GLuint AddVertex(
+		std::vector<SceneMeshes::MESH_VERTEX>& vertices,
+		glm::vec3 position,
+		glm::vec3 normal,
+		glm::vec2 textureCoordinate)
+	{
+		SceneMeshes::MESH_VERTEX vertex;
+		vertex.position = position;
+		vertex.normal = normal;
+		vertex.textureCoordinate = textureCoordinate;
+		vertices.push_back(vertex);
+
+		return (GLuint)(vertices.size() - 1);
+	}
+
+	/***********************************************************
+	 *  AddTriangle()
+	 *
+	 *  Append a triangle, swapping the winding when needed so
+	 *  that the front face always points along the vertex
+	 *  normals.  This keeps every generated shape consistently
+	 *  counter-clockwise for back face culling.
+	 ***********************************************************/
+	void AddTriangle(
+		const std::vector<SceneMeshes::MESH_VERTEX>& vertices,
+		std::vector<GLuint>& indices,
+		GLuint a, GLuint b, GLuint c)
+	{
+		glm::vec3 faceNormal = glm::cross(
+			vertices[b].position - vertices[a].position,
+			vertices[c].position - vertices[a].position);
+		glm::vec3 vertexNormal = vertices[a].normal + vertices[b].normal + vertices[c].normal;
+
+		indices.push_back(a);
+		if (glm::dot(faceNormal, vertexNormal) < 0.0f)
+		{
+			indices.push_back(c);
+			indices.push_back(b);
+		}
+		else
+		{
+			indices.push_back(b);
+			indices.push_back(c);
+		}
+	}
+
+	/***********************************************************
+	 *  LodSegments()
+	 *
+	 *  Get the number of segments of a detail level, halving the
+	 *  full count for every level but never going below the
+	 *  passed in minimum.
+	 ***********************************************************/
+	int LodSegments(int fullSegments, int lod, int minimumSegments)
+	{
+		return (std::max(fullSegments >> lod, minimumSegments));
+	}
+
+	/***********************************************************
+	 *  OctahedralEncode()
+	 *
+	 *  Map a unit normal onto the octahedron and unfold it into
+	 *  the [-1, 1] square, folding the lower half over the
+	 *  diagonals.  The vertex shader reverses the mapping.
+	 ***********************************************************/
+	glm::vec2 OctahedralEncode(glm::vec3 normal)
+	{
+		float sum = std::fabs(normal.x) + std::fabs(normal.y) + std::fabs(normal.z);
+		if (sum <= 0.0f)
+		{
+			return (glm::vec2(0.0f));
+		}
+
+		glm::vec2 encoded = glm::vec2(normal.x / sum, normal.y / sum);
+		if (normal.z < 0.0f)
+		{
+			float signX = (encoded.x >= 0.0f) ? 1.0f : -1.0f;
+			float signY = (encoded.y >= 0.0f) ? 1.0f : -1.0f;
+			encoded = glm::vec2(
+				(1.0f - std::fabs(encoded.y)) * signX,
+				(1.0f - std::fabs(encoded.x)) * signY);
+		}
+
+		return (encoded);
+	}
+
+	/***********************************************************
+	 *  PackVertex()
+	 *
+	 *  Convert a vertex to the packed layout, normalizing the
+	 *  position to the passed in quantization box.
+	 ***********************************************************/
+	SceneMeshes::PACKED_VERTEX PackVertex(
+		const SceneMeshes::MESH_VERTEX& vertex,
+		glm::vec3 center,
+		glm::vec3 scale)
+	{
+		SceneMeshes::PACKED_VERTEX packed;
+
+		glm::vec3 position = (vertex.position - center) / scale;
+		for (int i = 0; i < 3; i++)
+		{
+			packed.position[i] = (GLshort)glm::packSnorm1x16(position[i]);
+		}
+		packed.position[3] = 0;
+
+		glm::vec2 normal = OctahedralEncode(vertex.normal);
+		packed.normal[0] = (GLshort)glm::packSnorm1x16(normal.x);
+		packed.normal[1] = (GLshort)glm::packSnorm1x16(normal.y);
+
+		packed.textureCoordinate[0] = glm::packHalf1x16(vertex.textureCoordinate.x);
+		packed.textureCoordinate[1] = glm::packHalf1x16(vertex.textureCoordinate.y);
+
+		return (packed);
+	}
+
+	/***********************************************************
+	 *  BuildPlane()
+	 *
+	 *  Flat square from -1 to 1 on the X and Z axes facing up.
+	 ***********************************************************/
+	void BuildPlane(
+		std::vector<SceneMeshes::MESH_VERTEX>& vertices,
+		std::vector<GLuint>& indices)
+	{
+		glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f);
+
+		GLuint v0 = AddVertex(vertices, glm::vec3(-1.0f, 0.0f, 1.0f), up, glm::vec2(0.0f, 0.0f));
+		GLuint v1 = AddVertex(vertices, glm::vec3(1.0f, 0.0f, 1.0f), up, glm::vec2(1.0f, 0.0f));
+		GLuint v2 = AddVertex(vertices, glm::vec3(1.0f, 0.0f, -1.0f), up, glm::vec2(1.0f, 1.0f));
+		GLuint v3 = AddVertex(vertices, glm::vec3(-1.0f, 0.0f, -1.0f), up, glm::vec2(0.0f, 1.0f));
+
+		AddTriangle(vertices, indices, v0, v1, v2);
+		AddTriangle(vertices, indices, v0, v2, v3);
+	}
+
+	/***********************************************************
+	 *  BuildCylinder()
+	 *
+	 *  Closed cylinder standing on the XZ plane from a height of
+	 *  0 to 1.  A smaller top radius makes a tapered cylinder.
+	 ***********************************************************/
+	void BuildCylinder(
+		std::vector<SceneMeshes::MESH_VERTEX>& vertices,
+		std::vector<GLuint>& indices,
+		float bottomRadius,
+		float topRadius,
+		int slices)
+	{
+		// sides - the seam vertices are duplicated for the texture wrap
+		GLuint sideStart = (GLuint)vertices.size();
+		for (int i = 0; i <= slices; i++)
+		{
+			float u = (float)i / (float)slices;
+			float angle = u * 2.0f * PI;
+			float x = std::cos(angle);
+			float z = std::sin(angle);
+			glm::vec3 normal = glm::normalize(glm::vec3(x, bottomRadius - topRadius, z));
+
+			AddVertex(vertices, glm::vec3(x * bottomRadius, 0.0f, z * bottomRadius), normal, glm::vec2(u, 0.0f));
+			AddVertex(vertices, glm::vec3(x * topRadius, 1.0f, z * topRadius), normal, glm::vec2(u, 1.0f));
+		}
+		for (int i = 0; i < slices; i++)
+		{
+			GLuint bottom0 = sideStart + (i * 2);
+			GLuint top0 = bottom0 + 1;
+			GLuint bottom1 = bottom0 + 2;
+			GLuint top1 = bottom0 + 3;
+
+			AddTriangle(vertices, indices, bottom0, top0, bottom1);
+			AddTriangle(vertices, indices, bottom1, top0, top1);
+		}
+
+		// bottom and top caps
+		for (int cap = 0; cap < 2; cap++)
+		{
+			float y = (float)cap;
+			float radius = (cap == 0) ? bottomRadius : topRadius;
+			glm::vec3 normal = glm::vec3(0.0f, (cap == 0) ? -1.0f : 1.0f, 0.0f);
+
+			GLuint center = AddVertex(vertices, glm::vec3(0.0f, y, 0.0f), normal, glm::vec2(0.5f, 0.5f));
+			GLuint ringStart = (GLuint)vertices.size();
+			for (int i = 0; i <= slices; i++)
+			{
+				float angle = ((float)i / (float)slices) * 2.0f * PI;
+				float x = std::cos(angle);
+				float z = std::sin(angle);
+
+				AddVertex(vertices,
+					glm::vec3(x * radius, y, z * radius),
+					normal,
+					glm::vec2(0.5f + (x * 0.5f), 0.5f + (z * 0.5f)));
+			}
+			for (int i = 0; i < slices; i++)
+			{
+				AddTriangle(vertices, indices, center, ringStart + i, ringStart + i + 1);
+			}
+		}
+	}
+
+	/***********************************************************
+	 *  BuildSphere()
+	 *
+	 *  Sphere with a radius of 1 centered on the origin.
+	 ***********************************************************/
+	void BuildSphere(
+		std::vector<SceneMeshes::MESH_VERTEX>& vertices,
+		std::vector<GLuint>& indices,
+		int stacks,
+		int slices)
+	{
+		GLuint start = (GLuint)vertices.size();
+		for (int stack = 0; stack <= stacks; stack++)
+		{
+			float v = (float)stack / (float)stacks;
+			float phi = v * PI;
+
+			for (int slice = 0; slice <= slices; slice++)
+			{
+				float u = (float)slice / (float)slices;
+				float theta = u * 2.0f * PI;
+
+				glm::vec3 position = glm::vec3(
+					std::sin(phi) * std::cos(theta),
+					std::cos(phi),
+					std::sin(phi) * std::sin(theta));
+
+				AddVertex(vertices, position, position, glm::vec2(u, 1.0f - v));
+			}
+		}
+
+		GLuint rowLength = (GLuint)slices + 1;
+		for (int stack = 0; stack < stacks; stack++)
+		{
+			for (int slice = 0; slice < slices; slice++)
+			{
+				GLuint upper0 = start + (stack * rowLength) + slice;
+				GLuint lower0 = upper0 + rowLength;
+
+				// the triangles that collapse at the poles are skipped
+				if (stack != 0)
+				{
+					AddTriangle(vertices, indices, upper0, upper0 + 1, lower0);
+				}
+				if (stack != stacks - 1)
+				{
+					AddTriangle(vertices, indices, upper0 + 1, lower0 + 1, lower0);
+				}
+			}
+		}
+	}
+
+	/***********************************************************
+	 *  BuildTorus()
+	 *
+	 *  Ring around the Z axis, lying in the XY plane.
+	 ***********************************************************/
+	void BuildTorus(
+		std::vector<SceneMeshes::MESH_VERTEX>& vertices,
+		std::vector<GLuint>& indices,
+		float mainRadius,
+		float tubeRadius,
+		int mainSegments,
+		int tubeSegments)
+	{
+		GLuint start = (GLuint)vertices.size();
+		for (int i = 0; i <= mainSegments; i++)
+		{
+			float u = (float)i / (float)mainSegments;
+			float mainAngle = u * 2.0f * PI;
+			glm::vec3 ringDirection = glm::vec3(std::cos(mainAngle), std::sin(mainAngle), 0.0f);
+
+			for (int j = 0; j <= tubeSegments; j++)
+			{
+				float v = (float)j / (float)tubeSegments;
+				float tubeAngle = v * 2.0f * PI;
+
+				glm::vec3 normal = (ringDirection * std::cos(tubeAngle)) +
+					glm::vec3(0.0f, 0.0f, std::sin(tubeAngle));
+
+				AddVertex(vertices,
+					(ringDirection * mainRadius) + (normal * tubeRadius),
+					normal,
+					glm::vec2(u, v));
+			}
+		}
+
+		GLuint rowLength = (GLuint)tubeSegments + 1;
+		for (int i = 0; i < mainSegments; i++)
+		{
+			for (int j = 0; j < tubeSegments; j++)
+			{
+				GLuint a = start + (i * rowLength) + j;
+				GLuint b = a + rowLength;
+
+				AddTriangle(vertices, indices, a, b, a + 1);
+				AddTriangle(vertices, indices, a + 1, b, b + 1);
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  SceneMeshes()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+SceneMeshes::SceneMeshes()
+{
+	for (int i = 0; i < (int)ShapeMesh::Count; i++)
+	{
+		for (int lod = 0; lod < MAX_LOD_COUNT; lod++)
+		{
+			m_meshes[i][lod].vertexHandle = BufferArena::INVALID_HANDLE;
+			m_meshes[i][lod].indexHandle = BufferArena::INVALID_HANDLE;
+			m_meshes[i][lod].nIndices = 0;
+			m_meshes[i][lod].generatedMisses = 0;
+			m_meshes[i][lod].uploadedMisses = 0;
+		}
+		m_lodCounts[i] = 0;
+
+		m_bounds[i].minimum = glm::vec3(0.0f);
+		m_bounds[i].maximum = glm::vec3(0.0f);
+		m_bounds[i].center = glm::vec3(0.0f);
+		m_bounds[i].radius = 0.0f;
+	}
+
+	m_instanceCapacity = INITIAL_INSTANCE_CAPACITY;
+	m_bPackedVertices = false;
+	m_bOptimizeIndices = true;
+	m_arena.Create(INITIAL_ARENA_CAPACITY);
+	glGenBuffers(1, &m_instanceVBO);
+
+	// one vertex array describes the shared buffer, so the
+	// layout is set up once for every mesh.  The vertices and
+	// indices are both read from it, and the base vertex and
+	// first index of each draw select the mesh
+	glGenVertexArrays(1, &m_vao);
+	SetupVertexLayout();
+
+	// per-instance model matrix, one column per attribute location
+	glBindVertexArray(m_vao);
+	glBindBuffer(GL_ARRAY_BUFFER, m_instanceVBO);
+	glBufferData(GL_ARRAY_BUFFER, m_instanceCapacity * sizeof(glm::mat4), NULL, GL_STREAM_DRAW);
+	for (GLuint column = 0; column < 4; column++)
+	{
+		GLuint location = INSTANCE_MODEL_LOCATION + column;
+		glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(sizeof(glm::vec4) * column));
+		glEnableVertexAttribArray(location);
+		glVertexAttribDivisor(location, 1);
+	}
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+/***********************************************************
+ *  ~SceneMeshes()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+SceneMeshes::~SceneMeshes()
+{
+	if (m_vao != 0)
+	{
+		glDeleteVertexArrays(1, &m_vao);
+		m_vao = 0;
+	}
+	m_arena.Destroy();
+	if (m_instanceVBO != 0)
+	{
+		glDeleteBuffers(1, &m_instanceVBO);
+		m_instanceVBO = 0;
+	}
+}
+
+/***********************************************************
+ *  SetupVertexLayout()
+ *
+ *  This method is used for pointing the per-vertex attributes
+ *  of the shared vertex array at the shared buffer, in either
+ *  the float or the packed vertex layout.  Packed positions
+ *  and normals are normalized shorts and the texture
+ *  coordinates are half floats, which the vertex fetch turns
+ *  back into floats before the shader decodes them.
+ ***********************************************************/
+void SceneMeshes::SetupVertexLayout()
+{
+	glBindVertexArray(m_vao);
+	glBindBuffer(GL_ARRAY_BUFFER, m_arena.GetBufferID());
+
+	if (m_bPackedVertices == true)
+	{
+		GLsizei stride = sizeof(PACKED_VERTEX);
+		glVertexAttribPointer(POSITION_LOCATION, 3, GL_SHORT, GL_TRUE, stride, (void*)offsetof(PACKED_VERTEX, position));
+		glVertexAttribPointer(NORMAL_LOCATION, 2, GL_SHORT, GL_TRUE, stride, (void*)offsetof(PACKED_VERTEX, normal));
+		glVertexAttribPointer(TEXCOORD_LOCATION, 2, GL_HALF_FLOAT, GL_FALSE, stride, (void*)offsetof(PACKED_VERTEX, textureCoordinate));
+	}
+	else
+	{
+		GLsizei stride = sizeof(MESH_VERTEX);
+		glVertexAttribPointer(POSITION_LOCATION, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(MESH_VERTEX, position));
+		glVertexAttribPointer(NORMAL_LOCATION, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(MESH_VERTEX, normal));
+		glVertexAttribPointer(TEXCOORD_LOCATION, 2, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(MESH_VERTEX, textureCoordinate));
+	}
+	glEnableVertexAttribArray(POSITION_LOCATION);
+	glEnableVertexAttribArray(NORMAL_LOCATION);
+	glEnableVertexAttribArray(TEXCOORD_LOCATION);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_arena.GetBufferID());
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+/***********************************************************
+ *  SetPackedVertices()
+ *
+ *  This method is used for choosing whether the vertices are
+ *  stored in the packed layout.  Every mesh has to use the
+ *  same layout, so the choice is refused once a mesh has been
+ *  loaded.
+ ***********************************************************/
+bool SceneMeshes::SetPackedVertices(bool bPackedVertices)
+{
+	for (int i = 0; i < (int)ShapeMesh::Count; i++)
+	{
+		if (m_lodCounts[i] > 0)
+		{
+			return(false);
+		}
+	}
+
+	m_bPackedVertices = bPackedVertices;
+	SetupVertexLayout();
+
+	return(true);
+}
+
+/***********************************************************
+ *  SetIndexOptimization()
+ *
+ *  This method is used for choosing whether the triangles of
+ *  the meshes loaded afterwards are reordered for the vertex
+ *  cache and for overdraw, which is the default.
+ ***********************************************************/
+void SceneMeshes::SetIndexOptimization(bool bOptimizeIndices)
+{
+	m_bOptimizeIndices = bOptimizeIndices;
+}
+
+/***********************************************************
+ *  IsPackedVertices()
+ *
+ *  This method is used for checking whether the vertices are
+ *  stored in the packed layout.
+ ***********************************************************/
+bool SceneMeshes::IsPackedVertices() const
+{
+	return(m_bPackedVertices);
+}
+
+/***********************************************************
+ *  GetVertexSize()
+ *
+ *  This method is used for getting the number of bytes that
+ *  one vertex takes in the shared buffer.
+ ***********************************************************/
+GLsizei SceneMeshes::GetVertexSize() const
+{
+	if (m_bPackedVertices == true)
+	{
+		return((GLsizei)sizeof(PACKED_VERTEX));
+	}
+	return((GLsizei)sizeof(MESH_VERTEX));
+}
+
+/***********************************************************
+ *  GetQuantizationScale()
+ *
+ *  This method is used for getting the half size of the box
+ *  that the packed positions of a mesh are normalized to.
+ *  The box is the bounds of all detail levels together, since
+ *  a coarse level can reach outside a finer one, as the torus
+ *  does where its fine tube rings miss the outermost point.
+ ***********************************************************/
+glm::vec3 SceneMeshes::GetQuantizationScale(ShapeMesh shape) const
+{
+	const MESH_BOUNDS& bounds = m_bounds[(int)shape];
+
+	return(glm::max(
+		(bounds.maximum - bounds.minimum) * 0.5f,
+		glm::vec3(MIN_QUANTIZATION_SCALE)));
+}
+
+/***********************************************************
+ *  LoadCylinderMesh()
+ *
+ *  This method is used for generating the cylinder mesh.
+ ***********************************************************/
+void SceneMeshes::LoadCylinderMesh()
+{
+	std::vector<MESH_LEVEL> levels(MAX_LOD_COUNT);
+	for (int lod = 0; lod < MAX_LOD_COUNT; lod++)
+	{
+		BuildCylinder(levels[lod].vertices, levels[lod].indices,
+			1.0f, 1.0f, LodSegments(CYLINDER_SLICES, lod, MIN_LOD_SEGMENTS));
+	}
+	UploadMeshLevels(ShapeMesh::Cylinder, levels);
+}
+
+/***********************************************************
+ *  LoadPlaneMesh()
+ *
+ *  This method is used for generating the plane mesh.
+ ***********************************************************/
+void SceneMeshes::LoadPlaneMesh()
+{
+	// the plane is two triangles, so it has a single level
+	std::vector<MESH_LEVEL> levels(1);
+	BuildPlane(levels[0].vertices, levels[0].indices);
+	UploadMeshLevels(ShapeMesh::Plane, levels);
+}
+
+/***********************************************************
+ *  LoadSphereMesh()
+ *
+ *  This method is used for generating the sphere mesh.
+ ***********************************************************/
+void SceneMeshes::LoadSphereMesh()
+{
+	std::vector<MESH_LEVEL> levels(MAX_LOD_COUNT);
+	for (int lod = 0; lod < MAX_LOD_COUNT; lod++)
+	{
+		BuildSphere(levels[lod].vertices, levels[lod].indices,
+			LodSegments(SPHERE_STACKS, lod, MIN_LOD_STACKS),
+			LodSegments(SPHERE_SLICES, lod, MIN_LOD_SEGMENTS));
+	}
+	UploadMeshLevels(ShapeMesh::Sphere, levels);
+}
+
+/***********************************************************
+ *  LoadTaperedCylinderMesh()
+ *
+ *  This method is used for generating the tapered cylinder
+ *  mesh, which has a top half as wide as the bottom.
+ ***********************************************************/
+void SceneMeshes::LoadTaperedCylinderMesh()
+{
+	std::vector<MESH_LEVEL> levels(MAX_LOD_COUNT);
+	for (int lod = 0; lod < MAX_LOD_COUNT; lod++)
+	{
+		BuildCylinder(levels[lod].vertices, levels[lod].indices, 1.0f, TAPERED_TOP_RADIUS,
+			LodSegments(CYLINDER_SLICES, lod, MIN_LOD_SEGMENTS));
+	}
+	UploadMeshLevels(ShapeMesh::TaperedCylinder, levels);
+}
+
+/***********************************************************
+ *  LoadTorusMesh()
+ *
+ *  This method is used for generating the torus mesh.
+ ***********************************************************/
+void SceneMeshes::LoadTorusMesh()
+{
+	std::vector<MESH_LEVEL> levels(MAX_LOD_COUNT);
+	for (int lod = 0; lod < MAX_LOD_COUNT; lod++)
+	{
+		BuildTorus(levels[lod].vertices, levels[lod].indices,
+			TORUS_MAIN_RADIUS, TORUS_TUBE_RADIUS,
+			LodSegments(TORUS_MAIN_SEGMENTS, lod, MIN_LOD_SEGMENTS),
+			LodSegments(TORUS_TUBE_SEGMENTS, lod, MIN_LOD_STACKS));
+	}
+	UploadMeshLevels(ShapeMesh::Torus, levels);
+}
+
+/***********************************************************
+ *  DrawMesh()
+ *
+ *  This method is used for drawing one copy of the mesh.  The
+ *  model matrix is taken from the model shader uniform.
+ ***********************************************************/
+void SceneMeshes::DrawMesh(ShapeMesh shape) const
+{
+	BindMeshes();
+	DrawBoundMesh(shape);
+	UnbindMeshes();
+}
+
+/***********************************************************
+ *  DrawMeshInstanced()
+ *
+ *  This method is used for drawing one copy of the mesh for
+ *  every passed in model matrix with a single draw call.  The
+ *  shader has to be switched to instanced mode so that it
+ *  reads the per-instance model matrix attribute.
+ ***********************************************************/
+void SceneMeshes::DrawMeshInstanced(
+	ShapeMesh shape,
+	const glm::mat4* modelMatrices,
+	int instanceCount)
+{
+	BindMeshes();
+	DrawBoundMeshInstanced(shape, modelMatrices, instanceCount);
+	UnbindMeshes();
+}
+
+/***********************************************************
+ *  BindMeshes()
+ *
+ *  This method is used for binding the vertex array shared by
+ *  all of the meshes, so that a series of draws of any meshes
+ *  does not need to bind vertex state again.
+ ***********************************************************/
+void SceneMeshes::BindMeshes() const
+{
+	glBindVertexArray(m_vao);
+}
+
+/***********************************************************
+ *  UnbindMeshes()
+ *
+ *  This method is used for releasing the vertex array binding
+ *  after a series of draws.
+ ***********************************************************/
+void SceneMeshes::UnbindMeshes() const
+{
+	glBindVertexArray(0);
+}
+
+/***********************************************************
+ *  DrawBoundMesh()
+ *
+ *  This method is used for drawing one copy of a detail level
+ *  of the mesh after the shared vertex array has been bound
+ *  with BindMeshes().
+ ***********************************************************/
+void SceneMeshes::DrawBoundMesh(ShapeMesh shape, int lod) const
+{
+	MESH_RANGE mesh = GetMeshRange(shape, lod);
+	if (mesh.nIndices == 0)
+	{
+		return;
+	}
+
+	glDrawElementsBaseVertex(
+		GL_TRIANGLES,
+		mesh.nIndices,
+		GL_UNSIGNED_INT,
+		(void*)(mesh.firstIndex * sizeof(GLuint)),
+		mesh.baseVertex);
+}
+
+/***********************************************************
+ *  DrawBoundMeshInstanced()
+ *
+ *  This method is used for drawing copies of a detail level of
+ *  the mesh after the shared vertex array has been bound with
+ *  BindMeshes().  The model matrices are streamed into the
+ *  shared instance buffer, which does not disturb the bound
+ *  vertex array.
+ ***********************************************************/
+void SceneMeshes::DrawBoundMeshInstanced(
+	ShapeMesh shape,
+	const glm::mat4* modelMatrices,
+	int instanceCount,
+	int lod)
+{
+	MESH_RANGE mesh = GetMeshRange(shape, lod);
+	if ((mesh.nIndices == 0) || (instanceCount <= 0))
+	{
+		return;
+	}
+
+	UploadInstanceMatrices(modelMatrices, instanceCount);
+
+	glDrawElementsInstancedBaseVertex(
+		GL_TRIANGLES,
+		mesh.nIndices,
+		GL_UNSIGNED_INT,
+		(void*)(mesh.firstIndex * sizeof(GLuint)),
+		instanceCount,
+		mesh.baseVertex);
+}
+
+/***********************************************************
+ *  UploadInstanceMatrices()
+ *
+ *  This method is used for streaming model matrices into the
+ *  per-instance buffer.  An instanced draw reads them from the
+ *  start of the buffer, and an indirect draw from the base
+ *  instance of each command.
+ ***********************************************************/
+void SceneMeshes::UploadInstanceMatrices(
+	const glm::mat4* modelMatrices,
+	int matrixCount)
+{
+	if (matrixCount <= 0)
+	{
+		return;
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, m_instanceVBO);
+	if (matrixCount > m_instanceCapacity)
+	{
+		m_instanceCapacity = matrixCount * 2;
+	}
+	// orphan the previous contents so the upload never waits on
+	// a draw that is still reading the buffer
+	glBufferData(GL_ARRAY_BUFFER, m_instanceCapacity * sizeof(glm::mat4), NULL, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, matrixCount * sizeof(glm::mat4), modelMatrices);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+/***********************************************************
+ *  DrawBoundMeshesIndirect()
+ *
+ *  This method is used for drawing consecutive commands of
+ *  the bound GL_DRAW_INDIRECT_BUFFER with one call, after the
+ *  shared vertex array has been bound with BindMeshes().  Each
+ *  command selects a mesh range and its first model matrix,
+ *  and gl_DrawID counts from the first command drawn.
+ ***********************************************************/
+void SceneMeshes::DrawBoundMeshesIndirect(GLintptr commandOffset, int drawCount) const
+{
+	if (drawCount <= 0)
+	{
+		return;
+	}
+
+	glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)commandOffset, drawCount, 0);
+}
+
+/***********************************************************
+ *  UploadMeshLevels()
+ *
+ *  This method is used for setting the bounds of a shape from
+ *  the vertices of all of its detail levels and then copying
+ *  every level into the shared buffer.  The bounds have to
+ *  be known before the first level is copied, since packed
+ *  vertices of every level are quantized to them.
+ ***********************************************************/
+void SceneMeshes::UploadMeshLevels(ShapeMesh shape, const std::vector<MESH_LEVEL>& levels)
+{
+	m_bounds[(int)shape] = ComputeBounds(levels);
+
+	for (size_t lod = 0; lod < levels.size(); lod++)
+	{
+		UploadMesh(shape, (int)lod, levels[lod].vertices, levels[lod].indices);
+	}
+}
+
+/***********************************************************
+ *  UploadMesh()
+ *
+ *  This method is used for allocating the vertices and indices
+ *  of a mesh in the shared buffer and copying them in.  The
+ *  indices stay relative to the mesh, and the vertices are
+ *  aligned to a whole vertex so the base vertex of a draw can
+ *  offset them.  A mesh that is loaded again frees its old
+ *  allocations first.  Packed vertices are quantized to the
+ *  bounds that UploadMeshLevels() set for the shape.  The
+ *  triangles are reordered first, unless index optimization
+ *  is turned off.
+ ***********************************************************/
+void SceneMeshes::UploadMesh(
+	ShapeMesh shape,
+	int lod,
+	const std::vector<MESH_VERTEX>& vertices,
+	const std::vector<GLuint>& indices)
+{
+	MESH_ALLOCATION& mesh = m_meshes[(int)shape][lod];
+	m_arena.Free(mesh.vertexHandle);
+	m_arena.Free(mesh.indexHandle);
+
+	m_lodCounts[(int)shape] = std::max(m_lodCounts[(int)shape], lod + 1);
+
+	std::vector<GLuint> ordered(indices);
+	mesh.generatedMisses = MeshOptimizer::CountCacheMisses(
+		ordered, vertices.size(), MeshOptimizer::DEFAULT_CACHE_SIZE);
+	if ((m_bOptimizeIndices == true) && (vertices.empty() == false))
+	{
+		MeshOptimizer::OptimizeVertexCache(ordered, vertices.size());
+		MeshOptimizer::OptimizeOverdraw(
+			ordered,
+			&vertices[0].position,
+			sizeof(MESH_VERTEX),
+			vertices.size(),
+			MeshOptimizer::DEFAULT_OVERDRAW_THRESHOLD);
+	}
+	mesh.uploadedMisses = MeshOptimizer::CountCacheMisses(
+		ordered, vertices.size(), MeshOptimizer::DEFAULT_CACHE_SIZE);
+
+	std::vector<PACKED_VERTEX> packedVertices;
+	const void* pVertexData = vertices.data();
+	if (m_bPackedVertices == true)
+	{
+		glm::vec3 center = m_bounds[(int)shape].center;
+		glm::vec3 scale = GetQuantizationScale(shape);
+
+		packedVertices.reserve(vertices.size());
+		for (size_t i = 0; i < vertices.size(); i++)
+		{
+			packedVertices.push_back(PackVertex(vertices[i], center, scale));
+		}
+		pVertexData = packedVertices.data();
+	}
+
+	GLsizei vertexSize = GetVertexSize();
+	GLsizeiptr vertexBytes = vertices.size() * vertexSize;
+	GLsizeiptr indexBytes = ordered.size() * sizeof(GLuint);
+	mesh.vertexHandle = m_arena.Allocate(vertexBytes, vertexSize);
+	mesh.indexHandle = m_arena.Allocate(indexBytes, sizeof(GLuint));
+	mesh.nIndices = (GLsizei)ordered.size();
+
+	if ((mesh.vertexHandle == BufferArena::INVALID_HANDLE) ||
+		(mesh.indexHandle == BufferArena::INVALID_HANDLE))
+	{
+		m_arena.Free(mesh.vertexHandle);
+		m_arena.Free(mesh.indexHandle);
+		mesh.vertexHandle = BufferArena::INVALID_HANDLE;
+		mesh.indexHandle = BufferArena::INVALID_HANDLE;
+		mesh.nIndices = 0;
+		mesh.generatedMisses = 0;
+		mesh.uploadedMisses = 0;
+		return;
+	}
+
+	m_arena.Write(mesh.vertexHandle, pVertexData, vertexBytes);
+	m_arena.Write(mesh.indexHandle, ordered.data(), indexBytes);
+}
+
+/***********************************************************
+ *  ComputeBounds()
+ *
+ *  This method is used for computing the axis-aligned box
+ *  around the vertices of all detail levels and the bounding
+ *  sphere centered on the box that contains every vertex, so
+ *  the bounds hold whichever level is drawn.
+ ***********************************************************/
+SceneMeshes::MESH_BOUNDS SceneMeshes::ComputeBounds(
+	const std::vector<MESH_LEVEL>& levels)
+{
+	MESH_BOUNDS bounds;
+	bounds.minimum = glm::vec3(0.0f);
+	bounds.maximum = glm::vec3(0.0f);
+	bounds.center = glm::vec3(0.0f);
+	bounds.radius = 0.0f;
+
+	bool bEmpty = true;
+	for (size_t lod = 0; lod < levels.size(); lod++)
+	{
+		const std::vector<MESH_VERTEX>& vertices = levels[lod].vertices;
+		for (size_t i = 0; i < vertices.size(); i++)
+		{
+			const glm::vec3& position = vertices[i].position;
+			if (bEmpty == true)
+			{
+				bounds.minimum = position;
+				bounds.maximum = position;
+				bEmpty = false;
+			}
+			bounds.minimum = glm::min(bounds.minimum, position);
+			bounds.maximum = glm::max(bounds.maximum, position);
+		}
+	}
+	if (bEmpty == true)
+	{
+		return(bounds);
+	}
+
+	bounds.center = (bounds.minimum + bounds.maximum) * 0.5f;
+	float radiusSquared = 0.0f;
+	for (size_t lod = 0; lod < levels.size(); lod++)
+	{
+		const std::vector<MESH_VERTEX>& vertices = levels[lod].vertices;
+		for (size_t i = 0; i < vertices.size(); i++)
+		{
+			glm::vec3 offset = vertices[i].position - bounds.center;
+			radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+		}
+	}
+	bounds.radius = std::sqrt(radiusSquared);
+
+	return(bounds);
+}
+
+/***********************************************************
+ *  GetMeshBounds()
+ *
+ *  This method is used for getting the local-space bounds of
+ *  one of the loaded meshes.
+ ***********************************************************/
+const SceneMeshes::MESH_BOUNDS& SceneMeshes::GetMeshBounds(ShapeMesh shape) const
+{
+	return(m_bounds[(int)shape]);
+}
+
+/***********************************************************
+ *  GetMeshRange()
+ *
+ *  This method is used for getting the location of a detail
+ *  level of one of the loaded meshes in the shared buffer, in
+ *  vertices and indices as the draw calls take it.  A level
+ *  that was not loaded falls back to the coarsest one.  The
+ *  location changes when the buffer is defragmented.
+ ***********************************************************/
+SceneMeshes::MESH_RANGE SceneMeshes::GetMeshRange(ShapeMesh shape, int lod) const
+{
+	lod = std::max(0, std::min(lod, m_lodCounts[(int)shape] - 1));
+	const MESH_ALLOCATION& mesh = m_meshes[(int)shape][lod];
+
+	MESH_RANGE range;
+	range.firstIndex = (GLuint)(m_arena.GetOffset(mesh.indexHandle) / sizeof(GLuint));
+	range.baseVertex = (GLint)(m_arena.GetOffset(mesh.vertexHandle) / GetVertexSize());
+	range.nIndices = mesh.nIndices;
+	range.shape = (GLint)shape;
+
+	return(range);
+}
+
+/***********************************************************
+ *  GetLodCount()
+ *
+ *  This method is used for getting the number of detail
+ *  levels loaded for one of the meshes.
+ ***********************************************************/
+int SceneMeshes::GetLodCount(ShapeMesh shape) const
+{
+	return(m_lodCounts[(int)shape]);
+}
+
+/***********************************************************
+ *  GetTriangleCount()
+ *
+ *  This method is used for getting the number of triangles in
+ *  a detail level of one of the loaded meshes.
+ ***********************************************************/
+int SceneMeshes::GetTriangleCount(ShapeMesh shape, int lod) const
+{
+	return((int)(GetMeshRange(shape, lod).nIndices / 3));
+}
+
+/***********************************************************
+ *  GetCacheStats()
+ *
+ *  This method is used for getting the simulated vertex cache
+ *  misses of every loaded detail level, in the generated
+ *  triangle order and in the order that was uploaded.
+ ***********************************************************/
+SceneMeshes::CACHE_STATS SceneMeshes::GetCacheStats() const
+{
+	CACHE_STATS stats;
+	stats.triangleCount = 0;
+	stats.generatedMisses = 0;
+	stats.uploadedMisses = 0;
+
+	for (int i = 0; i < (int)ShapeMesh::Count; i++)
+	{
+		for (int lod = 0; lod < m_lodCounts[i]; lod++)
+		{
+			const MESH_ALLOCATION& mesh = m_meshes[i][lod];
+			stats.triangleCount += mesh.nIndices / 3;
+			stats.generatedMisses += mesh.generatedMisses;
+			stats.uploadedMisses += mesh.uploadedMisses;
+		}
+	}
+
+	return(stats);
+}
+
+/***********************************************************
+ *  GetArenaStats()
+ *
+ *  This method is used for getting the memory statistics of
+ *  the buffer shared by the meshes.
+ ***********************************************************/
+BufferArena::ARENA_STATS SceneMeshes::GetArenaStats() const
+{
+	return(m_arena.GetStats());
+}
+
+/***********************************************************
+ *  DefragmentArena()
+ *
+ *  This method is used for moving the meshes together in the
+ *  shared buffer, closing the gaps that reloaded meshes leave
+ *  behind.  It returns whether any mesh moved.
+ ***********************************************************/
+bool SceneMeshes::DefragmentArena()
+{
+	return(m_arena.Defragment());
+}
@@ -0,0 +1,228 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenemeshes.h
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "BufferArena.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  SceneMeshes
+ *
+ *  This class contains the basic shape meshes used by the 3D
+ *  scene.  The shapes match the dimensions of the ShapeMeshes
+ *  library, but they are built as indexed triangle lists and
+ *  every mesh can also be drawn instanced, taking the model
+ *  matrix of each copy from a per-instance vertex attribute.
+ *
+ *  All of the meshes share one buffer and one vertex array.
+ *  The vertices and indices of each mesh are sub-allocated
+ *  from the buffer, so switching meshes never rebinds vertex
+ *  state, and the whole scene can be drawn with a single
+ *  indirect multi-draw call.
+ *
+ *  The curved shapes are generated at several levels of
+ *  detail, each with half the segments of the one before, so
+ *  small or distant copies can be drawn with fewer triangles.
+ *  Level zero is the full tessellation.
+ *
+ *  The vertices can optionally be stored packed, at half the
+ *  size of the float layout, with positions quantized to the
+ *  bounds of their shape, octahedral normals and half-float
+ *  texture coordinates.  The vertex shader decodes them with
+ *  the quantization of the shape being drawn.
+ *
+ *  The triangles of every mesh are reordered for the vertex
+ *  cache and for overdraw as they are uploaded, and the
+ *  simulated cache misses before and after are kept.
+ ***********************************************************/
+class SceneMeshes
+{
+public:
+	// constructor
+	SceneMeshes();
+	// destructor
+	~SceneMeshes();
+
+	// basic shape meshes
+	enum class ShapeMesh
+	{
+		Cylinder,
+		Plane,
+		Sphere,
+		TaperedCylinder,
+		Torus,
+		Count
+	};
+
+	// number of detail levels of the curved shapes
+	static const int MAX_LOD_COUNT = 3;
+
+	// vertex layout shared by all of the meshes
+	struct MESH_VERTEX
+	{
+		glm::vec3 position;
+		glm::vec3 normal;
+		glm::vec2 textureCoordinate;
+	};
+
+	// packed vertex layout, with the position normalized to the
+	// bounds of its shape and the normal octahedral encoded
+	struct PACKED_VERTEX
+	{
+		GLshort position[4];
+		GLshort normal[2];
+		// half floats
+		GLushort textureCoordinate[2];
+	};
+
+	// location of a mesh in the shared vertex and index buffers
+	struct MESH_RANGE
+	{
+		GLuint firstIndex;
+		GLint baseVertex;
+		GLsizei nIndices;
+		// shape of the mesh, selecting its packed vertex quantization
+		GLint shape;
+	};
+
+	// simulated post-transform vertex cache misses of the loaded
+	// meshes, in the generated and the uploaded triangle order
+	struct CACHE_STATS
+	{
+		int triangleCount;
+		int generatedMisses;
+		int uploadedMisses;
+	};
+
+	// local-space bounds of a mesh
+	struct MESH_BOUNDS
+	{
+		glm::vec3 minimum;
+		glm::vec3 maximum;
+		glm::vec3 center;
+		float radius;
+	};
+
+	// choose whether the triangles are reordered as they load
+	void SetIndexOptimization(bool bOptimizeIndices);
+	// choose the packed vertex layout, before any mesh is loaded
+	bool SetPackedVertices(bool bPackedVertices);
+	// the vertices are stored in the packed layout
+	bool IsPackedVertices() const;
+	// bytes taken by one vertex in the shared buffer
+	GLsizei GetVertexSize() const;
+	// half size of the box that the packed positions of a mesh
+	// are normalized to, around the center of its bounds
+	glm::vec3 GetQuantizationScale(ShapeMesh shape) const;
+
+	// methods for generating the meshes into GPU memory
+	void LoadCylinderMesh();
+	void LoadPlaneMesh();
+	void LoadSphereMesh();
+	void LoadTaperedCylinderMesh();
+	void LoadTorusMesh();
+
+	// get the local-space bounds of a loaded mesh
+	const MESH_BOUNDS& GetMeshBounds(ShapeMesh shape) const;
+	// get the location of a detail level of a loaded mesh in the
+	// shared buffer
+	MESH_RANGE GetMeshRange(ShapeMesh shape, int lod = 0) const;
+	// number of detail levels of a loaded mesh
+	int GetLodCount(ShapeMesh shape) const;
+	// number of triangles in a detail level of a loaded mesh
+	int GetTriangleCount(ShapeMesh shape, int lod = 0) const;
+	// get the simulated vertex cache misses of the loaded meshes
+	CACHE_STATS GetCacheStats() const;
+	// get the memory statistics of the shared buffer
+	BufferArena::ARENA_STATS GetArenaStats() const;
+	// close the gaps left in the shared buffer by reloaded meshes
+	bool DefragmentArena();
+
+	// draw a single copy of the mesh with the model uniform
+	void DrawMesh(ShapeMesh shape) const;
+	// bind the vertex array shared by all meshes for a series of draws
+	void BindMeshes() const;
+	// release the vertex array binding
+	void UnbindMeshes() const;
+	// draw the mesh, which must already be bound
+	void DrawBoundMesh(ShapeMesh shape, int lod = 0) const;
+	// draw copies of the mesh, which must already be bound
+	void DrawBoundMeshInstanced(
+		ShapeMesh shape,
+		const glm::mat4* modelMatrices,
+		int instanceCount,
+		int lod = 0);
+	// draw one copy of the mesh for each passed in model matrix
+	void DrawMeshInstanced(
+		ShapeMesh shape,
+		const glm::mat4* modelMatrices,
+		int instanceCount);
+	// stream model matrices into the per-instance buffer
+	void UploadInstanceMatrices(
+		const glm::mat4* modelMatrices,
+		int matrixCount);
+	// draw consecutive commands of the bound indirect buffer,
+	// starting at a byte offset, with the meshes already bound
+	void DrawBoundMeshesIndirect(GLintptr commandOffset, int drawCount) const;
+
+private:
+	// allocations of a loaded mesh in the shared buffer
+	struct MESH_ALLOCATION
+	{
+		int vertexHandle;
+		int indexHandle;
+		GLsizei nIndices;
+		// simulated vertex cache misses before and after reordering
+		int generatedMisses;
+		int uploadedMisses;
+	};
+
+	// generated geometry of one detail level
+	struct MESH_LEVEL
+	{
+		std::vector<MESH_VERTEX> vertices;
+		std::vector<GLuint> indices;
+	};
+
+	// allocations of the loaded meshes indexed by shape and level
+	MESH_ALLOCATION m_meshes[(int)ShapeMesh::Count][MAX_LOD_COUNT];
+	// number of detail levels loaded for each shape
+	int m_lodCounts[(int)ShapeMesh::Count];
+	// local-space bounds indexed by shape
+	MESH_BOUNDS m_bounds[(int)ShapeMesh::Count];
+	// vertex array describing the shared buffers
+	GLuint m_vao;
+	// buffer holding the vertices and indices of all of the meshes
+	BufferArena m_arena;
+	// per-instance model matrices shared by all of the meshes
+	GLuint m_instanceVBO;
+	// number of model matrices the instance buffer can hold
+	int m_instanceCapacity;
+	// the vertices are stored in the packed layout
+	bool m_bPackedVertices;
+	// the triangles are reordered as they are uploaded
+	bool m_bOptimizeIndices;
+
+	// point the vertex attributes at the shared buffer in the
+	// current vertex layout
+	void SetupVertexLayout();
+
+	// set the bounds of a shape from all of its detail levels and
+	// copy every level into the shared buffer
+	void UploadMeshLevels(ShapeMesh shape, const std::vector<MESH_LEVEL>& levels);
+	// copy the generated geometry of one detail level into the
+	// shared buffer
+	void UploadMesh(
+		ShapeMesh shape,
+		int lod,
+		const std::vector<MESH_VERTEX>& vertices,
+		const std::vector<GLuint>& indices);
+	// compute the local-space bounds of the vertices of all levels
+	static MESH_BOUNDS ComputeBounds(const std::vector<MESH_LEVEL>& levels);
+};
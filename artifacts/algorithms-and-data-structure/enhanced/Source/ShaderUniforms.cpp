@@ -0,0 +1,113 @@
+///////////////////////////////////////////////////////////////////////////////
+// shaderuniforms.cpp
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ShaderUniforms.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+/***********************************************************
+ *  UniformHandle::Set()
+ *
+ *  These methods are used for setting a value into the
+ *  uniform through its resolved location.  A location of -1
+ *  is silently ignored by OpenGL, so uniforms that the
+ *  compiler optimized out are safe to set.
+ ***********************************************************/
+template <>
+void UniformHandle<int>::Set(const int& value) const
+{
+	glUniform1i(m_location, value);
+}
+
+template <>
+void UniformHandle<glm::vec3>::Set(const glm::vec3& value) const
+{
+	glUniform3fv(m_location, 1, glm::value_ptr(value));
+}
+
+template <>
+void UniformHandle<glm::mat4>::Set(const glm::mat4& value) const
+{
+	glUniformMatrix4fv(m_location, 1, GL_FALSE, glm::value_ptr(value));
+}
+
+/***********************************************************
+ *  UniformHandle::SetArray()
+ *
+ *  These methods are used for setting consecutive values
+ *  into a uniform array, starting at its first element.
+ ***********************************************************/
+template <>
+void UniformHandle<glm::vec3>::SetArray(const glm::vec3* values, int count) const
+{
+	glUniform3fv(m_location, count, glm::value_ptr(values[0]));
+}
+
+/***********************************************************
+ *  ShaderUniforms()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ShaderUniforms::ShaderUniforms()
+{
+	m_programID = 0;
+}
+
+/***********************************************************
+ *  ~ShaderUniforms()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ShaderUniforms::~ShaderUniforms()
+{
+	m_programID = 0;
+}
+
+/***********************************************************
+ *  Resolve()
+ *
+ *  This method is used for looking up the locations of all
+ *  of the scene uniforms in the passed in shader program.  It
+ *  needs to be called again whenever the program is relinked.
+ ***********************************************************/
+void ShaderUniforms::Resolve(GLuint programID)
+{
+	m_programID = programID;
+
+	model.Resolve(programID, "model");
+
+	objectTexture.Resolve(programID, "objectTexture");
+	objectTextureArray.Resolve(programID, "objectTextureArray");
+	objectTextureLayer.Resolve(programID, "objectTextureLayer");
+
+	meshQuantizationCenter.Resolve(programID, "meshQuantizationCenter");
+	meshQuantizationScale.Resolve(programID, "meshQuantizationScale");
+	objectMeshIndex.Resolve(programID, "objectMeshIndex");
+
+	materialTable.Resolve(programID, "materialTable");
+	objectMaterialIndex.Resolve(programID, "objectMaterialIndex");
+
+	lightTable.Resolve(programID, "lightTable");
+	lightGrid.Resolve(programID, "lightGrid");
+	lightIndices.Resolve(programID, "lightIndices");
+
+	gBufferAlbedo.Resolve(programID, "gBufferAlbedo");
+	gBufferNormal.Resolve(programID, "gBufferNormal");
+	gBufferMaterial.Resolve(programID, "gBufferMaterial");
+	gBufferDepth.Resolve(programID, "gBufferDepth");
+
+	drawTable.Resolve(programID, "drawTable");
+	drawTableBase.Resolve(programID, "drawTableBase");
+}
+
+/***********************************************************
+ *  GetProgramID()
+ *
+ *  This method is used for getting the program that the
+ *  uniform locations were resolved for.
+ ***********************************************************/
+GLuint ShaderUniforms::GetProgramID() const
+{
+	return(m_programID);
+}
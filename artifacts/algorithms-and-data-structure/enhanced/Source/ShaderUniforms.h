@@ -0,0 +1,108 @@
+///////////////////////////////////////////////////////////////////////////////
+// shaderuniforms.h
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+/***********************************************************
+ *  UniformHandle
+ *
+ *  This class holds the location of one shader uniform that
+ *  has been looked up by name ahead of time.  The value type
+ *  is part of the handle, so a value of the wrong type cannot
+ *  be set into the uniform.
+ ***********************************************************/
+template <typename T>
+class UniformHandle
+{
+public:
+	// constructor
+	UniformHandle() : m_location(-1) {}
+
+	// look up the uniform location in the passed in program
+	void Resolve(GLuint programID, const char* name)
+	{
+		m_location = glGetUniformLocation(programID, name);
+	}
+
+	// set the value into the uniform of the active program
+	void Set(const T& value) const;
+	// set consecutive values into a uniform array
+	void SetArray(const T* values, int count) const;
+
+	// location of the uniform, or -1 if it is not active
+	GLint GetLocation() const { return m_location; }
+
+private:
+	GLint m_location;
+};
+
+// value setters for the supported uniform types
+template <> void UniformHandle<int>::Set(const int& value) const;
+template <> void UniformHandle<glm::vec3>::Set(const glm::vec3& value) const;
+template <> void UniformHandle<glm::mat4>::Set(const glm::mat4& value) const;
+template <> void UniformHandle<glm::vec3>::SetArray(const glm::vec3* values, int count) const;
+
+/***********************************************************
+ *  ShaderUniforms
+ *
+ *  This class contains the handles for all of the uniforms
+ *  that the scene sets into the shaders.  The locations are
+ *  resolved once per shader program after it is linked, so
+ *  no uniform is looked up by name while rendering.  The
+ *  camera and light values are per frame and live in the
+ *  FrameUniforms buffer instead, and the features that a
+ *  draw turns on select a ShaderVariants program.
+ ***********************************************************/
+class ShaderUniforms
+{
+public:
+	// constructor
+	ShaderUniforms();
+	// destructor
+	~ShaderUniforms();
+
+	// look up all of the uniform locations in the passed in program
+	void Resolve(GLuint programID);
+	// the program that the locations were resolved for
+	GLuint GetProgramID() const;
+
+	// transform uniforms
+	UniformHandle<glm::mat4> model;
+
+	// surface uniforms
+	UniformHandle<int> objectTexture;
+	UniformHandle<int> objectTextureArray;
+	UniformHandle<int> objectTextureLayer;
+
+	// packed vertex decoding
+	UniformHandle<glm::vec3> meshQuantizationCenter;
+	UniformHandle<glm::vec3> meshQuantizationScale;
+	UniformHandle<int> objectMeshIndex;
+
+	// material uniforms
+	UniformHandle<int> materialTable;
+	UniformHandle<int> objectMaterialIndex;
+
+	// point lights binned into view clusters
+	UniformHandle<int> lightTable;
+	UniformHandle<int> lightGrid;
+	UniformHandle<int> lightIndices;
+
+	// G-buffer targets of deferred shading
+	UniformHandle<int> gBufferAlbedo;
+	UniformHandle<int> gBufferNormal;
+	UniformHandle<int> gBufferMaterial;
+	UniformHandle<int> gBufferDepth;
+
+	// per-draw values of an indirect multi-draw
+	UniformHandle<int> drawTable;
+	UniformHandle<int> drawTableBase;
+
+private:
+	// the program that the locations were resolved for
+	GLuint m_programID;
+};
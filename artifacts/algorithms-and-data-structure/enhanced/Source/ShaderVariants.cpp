@@ -0,0 +1,685 @@
+///////////////////////////////////////////////////////////////////////////////
+// shadervariants.cpp
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ShaderVariants.h"
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+// declaration of global variables and functions
+namespace
+{
+	// name of the #define of every feature bit, in bit order
+	const char* const FEATURE_DEFINES[ShaderVariants::FEATURE_COUNT] =
+	{
+		"USE_INSTANCING",
+		"USE_TEXTURE",
+		"USE_DRAW_TABLE",
+		"USE_LIGHTING",
+		"USE_TEXTURE_ARRAY",
+		"PACKED_VERTICES",
+		"USE_LIGHT_CLUSTERS",
+		"GEOMETRY_PASS",
+		"LIGHTING_PASS"
+	};
+
+	/***********************************************************
+	 *  ReadSourceFile()
+	 *
+	 *  Read a whole shader source file into a string.
+	 ***********************************************************/
+	bool ReadSourceFile(const char* filename, std::string& source)
+	{
+		std::ifstream file(filename, std::ios::in | std::ios::binary);
+		if (!file)
+		{
+			std::cout << "Could not open shader source:" << filename << std::endl;
+			return (false);
+		}
+
+		std::ostringstream contents;
+		contents << file.rdbuf();
+		source = contents.str();
+
+		return (true);
+	}
+}
+
+/***********************************************************
+ *  ShaderVariants()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ShaderVariants::ShaderVariants()
+{
+	m_bAsyncCompile = true;
+	m_bParallelCompile = false;
+	m_bCompileThreadsSet = false;
+	m_cachedVariantCount = 0;
+	m_compileTime = 0.0;
+	m_cacheLoadTime = 0.0;
+}
+
+/***********************************************************
+ *  ~ShaderVariants()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ShaderVariants::~ShaderVariants()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  LoadSources()
+ *
+ *  This method is used for reading the vertex and fragment
+ *  shader sources.  Nothing is compiled until a variant is
+ *  asked for or requested, and the variants compiled from
+ *  earlier sources are released along with the program cache.
+ ***********************************************************/
+bool ShaderVariants::LoadSources(const char* vertexFilename, const char* fragmentFilename)
+{
+	Destroy();
+	m_programCache.Close();
+
+	if ((ReadSourceFile(vertexFilename, m_vertexSource) == false) ||
+		(ReadSourceFile(fragmentFilename, m_fragmentSource) == false))
+	{
+		return(false);
+	}
+	m_vertexFilename = vertexFilename;
+	m_fragmentFilename = fragmentFilename;
+
+	return(true);
+}
+
+/***********************************************************
+ *  OpenProgramCache()
+ *
+ *  This method is used for reading the program binaries kept
+ *  by earlier runs, once the sources are loaded.  The cache
+ *  only holds programs built from the same sources by the
+ *  same driver, so any other programs in the file are
+ *  compiled again and replace them.
+ ***********************************************************/
+bool ShaderVariants::OpenProgramCache(const char* filename)
+{
+	if ((m_vertexSource.empty() == true) || (m_fragmentSource.empty() == true))
+	{
+		return(false);
+	}
+
+	// the terminator keeps the end of one source from matching
+	// the start of the other
+	std::string sources = m_vertexSource;
+	sources += '\0';
+	sources += m_fragmentSource;
+
+	return(m_programCache.Open(filename, sources));
+}
+
+/***********************************************************
+ *  SaveProgramCache()
+ *
+ *  This method is used for writing the program binaries of
+ *  the variants that were compiled in this run to the cache.
+ *  Programs that were started but never drawn with are
+ *  finished first, so the next run can load them too.
+ ***********************************************************/
+bool ShaderVariants::SaveProgramCache()
+{
+	if (m_programCache.IsOpen() == true)
+	{
+		while (m_pendingPrograms.empty() == false)
+		{
+			FinishProgram(m_pendingPrograms.begin()->first);
+		}
+	}
+
+	return(m_programCache.Save());
+}
+
+/***********************************************************
+ *  SetAsyncCompile()
+ *
+ *  This method is used for choosing whether compiles can be
+ *  started without waiting for them.  Without it, or when the
+ *  driver has no KHR_parallel_shader_compile, every variant
+ *  is compiled when it is first asked for.
+ ***********************************************************/
+void ShaderVariants::SetAsyncCompile(bool bAsyncCompile)
+{
+	m_bAsyncCompile = bAsyncCompile;
+}
+
+/***********************************************************
+ *  RequestVariant()
+ *
+ *  This method is used for starting the compile of the
+ *  variant of a feature mask without waiting for it, so it
+ *  is ready by the time it is drawn with.  Asking for a mask
+ *  that is compiled or compiling already does nothing.  A
+ *  driver that cannot report when a compile is done would
+ *  make the first draw wait for every requested compile, so
+ *  then nothing is started ahead of time.
+ ***********************************************************/
+void ShaderVariants::RequestVariant(unsigned int features)
+{
+	SetupCompileThreads();
+
+	if ((m_bAsyncCompile == false) ||
+		(m_bParallelCompile == false) ||
+		(m_variantIndices.find(features) != m_variantIndices.end()) ||
+		(m_pendingPrograms.find(features) != m_pendingPrograms.end()) ||
+		(m_failedFeatures.find(features) != m_failedFeatures.end()))
+	{
+		return;
+	}
+
+	StartProgram(features);
+}
+
+/***********************************************************
+ *  GetVariant()
+ *
+ *  This method is used for getting the variant of a feature
+ *  mask, waiting for its compile to finish.  A mask that has
+ *  not been used before is loaded from the program cache, or
+ *  compiled and linked and then added to the cache.  Its
+ *  uniform locations are resolved, and bFirstUse is set the
+ *  first time it is handed out so the caller can set up the
+ *  new program.
+ ***********************************************************/
+int ShaderVariants::GetVariant(unsigned int features, bool& bFirstUse)
+{
+	bFirstUse = false;
+
+	if (m_failedFeatures.find(features) != m_failedFeatures.end())
+	{
+		return(-1);
+	}
+	if ((m_variantIndices.find(features) == m_variantIndices.end()) &&
+		(m_pendingPrograms.find(features) == m_pendingPrograms.end()))
+	{
+		StartProgram(features);
+	}
+	if (m_pendingPrograms.find(features) != m_pendingPrograms.end())
+	{
+		FinishProgram(features);
+	}
+
+	return(FindVariant(features, bFirstUse));
+}
+
+/***********************************************************
+ *  GetReadyVariant()
+ *
+ *  This method is used for getting the variant of a feature
+ *  mask only once it can be used without waiting.  A mask
+ *  that has not been used before starts compiling, and -1 is
+ *  returned until the driver reports that its program is
+ *  done, so the caller can draw with a fallback variant in
+ *  the meantime.  Without asynchronous compiles, or without
+ *  KHR_parallel_shader_compile, this is the same as
+ *  GetVariant().
+ ***********************************************************/
+int ShaderVariants::GetReadyVariant(unsigned int features, bool& bFirstUse)
+{
+	SetupCompileThreads();
+
+	if ((m_bAsyncCompile == false) || (m_bParallelCompile == false))
+	{
+		return(GetVariant(features, bFirstUse));
+	}
+
+	bFirstUse = false;
+
+	if (m_failedFeatures.find(features) != m_failedFeatures.end())
+	{
+		return(-1);
+	}
+	if ((m_variantIndices.find(features) == m_variantIndices.end()) &&
+		(m_pendingPrograms.find(features) == m_pendingPrograms.end()))
+	{
+		StartProgram(features);
+	}
+
+	std::map<unsigned int, PENDING_PROGRAM>::const_iterator pending = m_pendingPrograms.find(features);
+	if (pending != m_pendingPrograms.end())
+	{
+		if (IsProgramComplete(pending->second) == false)
+		{
+			return(-1);
+		}
+		FinishProgram(features);
+	}
+
+	return(FindVariant(features, bFirstUse));
+}
+
+/***********************************************************
+ *  Use()
+ *
+ *  This method is used for making the program of a variant
+ *  the current program.
+ ***********************************************************/
+void ShaderVariants::Use(int variant) const
+{
+	if ((variant >= 0) && (variant < (int)m_variants.size()))
+	{
+		glUseProgram(m_variants[variant].programID);
+	}
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for releasing every compiled program.
+ ***********************************************************/
+void ShaderVariants::Destroy()
+{
+	for (size_t i = 0; i < m_variants.size(); i++)
+	{
+		glDeleteProgram(m_variants[i].programID);
+	}
+	std::map<unsigned int, PENDING_PROGRAM>::const_iterator pending;
+	for (pending = m_pendingPrograms.begin(); pending != m_pendingPrograms.end(); ++pending)
+	{
+		glDeleteProgram(pending->second.programID);
+		glDeleteShader(pending->second.vertexShaderID);
+		glDeleteShader(pending->second.fragmentShaderID);
+	}
+	m_variants.clear();
+	m_pendingPrograms.clear();
+	m_variantIndices.clear();
+	m_failedFeatures.clear();
+}
+
+/***********************************************************
+ *  GetProgramID()
+ *
+ *  This method is used for getting the program of a variant.
+ ***********************************************************/
+GLuint ShaderVariants::GetProgramID(int variant) const
+{
+	return(m_variants[variant].programID);
+}
+
+/***********************************************************
+ *  GetUniforms()
+ *
+ *  This method is used for getting the uniform locations of
+ *  the program of a variant.
+ ***********************************************************/
+const ShaderUniforms& ShaderVariants::GetUniforms(int variant) const
+{
+	return(m_variants[variant].uniforms);
+}
+
+/***********************************************************
+ *  GetVariantCount()
+ *
+ *  This method is used for getting the number of compiled
+ *  variants.
+ ***********************************************************/
+int ShaderVariants::GetVariantCount() const
+{
+	return((int)m_variants.size());
+}
+
+/***********************************************************
+ *  GetCachedVariantCount()
+ *
+ *  This method is used for getting the number of variants
+ *  that were loaded from the program cache.
+ ***********************************************************/
+int ShaderVariants::GetCachedVariantCount() const
+{
+	return(m_cachedVariantCount);
+}
+
+/***********************************************************
+ *  GetPendingCount()
+ *
+ *  This method is used for getting the number of variants
+ *  whose compile has started but has not been finished.
+ ***********************************************************/
+int ShaderVariants::GetPendingCount() const
+{
+	return((int)m_pendingPrograms.size());
+}
+
+/***********************************************************
+ *  GetCompileTime()
+ *
+ *  This method is used for getting the total time spent
+ *  compiling and linking variants, in milliseconds.  With
+ *  asynchronous compiles this is only the time the caller
+ *  spent starting and finishing them.
+ ***********************************************************/
+double ShaderVariants::GetCompileTime() const
+{
+	return(m_compileTime);
+}
+
+/***********************************************************
+ *  GetCacheLoadTime()
+ *
+ *  This method is used for getting the total time spent
+ *  loading variants from the program cache, in milliseconds.
+ ***********************************************************/
+double ShaderVariants::GetCacheLoadTime() const
+{
+	return(m_cacheLoadTime);
+}
+
+/***********************************************************
+ *  BuildDefines()
+ *
+ *  This method is used for building the #define lines of the
+ *  features of a mask.  They are followed by a #line, so the
+ *  compiler reports the line numbers of the source files.
+ ***********************************************************/
+std::string ShaderVariants::BuildDefines(unsigned int features)
+{
+	std::string defines;
+	for (int bit = 0; bit < FEATURE_COUNT; bit++)
+	{
+		if ((features & (1u << bit)) != 0)
+		{
+			defines += "#define ";
+			defines += FEATURE_DEFINES[bit];
+			defines += "\n";
+		}
+	}
+	defines += "#line 2\n";
+
+	return(defines);
+}
+
+/***********************************************************
+ *  GetFallbackFeatures()
+ *
+ *  This method is used for getting the features of the
+ *  variant to draw with while the variant of a mask is
+ *  compiling.  It keeps the features that change how the
+ *  vertices are read and which outputs a pass writes, and
+ *  drops the ones that only change the shading, so every
+ *  mask of a pass shares a few fallbacks.  The lighting pass
+ *  keeps its lighting, since it has nothing else to draw.
+ ***********************************************************/
+unsigned int ShaderVariants::GetFallbackFeatures(unsigned int features)
+{
+	unsigned int fallbackFeatures = features &
+		(FEATURE_INSTANCING | FEATURE_DRAW_TABLE | FEATURE_PACKED_VERTICES |
+		FEATURE_GEOMETRY_PASS | FEATURE_LIGHTING_PASS);
+	if ((features & FEATURE_LIGHTING_PASS) != 0)
+	{
+		fallbackFeatures |= (features & FEATURE_LIGHTING);
+	}
+
+	return(fallbackFeatures);
+}
+
+/***********************************************************
+ *  StartStage()
+ *
+ *  This method is used for starting the compile of one shader
+ *  stage.  The defines go right after the #version line,
+ *  which has to be the first line of the source.  The status
+ *  is not asked for, since that would wait for the compile.
+ ***********************************************************/
+GLuint ShaderVariants::StartStage(
+	GLenum stage,
+	const std::string& source,
+	const std::string& defines) const
+{
+	size_t versionEnd = source.find('\n');
+	if (versionEnd == std::string::npos)
+	{
+		versionEnd = source.size();
+	}
+	else
+	{
+		versionEnd++;
+	}
+	std::string version = source.substr(0, versionEnd);
+	if (versionEnd == source.size())
+	{
+		version += "\n";
+	}
+
+	const GLchar* strings[3] =
+	{
+		version.c_str(),
+		defines.c_str(),
+		source.c_str() + versionEnd
+	};
+
+	GLuint shaderID = glCreateShader(stage);
+	glShaderSource(shaderID, 3, strings, NULL);
+	glCompileShader(shaderID);
+
+	return(shaderID);
+}
+
+/***********************************************************
+ *  ReportStage()
+ *
+ *  This method is used for printing the log of a shader stage
+ *  whose compile has failed.
+ ***********************************************************/
+void ShaderVariants::ReportStage(
+	GLuint shaderID,
+	const std::string& defines,
+	const std::string& filename) const
+{
+	GLint bCompiled = GL_FALSE;
+	glGetShaderiv(shaderID, GL_COMPILE_STATUS, &bCompiled);
+	if (bCompiled == GL_FALSE)
+	{
+		GLchar infoLog[1024];
+		glGetShaderInfoLog(shaderID, sizeof(infoLog), NULL, infoLog);
+		std::cout << "Could not compile shader:" << filename << "\n" << defines << infoLog << std::endl;
+	}
+}
+
+/***********************************************************
+ *  SetupCompileThreads()
+ *
+ *  This method is used for checking, once there is a context,
+ *  whether the driver reports when a compile is done, and for
+ *  letting it compile on as many threads as it has.
+ ***********************************************************/
+void ShaderVariants::SetupCompileThreads()
+{
+	if (m_bCompileThreadsSet == true)
+	{
+		return;
+	}
+	m_bCompileThreadsSet = true;
+
+	m_bParallelCompile = (GLEW_KHR_parallel_shader_compile == GL_TRUE);
+	if ((m_bParallelCompile == true) && (m_bAsyncCompile == true))
+	{
+		// the largest count leaves the number of threads to the driver
+		glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+	}
+}
+
+/***********************************************************
+ *  StartProgram()
+ *
+ *  This method is used for getting the program of a feature
+ *  mask going.  A program in the program cache is added as a
+ *  variant right away.  Otherwise both stages are compiled
+ *  and linked without asking for any status, which is what
+ *  lets the driver work on them in the background, and the
+ *  program waits in the pending programs until it is taken.
+ ***********************************************************/
+void ShaderVariants::StartProgram(unsigned int features)
+{
+	SetupCompileThreads();
+
+	std::string defines = BuildDefines(features);
+	std::chrono::high_resolution_clock::time_point startTime =
+		std::chrono::high_resolution_clock::now();
+
+	GLuint programID = m_programCache.LoadProgram(defines);
+	if (programID != 0)
+	{
+		AddVariant(features, programID);
+
+		std::chrono::duration<double, std::milli> loadTime =
+			std::chrono::high_resolution_clock::now() - startTime;
+		m_cacheLoadTime += loadTime.count();
+		m_cachedVariantCount++;
+		return;
+	}
+
+	if ((m_vertexSource.empty() == true) || (m_fragmentSource.empty() == true))
+	{
+		m_failedFeatures[features] = true;
+		return;
+	}
+
+	PENDING_PROGRAM pending;
+	pending.defines = defines;
+	pending.vertexShaderID = StartStage(GL_VERTEX_SHADER, m_vertexSource, defines);
+	pending.fragmentShaderID = StartStage(GL_FRAGMENT_SHADER, m_fragmentSource, defines);
+	pending.programID = glCreateProgram();
+	glAttachShader(pending.programID, pending.vertexShaderID);
+	glAttachShader(pending.programID, pending.fragmentShaderID);
+	m_programCache.PrepareProgram(pending.programID);
+	glLinkProgram(pending.programID);
+	m_pendingPrograms[features] = pending;
+
+	std::chrono::duration<double, std::milli> startDuration =
+		std::chrono::high_resolution_clock::now() - startTime;
+	m_compileTime += startDuration.count();
+}
+
+/***********************************************************
+ *  IsProgramComplete()
+ *
+ *  This method is used for checking whether the driver has
+ *  finished compiling and linking a pending program.  Without
+ *  KHR_parallel_shader_compile there is no way to ask, so the
+ *  program counts as done and is waited for when taken, though
+ *  then no program is started ahead of time.
+ ***********************************************************/
+bool ShaderVariants::IsProgramComplete(const PENDING_PROGRAM& pending) const
+{
+	if (m_bParallelCompile == false)
+	{
+		return(true);
+	}
+
+	GLint bComplete = GL_FALSE;
+	glGetProgramiv(pending.programID, GL_COMPLETION_STATUS_KHR, &bComplete);
+
+	return(bComplete == GL_TRUE);
+}
+
+/***********************************************************
+ *  FinishProgram()
+ *
+ *  This method is used for taking a pending program once it
+ *  is linked, waiting for the driver if it is not done.  A
+ *  program that links is added to the program cache and as a
+ *  variant, and one that does not has the logs of its stages
+ *  printed and its mask marked as failed.
+ ***********************************************************/
+void ShaderVariants::FinishProgram(unsigned int features)
+{
+	std::map<unsigned int, PENDING_PROGRAM>::iterator found = m_pendingPrograms.find(features);
+	if (found == m_pendingPrograms.end())
+	{
+		return;
+	}
+	PENDING_PROGRAM pending = found->second;
+	m_pendingPrograms.erase(found);
+
+	std::chrono::high_resolution_clock::time_point startTime =
+		std::chrono::high_resolution_clock::now();
+
+	GLint bLinked = GL_FALSE;
+	glGetProgramiv(pending.programID, GL_LINK_STATUS, &bLinked);
+	if (bLinked == GL_FALSE)
+	{
+		ReportStage(pending.vertexShaderID, pending.defines, m_vertexFilename);
+		ReportStage(pending.fragmentShaderID, pending.defines, m_fragmentFilename);
+
+		GLchar infoLog[1024];
+		glGetProgramInfoLog(pending.programID, sizeof(infoLog), NULL, infoLog);
+		std::cout << "Could not link shader program:\n" << pending.defines << infoLog << std::endl;
+	}
+
+	// the program keeps the compiled code once it is linked
+	glDetachShader(pending.programID, pending.vertexShaderID);
+	glDetachShader(pending.programID, pending.fragmentShaderID);
+	glDeleteShader(pending.vertexShaderID);
+	glDeleteShader(pending.fragmentShaderID);
+
+	if (bLinked == GL_FALSE)
+	{
+		glDeleteProgram(pending.programID);
+		m_failedFeatures[features] = true;
+	}
+	else
+	{
+		m_programCache.StoreProgram(pending.defines, pending.programID);
+		AddVariant(features, pending.programID);
+	}
+
+	std::chrono::duration<double, std::milli> finishTime =
+		std::chrono::high_resolution_clock::now() - startTime;
+	m_compileTime += finishTime.count();
+}
+
+/***********************************************************
+ *  AddVariant()
+ *
+ *  This method is used for adding a linked program as the
+ *  variant of a feature mask and resolving its uniforms.
+ ***********************************************************/
+void ShaderVariants::AddVariant(unsigned int features, GLuint programID)
+{
+	VARIANT variant;
+	variant.features = features;
+	variant.programID = programID;
+	variant.uniforms.Resolve(programID);
+	variant.bUsed = false;
+	m_variants.push_back(variant);
+
+	m_variantIndices[features] = (int)m_variants.size() - 1;
+}
+
+/***********************************************************
+ *  FindVariant()
+ *
+ *  This method is used for finding the variant of a feature
+ *  mask, or -1 if there is none.  bFirstUse is set the first
+ *  time it is handed out, which for a variant compiled ahead
+ *  of time is later than when it was added.
+ ***********************************************************/
+int ShaderVariants::FindVariant(unsigned int features, bool& bFirstUse)
+{
+	bFirstUse = false;
+
+	std::map<unsigned int, int>::const_iterator found = m_variantIndices.find(features);
+	if (found == m_variantIndices.end())
+	{
+		return(-1);
+	}
+
+	VARIANT& variant = m_variants[found->second];
+	bFirstUse = (variant.bUsed == false);
+	variant.bUsed = true;
+
+	return(found->second);
+}
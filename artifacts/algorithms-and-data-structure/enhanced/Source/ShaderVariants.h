@@ -0,0 +1,176 @@
+///////////////////////////////////////////////////////////////////////////////
+// shadervariants.h
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShaderUniforms.h"
+#include "ProgramCache.h"
+
+#include <GL/glew.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  ShaderVariants
+ *
+ *  This class builds specialized programs from one vertex and
+ *  one fragment shader source.  Every feature that a draw can
+ *  turn on is a bit of a feature mask, and each bit adds a
+ *  #define in front of both sources, so the shaders select
+ *  their code with #ifdef instead of branching on uniforms.
+ *  A variant is compiled the first time its mask is asked
+ *  for and cached by the mask, along with the uniform
+ *  locations of its program.  With a program cache, the
+ *  linked programs are also kept on disk, so later runs load
+ *  their binaries instead of compiling them.
+ *
+ *  Where KHR_parallel_shader_compile is supported, compiles
+ *  can also be started ahead of time without waiting for
+ *  them, so the driver works on them while the scene is
+ *  drawn.  A program is only taken once the driver reports
+ *  that it is done, and the caller draws with a simpler
+ *  fallback variant until then.
+ ***********************************************************/
+class ShaderVariants
+{
+public:
+	// constructor
+	ShaderVariants();
+	// destructor
+	~ShaderVariants();
+
+	// features of a variant, with the ones that change between
+	// the draws of a frame in the lowest bits
+	enum FEATURE
+	{
+		FEATURE_INSTANCING = 1 << 0,
+		FEATURE_TEXTURE = 1 << 1,
+		FEATURE_DRAW_TABLE = 1 << 2,
+		FEATURE_LIGHTING = 1 << 3,
+		FEATURE_TEXTURE_ARRAY = 1 << 4,
+		FEATURE_PACKED_VERTICES = 1 << 5,
+		FEATURE_LIGHT_CLUSTERS = 1 << 6,
+		FEATURE_GEOMETRY_PASS = 1 << 7,
+		FEATURE_LIGHTING_PASS = 1 << 8,
+		FEATURE_COUNT = 9
+	};
+
+	// read the shader sources that every variant is built from
+	bool LoadSources(const char* vertexFilename, const char* fragmentFilename);
+	// load and keep the program binaries in the passed in file
+	bool OpenProgramCache(const char* filename);
+	// write the program binaries that were compiled in this run
+	bool SaveProgramCache();
+	// choose whether compiles can be started without waiting
+	void SetAsyncCompile(bool bAsyncCompile);
+
+	// start compiling the variant of a feature mask without
+	// waiting for it
+	void RequestVariant(unsigned int features);
+	// get the variant of a feature mask, waiting for it to
+	// compile, or -1 if it does not compile
+	int GetVariant(unsigned int features, bool& bFirstUse);
+	// get the variant of a feature mask once it has compiled, or
+	// -1 while it is compiling or if it does not compile
+	int GetReadyVariant(unsigned int features, bool& bFirstUse);
+	// make the program of a variant the current program
+	void Use(int variant) const;
+	// release every compiled program
+	void Destroy();
+
+	// program and uniform locations of a variant
+	GLuint GetProgramID(int variant) const;
+	const ShaderUniforms& GetUniforms(int variant) const;
+	// number of variants, and how many were loaded from the cache
+	int GetVariantCount() const;
+	int GetCachedVariantCount() const;
+	// number of variants still being compiled
+	int GetPendingCount() const;
+	// total time spent compiling variants, and loading them from
+	// the cache, in milliseconds
+	double GetCompileTime() const;
+	double GetCacheLoadTime() const;
+
+	// #define lines that select the features of a mask
+	static std::string BuildDefines(unsigned int features);
+	// features of the simpler variant that draws the same vertices
+	// while the variant of a mask is compiling
+	static unsigned int GetFallbackFeatures(unsigned int features);
+
+private:
+	// a compiled program and its uniform locations
+	struct VARIANT
+	{
+		unsigned int features;
+		GLuint programID;
+		ShaderUniforms uniforms;
+		// the variant has been handed out before
+		bool bUsed;
+	};
+
+	// a program whose compile and link have been started
+	struct PENDING_PROGRAM
+	{
+		std::string defines;
+		GLuint programID;
+		GLuint vertexShaderID;
+		GLuint fragmentShaderID;
+	};
+
+	// the programs cannot be shared between two objects
+	ShaderVariants(const ShaderVariants&);
+	ShaderVariants& operator=(const ShaderVariants&);
+
+	// the shader sources, and the files they were read from
+	std::string m_vertexSource;
+	std::string m_fragmentSource;
+	std::string m_vertexFilename;
+	std::string m_fragmentFilename;
+	// compiled variants, and their index by feature mask
+	std::vector<VARIANT> m_variants;
+	std::map<unsigned int, int> m_variantIndices;
+	// programs still being compiled, by feature mask
+	std::map<unsigned int, PENDING_PROGRAM> m_pendingPrograms;
+	// feature masks that failed to compile, so they are not retried
+	std::map<unsigned int, bool> m_failedFeatures;
+	// binaries of the linked programs kept between runs
+	ProgramCache m_programCache;
+	// compiles can be started without waiting for them
+	bool m_bAsyncCompile;
+	// the driver can report when a compile is done
+	bool m_bParallelCompile;
+	// the compile threads of the driver have been set up
+	bool m_bCompileThreadsSet;
+	// variants loaded from the program cache
+	int m_cachedVariantCount;
+	// total time spent compiling variants and loading them
+	double m_compileTime;
+	double m_cacheLoadTime;
+
+	// start compiling one shader stage with the passed in defines
+	GLuint StartStage(
+		GLenum stage,
+		const std::string& source,
+		const std::string& defines) const;
+	// print the log of a shader stage that did not compile
+	void ReportStage(
+		GLuint shaderID,
+		const std::string& defines,
+		const std::string& filename) const;
+	// let the driver compile on as many threads as it has
+	void SetupCompileThreads();
+	// load the program of a feature mask from the cache, or start
+	// compiling and linking it
+	void StartProgram(unsigned int features);
+	// the driver has finished a pending program
+	bool IsProgramComplete(const PENDING_PROGRAM& pending) const;
+	// wait for a pending program and add it as a variant
+	void FinishProgram(unsigned int features);
+	// add a linked program as the variant of a feature mask
+	void AddVariant(unsigned int features, GLuint programID);
+	// find the variant of a feature mask and mark it handed out
+	int FindVariant(unsigned int features, bool& bFirstUse);
+};
@@ -0,0 +1,275 @@
+///////////////////////////////////////////////////////////////////////////////
+// textureregistry.cpp
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TextureRegistry.h"
+
+#include <algorithm>
+#include <iostream>
+
+/***********************************************************
+ *  TextureRegistry()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TextureRegistry::TextureRegistry()
+{
+	m_textureArrayID = 0;
+	m_layerSize = 0;
+}
+
+/***********************************************************
+ *  ~TextureRegistry()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+TextureRegistry::~TextureRegistry()
+{
+	m_textures.clear();
+	m_handles.clear();
+}
+
+/***********************************************************
+ *  Register()
+ *
+ *  This method is used for adding a loaded texture under the
+ *  passed in tag.  Registering a tag a second time replaces
+ *  the texture and keeps the handle, so handles that were
+ *  already looked up stay valid.
+ ***********************************************************/
+int TextureRegistry::Register(
+	const std::string& tag,
+	GLuint textureID,
+	int width,
+	int height)
+{
+	std::unordered_map<std::string, int>::const_iterator found = m_handles.find(tag);
+	if (found != m_handles.end())
+	{
+		TEXTURE_ENTRY& entry = m_textures[found->second];
+		if (entry.ID != textureID)
+		{
+			glDeleteTextures(1, &entry.ID);
+			entry.ID = textureID;
+		}
+		entry.width = width;
+		entry.height = height;
+		return(found->second);
+	}
+
+	TEXTURE_ENTRY entry;
+	entry.tag = tag;
+	entry.ID = textureID;
+	entry.width = width;
+	entry.height = height;
+
+	int handle = (int)m_textures.size();
+	m_textures.push_back(entry);
+	m_handles[tag] = handle;
+
+	return(handle);
+}
+
+/***********************************************************
+ *  Find()
+ *
+ *  This method is used for getting the handle of the texture
+ *  registered under the passed in tag.
+ ***********************************************************/
+int TextureRegistry::Find(const std::string& tag) const
+{
+	std::unordered_map<std::string, int>::const_iterator found = m_handles.find(tag);
+	if (found == m_handles.end())
+	{
+		return(INVALID_HANDLE);
+	}
+
+	return(found->second);
+}
+
+/***********************************************************
+ *  GetTextureID()
+ *
+ *  This method is used for getting the OpenGL texture for
+ *  the passed in handle, or zero for an invalid handle.
+ ***********************************************************/
+GLuint TextureRegistry::GetTextureID(int handle) const
+{
+	if ((handle < 0) || (handle >= (int)m_textures.size()))
+	{
+		return(0);
+	}
+
+	return(m_textures[handle].ID);
+}
+
+/***********************************************************
+ *  GetTag()
+ *
+ *  This method is used for getting the tag of the texture
+ *  for the passed in handle.
+ ***********************************************************/
+const std::string& TextureRegistry::GetTag(int handle) const
+{
+	static const std::string emptyTag;
+
+	if ((handle < 0) || (handle >= (int)m_textures.size()))
+	{
+		return(emptyTag);
+	}
+
+	return(m_textures[handle].tag);
+}
+
+/***********************************************************
+ *  GetCount()
+ *
+ *  This method is used for getting the number of registered
+ *  textures.
+ ***********************************************************/
+int TextureRegistry::GetCount() const
+{
+	return((int)m_textures.size());
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for deleting all of the registered
+ *  OpenGL textures and clearing the registry.
+ ***********************************************************/
+void TextureRegistry::Destroy()
+{
+	for (size_t i = 0; i < m_textures.size(); i++)
+	{
+		glDeleteTextures(1, &m_textures[i].ID);
+	}
+
+	m_textures.clear();
+	m_handles.clear();
+
+	if (m_textureArrayID != 0)
+	{
+		glDeleteTextures(1, &m_textureArrayID);
+		m_textureArrayID = 0;
+	}
+	m_layerSize = 0;
+}
+
+/***********************************************************
+ *  BuildTextureArray()
+ *
+ *  This method is used for copying all of the registered
+ *  textures into one texture array.  The layers are square
+ *  and sized to the next power of two that fits the largest
+ *  texture, and every texture is scaled to the layer size by
+ *  a linear framebuffer blit, so textures of any size share
+ *  the array.  The layer of a texture is its handle.
+ ***********************************************************/
+bool TextureRegistry::BuildTextureArray()
+{
+	if (m_textures.empty() == true)
+	{
+		return(false);
+	}
+
+	GLint maxLayers = 0;
+	GLint maxSize = 0;
+	glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+	if ((int)m_textures.size() > maxLayers)
+	{
+		std::cout << "Texture array cannot hold " << m_textures.size()
+			<< " textures, the limit is " << maxLayers << std::endl;
+		return(false);
+	}
+
+	// size the layers to fit the largest texture
+	int largest = 1;
+	for (size_t i = 0; i < m_textures.size(); i++)
+	{
+		largest = std::max(largest, std::max(m_textures[i].width, m_textures[i].height));
+	}
+	int layerSize = 1;
+	while ((layerSize < largest) && (layerSize < maxSize))
+	{
+		layerSize *= 2;
+	}
+
+	if (m_textureArrayID != 0)
+	{
+		glDeleteTextures(1, &m_textureArrayID);
+	}
+
+	GLsizei layerCount = (GLsizei)m_textures.size();
+	glGenTextures(1, &m_textureArrayID);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, m_textureArrayID);
+	glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, layerSize, layerSize, layerCount, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+
+	// set the texture wrapping parameters
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	// set texture filtering parameters
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	// keep the framebuffers of the caller, such as the offscreen target
+	GLint previousReadFBO = 0;
+	GLint previousDrawFBO = 0;
+	glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &previousReadFBO);
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousDrawFBO);
+
+	GLuint framebuffers[2];
+	glGenFramebuffers(2, framebuffers);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffers[0]);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffers[1]);
+
+	// scale each texture into its layer
+	for (size_t i = 0; i < m_textures.size(); i++)
+	{
+		glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_textures[i].ID, 0);
+		glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, m_textureArrayID, 0, (GLint)i);
+
+		glBlitFramebuffer(
+			0, 0, m_textures[i].width, m_textures[i].height,
+			0, 0, layerSize, layerSize,
+			GL_COLOR_BUFFER_BIT, GL_LINEAR);
+	}
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, (GLuint)previousReadFBO);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, (GLuint)previousDrawFBO);
+	glDeleteFramebuffers(2, framebuffers);
+
+	// generate the mipmaps for all of the layers at once
+	glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+	m_layerSize = layerSize;
+
+	std::cout << "Built texture array with " << layerCount << " layers of "
+		<< layerSize << "x" << layerSize << std::endl;
+
+	return(true);
+}
+
+/***********************************************************
+ *  GetTextureArrayID()
+ *
+ *  This method is used for getting the texture array, which
+ *  is zero until BuildTextureArray() has succeeded.
+ ***********************************************************/
+GLuint TextureRegistry::GetTextureArrayID() const
+{
+	return(m_textureArrayID);
+}
+
+/***********************************************************
+ *  GetLayerSize()
+ *
+ *  This method is used for getting the width and height of
+ *  the texture array layers.
+ ***********************************************************/
+int TextureRegistry::GetLayerSize() const
+{
+	return(m_layerSize);
+}
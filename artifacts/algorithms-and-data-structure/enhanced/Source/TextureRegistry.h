@@ -0,0 +1,81 @@
+///////////////////////////////////////////////////////////////////////////////
+// textureregistry.h
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/***********************************************************
+ *  TextureRegistry
+ *
+ *  This class contains the loaded OpenGL textures.  Each tag
+ *  is interned into a small integer handle when the texture
+ *  is registered, so the scene can look a texture up by tag
+ *  once and then select it with the handle while rendering.
+ *  There is no limit on the number of registered textures.
+ *
+ *  The registered textures can also be copied into a single
+ *  texture array, with the layer of each texture equal to its
+ *  handle, so every texture can be used from one sampler.
+ ***********************************************************/
+class TextureRegistry
+{
+public:
+	// constructor
+	TextureRegistry();
+	// destructor
+	~TextureRegistry();
+
+	// handle returned for tags that are not registered
+	static const int INVALID_HANDLE = -1;
+
+	// add a texture under the passed in tag and get its handle
+	int Register(
+		const std::string& tag,
+		GLuint textureID,
+		int width,
+		int height);
+	// get the handle of the texture registered under the tag
+	int Find(const std::string& tag) const;
+
+	// get the OpenGL texture for the passed in handle
+	GLuint GetTextureID(int handle) const;
+	// get the tag for the passed in handle
+	const std::string& GetTag(int handle) const;
+	// number of registered textures
+	int GetCount() const;
+
+	// copy all of the registered textures into one texture array
+	bool BuildTextureArray();
+	// the texture array, or zero if it has not been built
+	GLuint GetTextureArrayID() const;
+	// width and height of every layer in the texture array
+	int GetLayerSize() const;
+
+	// delete all of the registered OpenGL textures
+	void Destroy();
+
+private:
+	// properties for one registered texture
+	struct TEXTURE_ENTRY
+	{
+		std::string tag;
+		GLuint ID;
+		int width;
+		int height;
+	};
+
+	// registered textures indexed by handle
+	std::vector<TEXTURE_ENTRY> m_textures;
+	// handles indexed by tag
+	std::unordered_map<std::string, int> m_handles;
+	// texture array holding a copy of every registered texture
+	GLuint m_textureArrayID;
+	// width and height of the texture array layers
+	int m_layerSize;
+};
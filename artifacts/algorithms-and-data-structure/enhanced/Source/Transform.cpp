@@ -0,0 +1,193 @@
+///////////////////////////////////////////////////////////////////////////////
+// transform.cpp
+///////////////////////////////////////////////////////////////////////////////
+
+#include "Transform.h"
+
+#include <cmath>
+
+/***********************************************************
+ *  Transform()
+ *
+ *  The constructors for the class
+ ***********************************************************/
+Transform::Transform()
+{
+	m_scale = glm::vec3(1.0f);
+	m_rotationDegrees = glm::vec3(0.0f);
+	m_position = glm::vec3(0.0f);
+	m_matrix = glm::mat4(1.0f);
+	m_bDirty = false;
+}
+
+Transform::Transform(
+	glm::vec3 scaleXYZ,
+	float XrotationDegrees,
+	float YrotationDegrees,
+	float ZrotationDegrees,
+	glm::vec3 positionXYZ)
+{
+	m_scale = scaleXYZ;
+	m_rotationDegrees = glm::vec3(XrotationDegrees, YrotationDegrees, ZrotationDegrees);
+	m_position = positionXYZ;
+	m_matrix = glm::mat4(1.0f);
+	m_bDirty = true;
+}
+
+/***********************************************************
+ *  ~Transform()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+Transform::~Transform()
+{
+}
+
+/***********************************************************
+ *  ComposeTRS()
+ *
+ *  This method is used for building the model matrix in
+ *  closed form.  The rotation Rz * Ry * Rx is written out
+ *  from the sines and cosines of the three angles, each of
+ *  its columns is multiplied by the scale of that axis, and
+ *  the position becomes the last column.  The result is the
+ *  same as translate * rotateZ * rotateY * rotateX * scale.
+ ***********************************************************/
+glm::mat4 Transform::ComposeTRS(
+	glm::vec3 scaleXYZ,
+	float XrotationDegrees,
+	float YrotationDegrees,
+	float ZrotationDegrees,
+	glm::vec3 positionXYZ)
+{
+	float rx = glm::radians(XrotationDegrees);
+	float ry = glm::radians(YrotationDegrees);
+	float rz = glm::radians(ZrotationDegrees);
+
+	float cx = std::cos(rx);
+	float sx = std::sin(rx);
+	float cy = std::cos(ry);
+	float sy = std::sin(ry);
+	float cz = std::cos(rz);
+	float sz = std::sin(rz);
+
+	glm::mat4 model;
+	model[0] = glm::vec4(
+		cz * cy,
+		sz * cy,
+		-sy,
+		0.0f) * scaleXYZ.x;
+	model[1] = glm::vec4(
+		cz * sy * sx - sz * cx,
+		sz * sy * sx + cz * cx,
+		cy * sx,
+		0.0f) * scaleXYZ.y;
+	model[2] = glm::vec4(
+		cz * sy * cx + sz * sx,
+		sz * sy * cx - cz * sx,
+		cy * cx,
+		0.0f) * scaleXYZ.z;
+	model[3] = glm::vec4(positionXYZ, 1.0f);
+
+	return(model);
+}
+
+/***********************************************************
+ *  SetScale()
+ *
+ *  This method is used for changing the scale.
+ ***********************************************************/
+void Transform::SetScale(glm::vec3 scaleXYZ)
+{
+	m_scale = scaleXYZ;
+	m_bDirty = true;
+}
+
+/***********************************************************
+ *  SetRotation()
+ *
+ *  This method is used for changing the rotation angles.
+ ***********************************************************/
+void Transform::SetRotation(
+	float XrotationDegrees,
+	float YrotationDegrees,
+	float ZrotationDegrees)
+{
+	m_rotationDegrees = glm::vec3(XrotationDegrees, YrotationDegrees, ZrotationDegrees);
+	m_bDirty = true;
+}
+
+/***********************************************************
+ *  SetPosition()
+ *
+ *  This method is used for changing the position.
+ ***********************************************************/
+void Transform::SetPosition(glm::vec3 positionXYZ)
+{
+	m_position = positionXYZ;
+	m_bDirty = true;
+}
+
+/***********************************************************
+ *  GetScale()
+ *
+ *  This method is used for getting the scale.
+ ***********************************************************/
+glm::vec3 Transform::GetScale() const
+{
+	return(m_scale);
+}
+
+/***********************************************************
+ *  GetRotation()
+ *
+ *  This method is used for getting the rotation angles in
+ *  degrees around the X, Y and Z axes.
+ ***********************************************************/
+glm::vec3 Transform::GetRotation() const
+{
+	return(m_rotationDegrees);
+}
+
+/***********************************************************
+ *  GetPosition()
+ *
+ *  This method is used for getting the position.
+ ***********************************************************/
+glm::vec3 Transform::GetPosition() const
+{
+	return(m_position);
+}
+
+/***********************************************************
+ *  GetMatrix()
+ *
+ *  This method is used for getting the model matrix.  It is
+ *  only composed again when a value changed since last time.
+ ***********************************************************/
+const glm::mat4& Transform::GetMatrix()
+{
+	if (m_bDirty == true)
+	{
+		m_matrix = ComposeTRS(
+			m_scale,
+			m_rotationDegrees.x,
+			m_rotationDegrees.y,
+			m_rotationDegrees.z,
+			m_position);
+		m_bDirty = false;
+	}
+
+	return(m_matrix);
+}
+
+/***********************************************************
+ *  IsDirty()
+ *
+ *  This method is used for checking whether the matrix needs
+ *  to be composed again.
+ ***********************************************************/
+bool Transform::IsDirty() const
+{
+	return(m_bDirty);
+}
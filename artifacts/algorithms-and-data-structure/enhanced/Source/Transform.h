@@ -0,0 +1,64 @@
+///////////////////////////////////////////////////////////////////////////////
+// transform.h
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+/***********************************************************
+ *  Transform
+ *
+ *  This class contains the scale, rotation and position of
+ *  an object along with its composed model matrix.  The
+ *  matrix is only rebuilt after one of the values changes,
+ *  so objects that never move cost nothing per frame.
+ ***********************************************************/
+class Transform
+{
+public:
+	// constructor
+	Transform();
+	Transform(
+		glm::vec3 scaleXYZ,
+		float XrotationDegrees,
+		float YrotationDegrees,
+		float ZrotationDegrees,
+		glm::vec3 positionXYZ);
+	// destructor
+	~Transform();
+
+	// compose translation * rotationZ * rotationY * rotationX * scale
+	// directly, without multiplying the separate matrices
+	static glm::mat4 ComposeTRS(
+		glm::vec3 scaleXYZ,
+		float XrotationDegrees,
+		float YrotationDegrees,
+		float ZrotationDegrees,
+		glm::vec3 positionXYZ);
+
+	// change the transformation values
+	void SetScale(glm::vec3 scaleXYZ);
+	void SetRotation(float XrotationDegrees, float YrotationDegrees, float ZrotationDegrees);
+	void SetPosition(glm::vec3 positionXYZ);
+
+	// the transformation values
+	glm::vec3 GetScale() const;
+	glm::vec3 GetRotation() const;
+	glm::vec3 GetPosition() const;
+
+	// the model matrix, rebuilt first if a value has changed
+	const glm::mat4& GetMatrix();
+	// a value has changed since the matrix was last built
+	bool IsDirty() const;
+
+private:
+	glm::vec3 m_scale;
+	glm::vec3 m_rotationDegrees;
+	glm::vec3 m_position;
+
+	// cached model matrix
+	glm::mat4 m_matrix;
+	// the cached matrix is out of date
+	bool m_bDirty;
+};
@@ -3,20 +3,23 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "ViewManager.h"
+#include "SceneManager.h"
 
 // GLM Math Header inclusions
 #include <glm/glm.hpp>
 #include <glm/gtx/transform.hpp>
 #include <glm/gtc/type_ptr.hpp>    
 
+#include <fstream>
+#include <iostream>
+#include <vector>
+
 // declaration of the global variables and defines
 namespace
 {
     // Variables for window width and height
     const int WINDOW_WIDTH = 1000;
     const int WINDOW_HEIGHT = 800;
-    const char* g_ViewName = "view";
-    const char* g_ProjectionName = "projection";
 
     // camera object used for viewing and interacting with
     // the 3D scene
@@ -26,10 +29,14 @@ namespace
     float gLastX = WINDOW_WIDTH / 2.0f;
     float gLastY = WINDOW_HEIGHT / 2.0f;
     bool gFirstMouse = true;
+    // mouse input is ignored while a camera path is replayed
+    bool gCameraReplay = false;
 
     // time between current frame and last frame
     float gDeltaTime = 0.0f;
     float gLastFrame = 0.0f;
+    // total time that the scene has been running
+    float gSceneTime = 0.0f;
 
     // movement speed adjustment factor
     float cameraSpeedFactor = 1.0f;
@@ -42,11 +49,18 @@ float ViewManager::cameraSpeedFactor = 0.1f;
  *
  *  The constructor for the class
  ***********************************************************/
-ViewManager::ViewManager(ShaderManager* pShaderManager)
+ViewManager::ViewManager()
 {
     // initialize the member variables
-    m_pShaderManager = pShaderManager;
+    m_pFrameUniforms = NULL;
+    m_pSceneManager = NULL;
     m_pWindow = NULL;
+    m_offscreenFBO = 0;
+    m_offscreenColor = 0;
+    m_offscreenDepth = 0;
+    m_pReplayPath = NULL;
+    m_pRecordPath = NULL;
+    m_fixedTimestep = 0.0f;
     g_pCamera = new Camera();
     // default camera view parameters
     g_pCamera->Position = glm::vec3(0.0f, 5.0f, 12.0f);
@@ -69,8 +83,12 @@ ViewManager::ViewManager(ShaderManager* pShaderManager)
 ViewManager::~ViewManager()
 {
     // free up allocated memory
-    m_pShaderManager = NULL;
+    DestroyOffscreenTarget();
+    m_pFrameUniforms = NULL;
+    m_pSceneManager = NULL;
     m_pWindow = NULL;
+    m_pReplayPath = NULL;
+    m_pRecordPath = NULL;
     if (NULL != g_pCamera)
     {
         delete g_pCamera;
@@ -119,6 +137,141 @@ GLFWwindow* ViewManager::CreateDisplayWindow(const char* windowTitle)
     return(window);
 }
 
+/***********************************************************
+ *  CreateOffscreenWindow()
+ *
+ *  This method is used to create a hidden window for the
+ *  offscreen mode.  The window is never shown - it is only
+ *  needed so that GLFW creates and owns the OpenGL context.
+ ***********************************************************/
+GLFWwindow* ViewManager::CreateOffscreenWindow(const char* windowTitle)
+{
+    GLFWwindow* window = nullptr;
+
+    // try to create the hidden OpenGL window
+    window = glfwCreateWindow(
+        WINDOW_WIDTH,
+        WINDOW_HEIGHT,
+        windowTitle,
+        NULL, NULL);
+    if (window == NULL)
+    {
+        std::cout << "Failed to create offscreen OpenGL context" << std::endl;
+        glfwTerminate();
+        return NULL;
+    }
+    glfwMakeContextCurrent(window);
+
+    // enable blending for supporting transparent rendering
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    m_pWindow = window;
+
+    return(window);
+}
+
+/***********************************************************
+ *  CreateOffscreenTarget()
+ *
+ *  This method is used to create the framebuffer object that
+ *  the scene is rendered into when running offscreen.  The
+ *  framebuffer stays bound, so the normal render path draws
+ *  into it without any changes.
+ ***********************************************************/
+bool ViewManager::CreateOffscreenTarget()
+{
+    glGenFramebuffers(1, &m_offscreenFBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_offscreenFBO);
+
+    // color attachment
+    glGenRenderbuffers(1, &m_offscreenColor);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_offscreenColor);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, WINDOW_WIDTH, WINDOW_HEIGHT);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_offscreenColor);
+
+    // depth attachment for the z-buffer
+    glGenRenderbuffers(1, &m_offscreenDepth);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_offscreenDepth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, WINDOW_WIDTH, WINDOW_HEIGHT);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_offscreenDepth);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        std::cout << "Offscreen framebuffer is not complete" << std::endl;
+        DestroyOffscreenTarget();
+        return false;
+    }
+
+    glViewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
+
+    return true;
+}
+
+/***********************************************************
+ *  DestroyOffscreenTarget()
+ *
+ *  This method is used to free the offscreen framebuffer.
+ ***********************************************************/
+void ViewManager::DestroyOffscreenTarget()
+{
+    if (m_offscreenFBO != 0)
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glDeleteFramebuffers(1, &m_offscreenFBO);
+        m_offscreenFBO = 0;
+    }
+    if (m_offscreenColor != 0)
+    {
+        glDeleteRenderbuffers(1, &m_offscreenColor);
+        m_offscreenColor = 0;
+    }
+    if (m_offscreenDepth != 0)
+    {
+        glDeleteRenderbuffers(1, &m_offscreenDepth);
+        m_offscreenDepth = 0;
+    }
+}
+
+/***********************************************************
+ *  SaveOffscreenFrame()
+ *
+ *  This method is used to read back the offscreen framebuffer
+ *  and write it to a binary PPM image file.
+ ***********************************************************/
+bool ViewManager::SaveOffscreenFrame(const char* filename)
+{
+    if (m_offscreenFBO == 0)
+    {
+        return false;
+    }
+
+    std::vector<unsigned char> pixels(WINDOW_WIDTH * WINDOW_HEIGHT * 3);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, m_offscreenFBO);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+
+    std::ofstream file(filename, std::ios::binary);
+    if (!file)
+    {
+        std::cout << "Could not write offscreen frame:" << filename << std::endl;
+        return false;
+    }
+
+    file << "P6\n" << WINDOW_WIDTH << " " << WINDOW_HEIGHT << "\n255\n";
+    // OpenGL rows start at the bottom, PPM rows start at the top
+    for (int row = WINDOW_HEIGHT - 1; row >= 0; row--)
+    {
+        file.write(reinterpret_cast<const char*>(&pixels[row * WINDOW_WIDTH * 3]), WINDOW_WIDTH * 3);
+    }
+
+    std::cout << "Saved offscreen frame:" << filename << std::endl;
+
+    return true;
+}
+
 /***********************************************************
  *  Mouse_Position_Callback()
  *
@@ -145,6 +298,12 @@ void ViewManager::Mouse_Position_Callback(GLFWwindow* window, double xMousePos,
     gLastX = xMousePos;
     gLastY = yMousePos;
 
+    // the replayed path is the only thing that moves the camera
+    if (gCameraReplay == true)
+    {
+        return;
+    }
+
     // move the 3D camera according to the calculated offsets
     g_pCamera->ProcessMouseMovement(xOffset, yOffset);
 }
@@ -157,6 +316,12 @@ void ViewManager::Mouse_Position_Callback(GLFWwindow* window, double xMousePos,
  ***********************************************************/
 void ViewManager::Scroll_Callback(GLFWwindow* window, double xoffset, double yoffset)
 {
+    // the replayed path is the only thing that moves the camera
+    if (gCameraReplay == true)
+    {
+        return;
+    }
+
     // Adjust the camera zoom based on scroll input
     if (yoffset > 0)
     {
@@ -225,6 +390,41 @@ void ViewManager::ProcessKeyboardEvents()
     {
         g_pCamera->Position -= g_pCamera->Up * gDeltaTime * g_pCamera->MovementSpeed; // Move down
     }
+
+    // switch between the forward and deferred render paths
+    if (NULL != m_pSceneManager)
+    {
+        if (glfwGetKey(m_pWindow, GLFW_KEY_F) == GLFW_PRESS)
+        {
+            m_pSceneManager->SetDeferredShading(false);
+        }
+        if (glfwGetKey(m_pWindow, GLFW_KEY_G) == GLFW_PRESS)
+        {
+            m_pSceneManager->SetDeferredShading(true);
+        }
+    }
+}
+
+/***********************************************************
+ *  SetFrameUniforms()
+ *
+ *  This method is used for setting the per-frame uniform
+ *  buffer that the camera values are written into.
+ ***********************************************************/
+void ViewManager::SetFrameUniforms(FrameUniforms* pFrameUniforms)
+{
+    m_pFrameUniforms = pFrameUniforms;
+}
+
+/***********************************************************
+ *  SetSceneManager()
+ *
+ *  This method is used for setting the scene whose render
+ *  path the F and G keys switch between forward and deferred.
+ ***********************************************************/
+void ViewManager::SetSceneManager(SceneManager* pSceneManager)
+{
+    m_pSceneManager = pSceneManager;
 }
 
 /***********************************************************
@@ -235,13 +435,40 @@ void ViewManager::ProcessKeyboardEvents()
  ***********************************************************/
 void ViewManager::PrepareSceneView()
 {
-    // calculate the time between the current and last frame
-    float currentFrame = glfwGetTime();
-    gDeltaTime = currentFrame - gLastFrame;
-    gLastFrame = currentFrame;
+    // calculate the time between the current and last frame - a
+    // fixed time step keeps replayed frames identical between runs
+    if (m_fixedTimestep > 0.0f)
+    {
+        gDeltaTime = m_fixedTimestep;
+    }
+    else
+    {
+        float currentFrame = glfwGetTime();
+        gDeltaTime = currentFrame - gLastFrame;
+        gLastFrame = currentFrame;
+    }
+    gSceneTime += gDeltaTime;
 
-    // handle camera movement and update the scene
-    ProcessKeyboardEvents();
+    if (NULL != m_pReplayPath)
+    {
+        // the scripted path replaces all live camera input, but
+        // the escape key still ends the run
+        if (glfwGetKey(m_pWindow, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+        {
+            glfwSetWindowShouldClose(m_pWindow, true);
+        }
+        m_pReplayPath->Sample(gSceneTime, g_pCamera->Position, g_pCamera->Front);
+    }
+    else
+    {
+        // handle camera movement and update the scene
+        ProcessKeyboardEvents();
+    }
+
+    if (NULL != m_pRecordPath)
+    {
+        m_pRecordPath->AddKeyframe(gSceneTime, g_pCamera->Position, g_pCamera->Front);
+    }
 
     // set the view and projection matrices
     glm::mat4 view = g_pCamera->GetViewMatrix();
@@ -259,11 +486,12 @@ void ViewManager::PrepareSceneView()
         projection = glm::ortho(-10.0f, 10.0f, -10.0f, 10.0f, 0.1f, 100.0f);
     }
 
-    // set the shader uniform variables
-    m_pShaderManager->setMat4Value(g_ViewName, view);
-    m_pShaderManager->setMat4Value(g_ProjectionName, projection);
-    // set the view position of the camera into the shader for proper rendering
-    m_pShaderManager->setVec3Value("viewPosition", g_pCamera->Position);
+    // store the camera values for the per-frame uniform buffer, which
+    // also carries the view position of the camera for lighting
+    if (NULL != m_pFrameUniforms)
+    {
+        m_pFrameUniforms->SetCamera(view, projection, g_pCamera->Position);
+    }
 }
 
 /***********************************************************
@@ -282,4 +510,45 @@ void ViewManager::ToggleProjection()
     {
         currentProjection = ProjectionType::Perspective;
     }
+}
+
+/***********************************************************
+ *  SetCameraReplay()
+ *
+ *  This method is used to drive the camera from a scripted
+ *  path.  While a path is set, the mouse and every key
+ *  except escape are ignored.
+ *  The replay starts over from the beginning of the path, so
+ *  repeated runs render the same frames.  The path wraps
+ *  around at its end, so a report that sets the path again
+ *  would otherwise start wherever the previous one stopped.
+ ***********************************************************/
+void ViewManager::SetCameraReplay(const CameraPath* pCameraPath)
+{
+    m_pReplayPath = pCameraPath;
+    gSceneTime = 0.0f;
+    gCameraReplay = (NULL != pCameraPath);
+}
+
+/***********************************************************
+ *  SetCameraRecording()
+ *
+ *  This method is used to record the camera position and
+ *  direction into the passed in path every frame.
+ ***********************************************************/
+void ViewManager::SetCameraRecording(CameraPath* pCameraPath)
+{
+    m_pRecordPath = pCameraPath;
+}
+
+/***********************************************************
+ *  SetFixedTimestep()
+ *
+ *  This method is used to advance the scene by the same time
+ *  step every frame.  Passing zero returns to the wall clock.
+ ***********************************************************/
+void ViewManager::SetFixedTimestep(float timestep)
+{
+    m_fixedTimestep = timestep;
+    gLastFrame = glfwGetTime();
 }
\ No newline at end of file
@@ -4,12 +4,15 @@
 
 #pragma once
 
-#include "ShaderManager.h"
+#include "FrameUniforms.h"
+#include "CameraPath.h"
 #include "camera.h"
 
 // GLFW library
 #include "GLFW/glfw3.h" 
 
+class SceneManager;
+
 enum class ProjectionType {
     Perspective,
     Orthographic
@@ -19,7 +22,7 @@ class ViewManager
 {
 public:
     // constructor
-    ViewManager(ShaderManager* pShaderManager);
+    ViewManager();
     // destructor
     ~ViewManager();
 
@@ -30,11 +33,25 @@ public:
     static void Scroll_Callback(GLFWwindow* window, double xoffset, double yoffset);
 
 private:
-    // pointer to shader manager object
-    ShaderManager* m_pShaderManager;
+    // pointer to the per-frame uniform buffer
+    FrameUniforms* m_pFrameUniforms;
+    // scene whose render path the keyboard switches
+    SceneManager* m_pSceneManager;
     // active OpenGL display window
     GLFWwindow* m_pWindow;
 
+    // offscreen framebuffer and its color and depth attachments
+    GLuint m_offscreenFBO;
+    GLuint m_offscreenColor;
+    GLuint m_offscreenDepth;
+
+    // scripted camera path that replaces live input, if any
+    const CameraPath* m_pReplayPath;
+    // camera path that the live camera is recorded into, if any
+    CameraPath* m_pRecordPath;
+    // fixed time step in seconds, or zero to use the wall clock
+    float m_fixedTimestep;
+
     // process keyboard events for interaction with the 3D scene
     void ProcessKeyboardEvents();
 
@@ -51,9 +68,30 @@ public:
     // create the initial OpenGL display window
     GLFWwindow* CreateDisplayWindow(const char* windowTitle);
 
+    // create a hidden window that only owns the OpenGL context
+    GLFWwindow* CreateOffscreenWindow(const char* windowTitle);
+    // create and bind the framebuffer used for offscreen rendering
+    bool CreateOffscreenTarget();
+    // release the offscreen framebuffer
+    void DestroyOffscreenTarget();
+    // write the offscreen framebuffer contents to a PPM image file
+    bool SaveOffscreenFrame(const char* filename);
+
+    // set the per-frame uniform buffer that receives the camera
+    void SetFrameUniforms(FrameUniforms* pFrameUniforms);
+    // set the scene whose render path the F and G keys switch
+    void SetSceneManager(SceneManager* pSceneManager);
+
     // prepare the conversion from 3D object display to 2D scene display
     void PrepareSceneView();
 
     // toggle between perspective and orthographic projections
     void ToggleProjection();
+
+    // drive the camera from a scripted path instead of live input
+    void SetCameraReplay(const CameraPath* pCameraPath);
+    // record the live camera into the passed in path every frame
+    void SetCameraRecording(CameraPath* pCameraPath);
+    // advance the scene by a fixed time step instead of the wall clock
+    void SetFixedTimestep(float timestep);
 };
\ No newline at end of file
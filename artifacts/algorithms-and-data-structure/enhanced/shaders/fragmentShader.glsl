@@ -1,9 +1,20 @@
 #version 330 core
-out vec4 fragmentColor;
+// the features of the program are selected by the #defines that the
+// ShaderVariants class adds after the first line
+
+// the color of the forward pass, and the surface color in the first
+// target of the G-buffer for the geometry pass of deferred shading
+layout (location = 0) out vec4 fragmentColor;
+// world normal and material index targets of the G-buffer
+layout (location = 1) out vec4 gBufferNormalOutput;
+layout (location = 2) out int gBufferMaterialOutput;
 
 in vec3 fragmentPosition;
 in vec3 fragmentVertexNormal;
 in vec2 fragmentTextureCoordinate;
+// material of the draw, and its texture layer or -1 for the object color
+flat in int fragmentMaterialIndex;
+flat in int fragmentTextureLayer;
 
 struct Material {
     vec3 diffuseColor;
@@ -23,12 +34,12 @@ struct DirectionalLight {
 
 struct PointLight {
     vec3 position;
+    // the light fades out at the radius, zero reaches everything
+    float radius;
     
     vec3 ambient;
     vec3 diffuse;
     vec3 specular;
-
-    bool bActive;
 };
 
 struct SpotLight {
@@ -48,82 +59,168 @@ struct SpotLight {
     bool bActive;
 };
 
-#define TOTAL_POINT_LIGHTS 5
+// per-frame camera values shared by all programs
+layout (std140) uniform FrameCamera
+{
+    mat4 view;
+    mat4 projection;
+    // turns a screen position and depth back into a world position
+    mat4 inverseViewProjection;
+    vec3 viewPosition;
+};
+
+// per-frame light sources shared by all programs
+layout (std140) uniform FrameLights
+{
+    DirectionalLight directionalLight;
+    SpotLight spotLight;
+    int pointLightCount;
+    // view depth of the first slice and slices per log of the depth
+    float lightClusterNear;
+    float lightClusterScale;
+};
+
+// point lights binned into view clusters, which must match the
+// grid of the ClusteredLights class
+const int LIGHT_CLUSTER_COLUMNS = 16;
+const int LIGHT_CLUSTER_ROWS = 9;
+const int LIGHT_CLUSTER_SLICES = 24;
+// four texels per light, and the first index and light count of
+// every cluster into the light index list
+uniform samplerBuffer lightTable;
+uniform isamplerBuffer lightGrid;
+uniform isamplerBuffer lightIndices;
 
-uniform bool bUseTexture=false;
-uniform bool bUseLighting=false;
-uniform vec4 objectColor = vec4(1.0f);
-uniform vec3 viewPosition;
-uniform DirectionalLight directionalLight;
-uniform PointLight pointLights[TOTAL_POINT_LIGHTS];
-uniform SpotLight spotLight;
-uniform Material material;
+// material table with two texels per material
+uniform samplerBuffer materialTable;
 uniform sampler2D objectTexture;
-uniform vec2 UVscale = vec2(1.0f, 1.0f);
+uniform sampler2DArray objectTextureArray;
+
+// G-buffer targets read by the lighting pass of deferred shading
+uniform sampler2D gBufferAlbedo;
+uniform sampler2D gBufferNormal;
+uniform isampler2D gBufferMaterial;
+uniform sampler2D gBufferDepth;
 
 // function prototypes
-vec3 CalcDirectionalLight(DirectionalLight light, vec3 normal, vec3 viewDir);
-vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
-vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
+vec3 CalcDirectionalLight(DirectionalLight light, vec3 normal, vec3 viewDir, vec3 albedo);
+vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 albedo);
+vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 albedo);
+vec3 ShadeSurface(vec3 albedo, vec3 norm, vec3 fragPos);
+void ShadeGBufferPixel();
+vec4 SampleObjectTexture(vec2 textureCoordinate);
+Material FetchMaterial(int materialIndex);
+PointLight FetchPointLight(int lightIndex);
+int FindLightCluster(vec3 fragPos);
+
+// material of the surface, read from the material table in main()
+Material material;
 
 void main()
 {    
-    if(bUseLighting == true)
+#ifdef LIGHTING_PASS
+    // the lighting pass shades the surfaces kept in the G-buffer
+    ShadeGBufferPixel();
+#else
+    // the surface color is sampled once and shared by every light
+#ifdef USE_TEXTURE
+    vec4 surfaceColor = SampleObjectTexture(fragmentTextureCoordinate);
+#else
+    vec4 surfaceColor = vec4(1.0f);
+#endif
+
+#ifdef USE_LIGHTING
+    vec3 norm = normalize(fragmentVertexNormal);
+#ifdef GEOMETRY_PASS
+    // the geometry pass keeps the surface for the lighting pass
+    fragmentColor = surfaceColor;
+    gBufferNormalOutput = vec4(norm, 0.0);
+    gBufferMaterialOutput = fragmentMaterialIndex;
+#else
+    material = FetchMaterial(fragmentMaterialIndex);
+    fragmentColor = vec4(ShadeSurface(surfaceColor.rgb, norm, fragmentPosition), surfaceColor.a);
+#endif
+#else
+    fragmentColor = surfaceColor;
+    // surfaces without lighting have no material in the G-buffer
+    gBufferNormalOutput = vec4(0.0);
+    gBufferMaterialOutput = -1;
+#endif
+#endif
+}
+
+// adds up the light of every light source reaching a surface.
+vec3 ShadeSurface(vec3 albedo, vec3 norm, vec3 fragPos)
+{
+    vec3 phongResult = vec3(0.0f);
+    vec3 viewDir = normalize(viewPosition - fragPos);
+
+    // == =====================================================
+    // Our lighting is set up in 3 phases: directional, point lights and an optional flashlight
+    // For each phase, a calculate function is defined that calculates the corresponding color
+    // per light source. In this function we take all the calculated colors and sum them 
+    // up for this surface's final color.
+    // == =====================================================
+    // phase 1: directional lighting
+    if(directionalLight.bActive == true)
     {
-        vec3 phongResult = vec3(0.0f);
-        // properties
-        vec3 norm = normalize(fragmentVertexNormal);
-        vec3 viewDir = normalize(viewPosition - fragmentPosition);
-    
-        // == =====================================================
-        // Our lighting is set up in 3 phases: directional, point lights and an optional flashlight
-        // For each phase, a calculate function is defined that calculates the corresponding color
-        // per light source. In the main() function we take all the calculated colors and sum them 
-        // up for this fragment's final color.
-        // == =====================================================
-        // phase 1: directional lighting
-        if(directionalLight.bActive == true)
-        {
-            phongResult += CalcDirectionalLight(directionalLight, norm, viewDir);
-        }
-        // phase 2: point lights
-        for(int i = 0; i < TOTAL_POINT_LIGHTS; i++)
-        {
-	    if(pointLights[i].bActive == true)
-            {
-                phongResult += CalcPointLight(pointLights[i], norm, fragmentPosition, viewDir);   
-            }
-        } 
-        // phase 3: spot light
-        if(spotLight.bActive == true)
-        {
-            phongResult += CalcSpotLight(spotLight, norm, fragmentPosition, viewDir);    
-        }
-    
-        if(bUseTexture == true)
-        {
-            fragmentColor = vec4(phongResult, (texture(objectTexture, fragmentTextureCoordinate)).a);
-        }
-        else
-        {
-            fragmentColor = vec4(phongResult, objectColor.a);
-        }
+        phongResult += CalcDirectionalLight(directionalLight, norm, viewDir, albedo);
+    }
+    // phase 2: point lights, only the ones reaching the cluster of
+    // the fragment unless the clusters are turned off
+#ifdef USE_LIGHT_CLUSTERS
+    ivec2 cluster = texelFetch(lightGrid, FindLightCluster(fragPos)).xy;
+    for(int i = 0; i < cluster.y; i++)
+    {
+        int lightIndex = texelFetch(lightIndices, cluster.x + i).x;
+        phongResult += CalcPointLight(FetchPointLight(lightIndex), norm, fragPos, viewDir, albedo);
+    }
+#else
+    for(int i = 0; i < pointLightCount; i++)
+    {
+        phongResult += CalcPointLight(FetchPointLight(i), norm, fragPos, viewDir, albedo);
+    }
+#endif
+    // phase 3: spot light
+    if(spotLight.bActive == true)
+    {
+        phongResult += CalcSpotLight(spotLight, norm, fragPos, viewDir, albedo);    
     }
-    else
+
+    return phongResult;
+}
+
+// shades the surface kept in the G-buffer for this pixel, rebuilding its
+// world position from the depth, so every visible pixel is lit only once.
+void ShadeGBufferPixel()
+{
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    float depth = texelFetch(gBufferDepth, pixel, 0).r;
+    // nothing was drawn here, so the cleared background stays
+    if(depth >= 1.0)
     {
-        if(bUseTexture == true)
-        {
-            fragmentColor = texture(objectTexture, fragmentTextureCoordinate * UVscale);
-        }
-        else
-        {
-            fragmentColor = objectColor;
-        }
+        discard;
     }
+
+    vec4 albedo = texelFetch(gBufferAlbedo, pixel, 0);
+    int materialIndex = texelFetch(gBufferMaterial, pixel, 0).r;
+    if(materialIndex < 0)
+    {
+        fragmentColor = albedo;
+        return;
+    }
+
+    vec2 screenPosition = (vec2(pixel) + vec2(0.5)) / vec2(textureSize(gBufferDepth, 0));
+    vec4 worldPosition = inverseViewProjection * (vec4(screenPosition, depth, 1.0) * 2.0 - 1.0);
+    vec3 fragPos = worldPosition.xyz / worldPosition.w;
+    vec3 norm = normalize(texelFetch(gBufferNormal, pixel, 0).xyz);
+
+    material = FetchMaterial(materialIndex);
+    fragmentColor = vec4(ShadeSurface(albedo.rgb, norm, fragPos), albedo.a);
 }
 
 // calculates the color when using a directional light.
-vec3 CalcDirectionalLight(DirectionalLight light, vec3 normal, vec3 viewDir)
+vec3 CalcDirectionalLight(DirectionalLight light, vec3 normal, vec3 viewDir, vec3 albedo)
 {
     vec3 ambient = vec3(0.0f);
     vec3 diffuse = vec3(0.0f);
@@ -136,24 +233,15 @@ vec3 CalcDirectionalLight(DirectionalLight light, vec3 normal, vec3 viewDir)
     vec3 reflectDir = reflect(-lightDirection, normal);
     float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
     // combine results
-    if(bUseTexture == true)
-    {
-        ambient = light.ambient * vec3(texture(objectTexture, fragmentTextureCoordinate));
-        diffuse = light.diffuse * diff * material.diffuseColor * vec3(texture(objectTexture, fragmentTextureCoordinate));
-        specular = light.specular * spec * material.specularColor * vec3(texture(objectTexture, fragmentTextureCoordinate));
-    }
-    else
-    {
-        ambient = light.ambient * vec3(objectColor);
-        diffuse = light.diffuse * diff * material.diffuseColor * vec3(objectColor);
-        specular = light.specular * spec * material.specularColor * vec3(objectColor);
-    }
+    ambient = light.ambient * albedo;
+    diffuse = light.diffuse * diff * material.diffuseColor * albedo;
+    specular = light.specular * spec * material.specularColor * albedo;
     
     return (ambient + diffuse + specular);
 }
 
 // calculates the color when using a point light.
-vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
+vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 albedo)
 {
     vec3 ambient = vec3(0.0f);
     vec3 diffuse = vec3(0.0f);
@@ -166,26 +254,25 @@ vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
     vec3 reflectDir = reflect(-lightDir, normal);
     // Calculate specular component
     float specularComponent = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
-   
-    // combine results
-    if(bUseTexture == true)
-    {
-        ambient = light.ambient * vec3(texture(objectTexture, fragmentTextureCoordinate));
-        diffuse = light.diffuse * diff * material.diffuseColor * vec3(texture(objectTexture, fragmentTextureCoordinate));
-        specular = light.specular * specularComponent * material.specularColor;
-    }
-    else
+    // lights with a radius fade out smoothly to nothing at the radius
+    float attenuation = 1.0;
+    if(light.radius > 0.0)
     {
-        ambient = light.ambient * vec3(objectColor);
-        diffuse = light.diffuse * diff * material.diffuseColor * vec3(objectColor);
-        specular = light.specular * specularComponent * material.specularColor;
+        float ratio = length(light.position - fragPos) / light.radius;
+        float window = clamp(1.0 - (ratio * ratio * ratio * ratio), 0.0, 1.0);
+        attenuation = window * window;
     }
+   
+    // combine results
+    ambient = light.ambient * albedo;
+    diffuse = light.diffuse * diff * material.diffuseColor * albedo;
+    specular = light.specular * specularComponent * material.specularColor;
     
-    return (ambient + diffuse + specular);
+    return ((ambient + diffuse + specular) * attenuation);
 }
 
 // calculates the color when using a spot light.
-vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
+vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 albedo)
 {
     vec3 ambient = vec3(0.0f);
     vec3 diffuse = vec3(0.0f);
@@ -205,21 +292,68 @@ vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
     float epsilon = light.cutOff - light.outerCutOff;
     float intensity = clamp((theta - light.outerCutOff) / epsilon, 0.0, 1.0);
     // combine results
-    if(bUseTexture == true)
-    {
-        ambient = light.ambient * vec3(texture(objectTexture, fragmentTextureCoordinate));
-        diffuse = light.diffuse * diff * material.diffuseColor * vec3(texture(objectTexture, fragmentTextureCoordinate));
-        specular = light.specular * spec * material.specularColor * vec3(texture(objectTexture, fragmentTextureCoordinate));
-    }
-    else
-    {
-        ambient = light.ambient * vec3(objectColor);
-        diffuse = light.diffuse * diff * material.diffuseColor * vec3(objectColor);
-        specular = light.specular * spec * material.specularColor * vec3(objectColor);
-    }
+    ambient = light.ambient * albedo;
+    diffuse = light.diffuse * diff * material.diffuseColor * albedo;
+    specular = light.specular * spec * material.specularColor * albedo;
     
     ambient *= attenuation * intensity;
     diffuse *= attenuation * intensity;
     specular *= attenuation * intensity;
     return (ambient + diffuse + specular);
 }
+
+// samples the object texture, either from its own texture unit or from
+// its layer of the scene texture array.
+vec4 SampleObjectTexture(vec2 textureCoordinate)
+{
+#ifdef USE_TEXTURE_ARRAY
+    return texture(objectTextureArray, vec3(textureCoordinate, float(fragmentTextureLayer)));
+#else
+    return texture(objectTexture, textureCoordinate);
+#endif
+}
+
+// reads a material from the material table, where the first texel holds the
+// diffuse color and shininess and the second texel the specular color.
+Material FetchMaterial(int materialIndex)
+{
+    vec4 diffuseShininess = texelFetch(materialTable, materialIndex * 2);
+    vec4 specular = texelFetch(materialTable, materialIndex * 2 + 1);
+
+    Material result;
+    result.diffuseColor = diffuseShininess.xyz;
+    result.specularColor = specular.xyz;
+    result.shininess = diffuseShininess.w;
+    return result;
+}
+
+// reads a point light from the light table, where the first texel holds the
+// position and radius and the others the ambient, diffuse and specular colors.
+PointLight FetchPointLight(int lightIndex)
+{
+    vec4 positionRadius = texelFetch(lightTable, lightIndex * 4);
+
+    PointLight result;
+    result.position = positionRadius.xyz;
+    result.radius = positionRadius.w;
+    result.ambient = texelFetch(lightTable, lightIndex * 4 + 1).xyz;
+    result.diffuse = texelFetch(lightTable, lightIndex * 4 + 2).xyz;
+    result.specular = texelFetch(lightTable, lightIndex * 4 + 3).xyz;
+    return result;
+}
+
+// finds the light cluster of a fragment from its screen tile and the
+// exponential slice of its view depth, the same way the lights were binned.
+int FindLightCluster(vec3 fragPos)
+{
+    vec4 viewPos = view * vec4(fragPos, 1.0);
+    vec4 clipPos = projection * viewPos;
+    vec2 ndc = clipPos.xy / clipPos.w;
+
+    int column = clamp(int(floor((ndc.x * 0.5 + 0.5) * float(LIGHT_CLUSTER_COLUMNS))), 0, LIGHT_CLUSTER_COLUMNS - 1);
+    int row = clamp(int(floor((ndc.y * 0.5 + 0.5) * float(LIGHT_CLUSTER_ROWS))), 0, LIGHT_CLUSTER_ROWS - 1);
+    float depth = max(-viewPos.z, lightClusterNear);
+    int slice = clamp(int(floor(log(depth / lightClusterNear) * lightClusterScale)), 0, LIGHT_CLUSTER_SLICES - 1);
+
+    return (slice * LIGHT_CLUSTER_ROWS + row) * LIGHT_CLUSTER_COLUMNS + column;
+}
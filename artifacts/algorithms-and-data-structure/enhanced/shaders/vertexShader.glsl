@@ -1,20 +1,109 @@
 #version 330 core
+#extension GL_ARB_shader_draw_parameters : enable
+// the features of the program are selected by the #defines that the
+// ShaderVariants class adds after the first line
 layout (location = 0) in vec3 inVertexPosition;
 layout (location = 1) in vec3 inVertexNormal;
 layout (location = 2) in vec2 inTextureCoordinate;
+layout (location = 3) in mat4 inInstanceModel;
 
 out vec3 fragmentPosition;
 out vec3 fragmentVertexNormal;
 out vec2 fragmentTextureCoordinate;
+// material of the draw, and its texture layer or -1 for the object color
+flat out int fragmentMaterialIndex;
+flat out int fragmentTextureLayer;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+uniform int objectTextureLayer = 0;
+uniform int objectMaterialIndex = 0;
+
+// packed vertices hold positions normalized to the bounds of their
+// mesh and octahedral normals, with one quantization box per mesh
+const int MAX_QUANTIZED_MESHES = 8;
+uniform vec3 meshQuantizationCenter[MAX_QUANTIZED_MESHES];
+uniform vec3 meshQuantizationScale[MAX_QUANTIZED_MESHES];
+uniform int objectMeshIndex = 0;
+
+// material, texture layer and mesh of every command of an indirect
+// multi-draw, one texel per command indexed by the draw ID from the
+// first command of the multi-draw
+uniform isamplerBuffer drawTable;
+uniform int drawTableBase = 0;
+
+// per-frame camera values shared by all programs
+layout (std140) uniform FrameCamera
+{
+    mat4 view;
+    mat4 projection;
+    mat4 inverseViewProjection;
+    vec3 viewPosition;
+};
+
+// unfold an octahedral encoded normal back onto the unit sphere
+vec3 DecodeOctahedral(vec2 encoded)
+{
+   vec3 normal = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+   float fold = max(-normal.z, 0.0);
+   normal.x += (normal.x >= 0.0) ? -fold : fold;
+   normal.y += (normal.y >= 0.0) ? -fold : fold;
+   return normalize(normal);
+}
 
 void main()
 {
-   fragmentPosition = vec3(model * vec4(inVertexPosition, 1.0));
-   gl_Position = projection * view * model * vec4(inVertexPosition, 1.0f);
-   fragmentVertexNormal = inVertexNormal;
+#ifdef LIGHTING_PASS
+   // the lighting pass of deferred shading draws one triangle that
+   // covers the screen, placing its corners from the vertex index
+   vec2 corner = vec2(float((gl_VertexID & 1) * 4 - 1), float((gl_VertexID & 2) * 2 - 1));
+   gl_Position = vec4(corner, 0.0, 1.0);
+   fragmentPosition = vec3(0.0);
+   fragmentVertexNormal = vec3(0.0);
+   fragmentTextureCoordinate = vec2(0.0);
+   fragmentMaterialIndex = -1;
+   fragmentTextureLayer = -1;
+#else
+   // per-draw values come from the draw table for indirect draws
+   // and from the uniforms otherwise
+#ifdef USE_DRAW_TABLE
+#ifdef GL_ARB_shader_draw_parameters
+   ivec4 drawData = texelFetch(drawTable, drawTableBase + gl_DrawIDARB);
+#else
+   ivec4 drawData = ivec4(0, -1, 0, 0);
+#endif
+   fragmentMaterialIndex = drawData.x;
+   fragmentTextureLayer = drawData.y;
+   int meshIndex = drawData.z;
+#else
+   fragmentMaterialIndex = objectMaterialIndex;
+#ifdef USE_TEXTURE
+   fragmentTextureLayer = objectTextureLayer;
+#else
+   fragmentTextureLayer = -1;
+#endif
+   int meshIndex = objectMeshIndex;
+#endif
+
+#ifdef PACKED_VERTICES
+   // the vertex fetch has already turned the packed values into
+   // floats, leaving the quantization box and normal to undo
+   vec3 vertexPosition = meshQuantizationCenter[meshIndex] + (inVertexPosition * meshQuantizationScale[meshIndex]);
+   vec3 vertexNormal = DecodeOctahedral(inVertexNormal.xy);
+#else
+   vec3 vertexPosition = inVertexPosition;
+   vec3 vertexNormal = inVertexNormal;
+#endif
+
+   // instanced draws take the model matrix from the per-instance attribute
+#ifdef USE_INSTANCING
+   mat4 modelMatrix = inInstanceModel;
+#else
+   mat4 modelMatrix = model;
+#endif
+
+   fragmentPosition = vec3(modelMatrix * vec4(vertexPosition, 1.0));
+   gl_Position = projection * view * modelMatrix * vec4(vertexPosition, 1.0f);
+   fragmentVertexNormal = vertexNormal;
    fragmentTextureCoordinate = inTextureCoordinate;
+#endif
 }
\ No newline at end of file